@@ -0,0 +1,221 @@
+﻿// BroadcastBench.cpp: 服务端向大量 TCP 客户端扇出同一消息的开销
+// 对比逐个连接调用 FNetNode::Send 与 CTinyServer::Broadcast
+//
+// 用法: BroadcastBench [客户端数=10000] [消息长度=256] [轮数=100] [Reactor 数=0(CPU核数)]
+
+#include "TinyNet.h"
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+
+using namespace tinynet;
+
+#define HOST "127.0.0.1"
+#define PORT 8200
+
+// 数据头长度(数据包总长度 + 事件Id)
+constexpr size_t kHeaderSize = 8;
+
+typedef std::chrono::steady_clock FClock;
+
+static double ElapsedMs(const FClock::time_point& n_Start)
+{
+	return std::chrono::duration<double, std::milli>(FClock::now() - n_Start).count();
+}
+
+// 测试客户端，由一个线程通过 epoll 读取所有连接，只统计接收的字节数
+class CBenchClients
+{
+public:
+	~CBenchClients()
+	{
+		Stop();
+		for (auto nFd : m_vecFds) close(nFd);
+		if (m_nEpfd > 0) close(m_nEpfd);
+	}
+
+	bool Connect(const int n_nCount)
+	{
+		m_nEpfd = epoll_create1(EPOLL_CLOEXEC);
+		if (m_nEpfd == -1) return false;
+
+		sockaddr_in Addr;
+		memset(&Addr, 0, sizeof(Addr));
+		Addr.sin_family = AF_INET;
+		Addr.sin_port = htons(PORT);
+		inet_pton(AF_INET, HOST, &Addr.sin_addr);
+
+		for (int i = 0; i < n_nCount; i++)
+		{
+			int nFd = socket(AF_INET, SOCK_STREAM, 0);
+			if (nFd == -1 || connect(nFd, (sockaddr*)&Addr, sizeof(Addr)) == -1)
+			{
+				std::cout << "connect error: " << strerror(errno) << ", connected " << i << std::endl;
+				if (nFd != -1) close(nFd);
+				return false;
+			}
+
+			fcntl(nFd, F_SETFL, fcntl(nFd, F_GETFL, 0) | O_NONBLOCK);
+
+			epoll_event ev;
+			ev.events = EPOLLIN;
+			ev.data.fd = nFd;
+			epoll_ctl(m_nEpfd, EPOLL_CTL_ADD, nFd, &ev);
+
+			m_vecFds.push_back(nFd);
+		}
+
+		m_bRun = true;
+		m_Thread = std::thread(&CBenchClients::ReadThread, this);
+		return true;
+	}
+
+	void Stop()
+	{
+		m_bRun = false;
+		if (m_Thread.joinable()) m_Thread.join();
+	}
+
+	// 等待接收的总字节数达到 n_nBytes，超时返回 false
+	bool Wait(const unsigned long long n_nBytes, const int n_nTimeoutMs)
+	{
+		auto Start = FClock::now();
+		while (m_nBytes.load() < n_nBytes)
+		{
+			if (ElapsedMs(Start) > n_nTimeoutMs) return false;
+			std::this_thread::yield();
+		}
+
+		return true;
+	}
+
+	void Reset() { m_nBytes = 0; }
+
+protected:
+	void ReadThread()
+	{
+		epoll_event Events[1024];
+		char szBuff[64 * 1024];
+
+		while (m_bRun)
+		{
+			int nCount = epoll_wait(m_nEpfd, Events, 1024, 10);
+			for (int i = 0; i < nCount; i++)
+			{
+				ssize_t nResult = 0;
+				while ((nResult = recv(Events[i].data.fd, szBuff, sizeof(szBuff), 0)) > 0)
+					m_nBytes += nResult;
+			}
+		}
+	}
+
+protected:
+	int									m_nEpfd = 0;
+	std::vector<int>					m_vecFds;
+	std::thread							m_Thread;
+	std::atomic<bool>					m_bRun{ false };
+	std::atomic<unsigned long long>		m_nBytes{ 0 };
+};
+
+// 提高文件描述符上限，服务端与测试客户端各占一半
+static void RaiseFdLimit(const int n_nClients)
+{
+	rlimit Limit;
+	if (getrlimit(RLIMIT_NOFILE, &Limit) != 0) return;
+
+	rlim_t nWant = (rlim_t)n_nClients * 2 + 64;
+	if (Limit.rlim_cur >= nWant) return;
+
+	Limit.rlim_cur = std::min(nWant, Limit.rlim_max);
+	setrlimit(RLIMIT_NOFILE, &Limit);
+
+	if (Limit.rlim_cur < nWant)
+		std::cout << "warning: RLIMIT_NOFILE " << Limit.rlim_cur << " < " << nWant << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	int nClients = argc > 1 ? atoi(argv[1]) : 10000;
+	int nSize = argc > 2 ? atoi(argv[2]) : 256;
+	int nRounds = argc > 3 ? atoi(argv[3]) : 100;
+	unsigned int nReactors = argc > 4 ? atoi(argv[4]) : 0;
+
+	RaiseFdLimit(nClients);
+
+	CTinyServer Server;
+	Server.Init(ENetType::TCP, HOST, PORT);
+	Server.SetReactorNum(nReactors);
+	if (!Server.Start())
+	{
+		std::cout << "server start error" << std::endl;
+		return 1;
+	}
+
+	CBenchClients Clients;
+	if (!Clients.Connect(nClients)) return 1;
+
+	// 等待所有连接被服务端接收
+	auto Start = FClock::now();
+	while (Server.GetClientCount() < (size_t)nClients && ElapsedMs(Start) < 10000)
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+	std::cout << "clients " << Server.GetClientCount() << ", payload " << nSize
+		<< " bytes, rounds " << nRounds << std::endl;
+
+	std::string sData(nSize, 'x');
+	auto nExpected = (unsigned long long)nClients * nRounds * (nSize + kHeaderSize);
+
+	// 逐个连接发送，每次发送都重新编码数据包
+	{
+		Clients.Reset();
+		double dCall = 0;
+
+		Start = FClock::now();
+		for (int r = 0; r < nRounds; r++)
+		{
+			auto CallStart = FClock::now();
+			for (auto pNode : Server.GetClients()) pNode->Send(sData);
+			dCall += ElapsedMs(CallStart);
+		}
+
+		bool bDone = Clients.Wait(nExpected, 60000);
+		auto dTotal = ElapsedMs(Start);
+
+		std::cout << "Send loop : " << dCall / nRounds << " ms/round in caller, "
+			<< dTotal << " ms until delivered" << (bDone ? "" : " (timeout)") << std::endl;
+	}
+
+	// 编码一次，加入各连接的发送队列，由 Reactor 发送
+	{
+		Clients.Reset();
+		double dCall = 0;
+
+		Start = FClock::now();
+		for (int r = 0; r < nRounds; r++)
+		{
+			auto CallStart = FClock::now();
+			Server.Broadcast(sData);
+			dCall += ElapsedMs(CallStart);
+		}
+
+		bool bDone = Clients.Wait(nExpected, 60000);
+		auto dTotal = ElapsedMs(Start);
+
+		std::cout << "Broadcast : " << dCall / nRounds << " ms/round in caller, "
+			<< dTotal << " ms until delivered" << (bDone ? "" : " (timeout)") << std::endl;
+	}
+
+	Clients.Stop();
+	Server.Stop();
+
+	return 0;
+}
@@ -0,0 +1,211 @@
+﻿// CoroBench.cpp: 协程接口的往返延时测试
+// 服务端以协程回显；客户端连接池分别以两种方式逐条请求-应答：
+// 线程: 每个连接一个应用线程，发送后等待回调线程通过条件变量交回应答；
+// 协程: 每个连接一个协程，co_await 发送及读取，在连接池的 Reactor 线程恢复，不切换线程
+//
+// 用法: CoroBench [连接数=4] [消息长度=64] [时长=3 秒]
+
+#include "Coroutine.h"
+#include "LatencyTrace.h"
+#include "Debug.h"
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace tinynet;
+
+#define HOST "127.0.0.1"
+#define PORT 8400
+
+typedef std::chrono::steady_clock FClock;
+
+struct FOptions
+{
+	int				nClients = 4;
+	int				nSize = 64;
+	int				nSeconds = 3;
+};
+
+struct FResult
+{
+	std::mutex		Mutex;
+	unsigned long long nMsgs = 0;
+	CLatencyHistogram	Latency;
+
+	void Merge(const unsigned long long n_nMsgs, const CLatencyHistogram& n_Latency)
+	{
+		std::unique_lock<std::mutex> lock(Mutex);
+		nMsgs += n_nMsgs;
+		Latency.Merge(n_Latency);
+	}
+};
+
+static unsigned long long NowNs()
+{
+	return (unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		FClock::now().time_since_epoch()).count();
+}
+
+static void Print(const std::string& n_sName, const FResult& n_Result, const int n_nSeconds)
+{
+	auto& Latency = n_Result.Latency;
+
+	std::cout << std::left << std::setw(12) << n_sName << std::right << std::fixed
+		<< std::setprecision(0) << std::setw(10) << n_Result.nMsgs / (double)n_nSeconds << " msgs/s"
+		<< std::setprecision(1)
+		<< "  p50 " << std::setw(7) << Latency.Percentile(50) / 1e3
+		<< "  p99 " << std::setw(7) << Latency.Percentile(99) / 1e3
+		<< "  p99.9 " << std::setw(7) << Latency.Percentile(99.9) / 1e3
+		<< "  max " << std::setw(8) << Latency.Max() / 1e3 << " us" << std::endl;
+}
+
+// 回显，数据包直接从接收缓存发送
+static FCoTask Echo(CCoConnection n_Conn)
+{
+	while (auto Frame = co_await n_Conn.ReadFrame())
+	{
+		if (co_await n_Conn.Send(Frame.Data, Frame.nSize) < 0) break;
+	}
+}
+
+// 每个连接一个应用线程，回调线程通过条件变量交回应答
+static void RunThreads(const FOptions& n_Options, FResult& n_Result)
+{
+	struct FWaiter
+	{
+		std::mutex		Mutex;
+		std::condition_variable Cond;
+		bool			bReply = false;
+	};
+
+	CTinyClientPool Pool;
+	Pool.Init(ENetType::TCP, HOST, PORT);
+
+	std::vector<FWaiter> vecWaiters(n_Options.nClients);
+	Pool.fnRecvCallback = [&](FNetNode* n_pNetNode, const char*, int) {
+		auto pWaiter = (FWaiter*)n_pNetNode->UserData;
+		if (!pWaiter) return;
+
+		std::unique_lock<std::mutex> lock(pWaiter->Mutex);
+		pWaiter->bReply = true;
+		pWaiter->Cond.notify_one();
+	};
+
+	if (!Pool.Start() || Pool.Connect(n_Options.nClients) != n_Options.nClients) return;
+	while ((int)Pool.GetConnectionCount() < n_Options.nClients)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+	auto vecNodes = Pool.GetConnections();
+	for (size_t i = 0; i < vecNodes.size(); i++) vecNodes[i]->UserData = &vecWaiters[i];
+
+	auto nEnd = NowNs() + n_Options.nSeconds * 1000000000ull;
+	std::vector<std::thread> vecThreads;
+	for (size_t i = 0; i < vecNodes.size(); i++)
+	{
+		vecThreads.emplace_back([&, i]() {
+			std::string sData((size_t)n_Options.nSize, 'x');
+			auto& Waiter = vecWaiters[i];
+			CLatencyHistogram Latency;
+			unsigned long long nMsgs = 0;
+
+			for (auto nStart = NowNs(); nStart < nEnd; nStart = NowNs())
+			{
+				if (vecNodes[i]->Send(sData) <= 0) break;
+
+				std::unique_lock<std::mutex> lock(Waiter.Mutex);
+				if (!Waiter.Cond.wait_for(lock, std::chrono::seconds(1), [&]() { return Waiter.bReply; })) break;
+				Waiter.bReply = false;
+
+				Latency.Record(NowNs() - nStart);
+				nMsgs++;
+			}
+
+			n_Result.Merge(nMsgs, Latency);
+		});
+	}
+
+	for (auto& Thread : vecThreads) Thread.join();
+	Pool.Stop();
+}
+
+// 每个连接一个协程
+static FCoTask Ping(CCoNet& n_Net, const FOptions& n_Options, const unsigned long long n_nEnd,
+	FResult& n_Result, std::atomic<int>& n_nDone)
+{
+	std::string sData((size_t)n_Options.nSize, 'x');
+	CLatencyHistogram Latency;
+	unsigned long long nMsgs = 0;
+
+	auto Conn = co_await n_Net.Connect();
+	for (auto nStart = NowNs(); Conn && nStart < n_nEnd; nStart = NowNs())
+	{
+		if (co_await Conn.Send(sData) <= 0) break;
+		if (!co_await Conn.ReadFrame()) break;
+
+		Latency.Record(NowNs() - nStart);
+		nMsgs++;
+	}
+
+	n_Result.Merge(nMsgs, Latency);
+	n_nDone++;
+}
+
+static void RunCoroutines(const FOptions& n_Options, FResult& n_Result)
+{
+	CTinyClientPool Pool;
+	Pool.Init(ENetType::TCP, HOST, PORT);
+	if (!Pool.Start()) return;
+
+	std::atomic<int> nDone(0);
+	{
+		CCoNet Net(Pool);
+
+		auto nEnd = NowNs() + n_Options.nSeconds * 1000000000ull;
+		for (int i = 0; i < n_Options.nClients; i++) Ping(Net, n_Options, nEnd, n_Result, nDone);
+
+		while (nDone < n_Options.nClients) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		Pool.Stop();
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	FOptions Options;
+	if (argc > 1) Options.nClients = std::max(1, atoi(argv[1]));
+	if (argc > 2) Options.nSize = std::max(1, atoi(argv[2]));
+	if (argc > 3) Options.nSeconds = std::max(1, atoi(argv[3]));
+
+	CLogger::SetLevel(ELogLevel::Warn);
+
+	CTinyServer Server;
+	Server.Init(ENetType::TCP, HOST, PORT);
+
+	CCoNet ServerNet(Server);
+	ServerNet.fnAccept = Echo;
+	if (!Server.Start())
+	{
+		std::cerr << "start server failed" << std::endl;
+		return 1;
+	}
+
+	std::cout << "clients " << Options.nClients << "  size " << Options.nSize
+		<< "  seconds " << Options.nSeconds << std::endl;
+
+	FResult Threads;
+	RunThreads(Options, Threads);
+	Print("thread", Threads, Options.nSeconds);
+
+	FResult Coroutines;
+	RunCoroutines(Options, Coroutines);
+	Print("coroutine", Coroutines, Options.nSeconds);
+
+	Server.Stop();
+	return 0;
+}
@@ -0,0 +1,278 @@
+﻿// FrameBench.cpp: 分帧层的微基准测试，不使用 Socket
+// 向 ITinyNet::ReceiveTcpMessage 输入合成的数据流，统计每个数据包的耗时及复制的字节数：
+// 大量小数据包、在每个字节偏移(含数据头内)拆分的数据包、1MB~64MB 的大数据包；
+// 并测试 FNetBuffer 的构造、复制及 Alloc 开销；
+// 每项计时后校验数据包数量，并以一轮不计时的输入校验数据包内容，不一致时返回非 0
+//
+// 用法: FrameBench [每项最少运行时长=200 毫秒]
+
+#include "TinyNet.h"
+#include <string.h>
+#include <stdlib.h>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+
+using namespace tinynet;
+
+// 数据头长度(数据包总长度 + 事件Id)
+constexpr size_t kHeaderSize = 8;
+// 大数据包按常见的接收缓存长度分段输入
+constexpr size_t kReadSize = 64 * 1024;
+
+typedef std::chrono::steady_clock FClock;
+
+static int g_nMinMs = 200;
+// 校验失败的次数
+static int g_nFailed = 0;
+
+// 数据内容的 FNV-1a 哈希，字节错位、截断均会改变结果
+static unsigned long long Checksum(const char* n_szData, const size_t n_nSize)
+{
+	unsigned long long nHash = 14695981039346656037ull;
+	for (size_t i = 0; i < n_nSize; i++)
+	{
+		nHash ^= (unsigned char)n_szData[i];
+		nHash *= 1099511628211ull;
+	}
+	return nHash;
+}
+
+// 直接调用分帧接口，统计回调的数据包
+class CFrameSink : public ITinyNet
+{
+public:
+	CFrameSink()
+	{
+		Init(ENetType::TCP, "127.0.0.1", 0);
+		fnRecvCallback = [this](FNetNode*, const char* n_szData, int n_nSize) {
+			m_nFrames++;
+			if (m_bVerify) m_nChecksum += Checksum(n_szData, (size_t)n_nSize);
+			// 不在本次输入范围内的数据来自缓存，即被复制过
+			if (n_szData < m_szInput || n_szData + n_nSize > m_szInput + m_nInput)
+				m_nCopied += n_nSize + kHeaderSize;
+		};
+	}
+
+	void Feed(const char* n_szData, const size_t n_nSize)
+	{
+		m_szInput = n_szData;
+		m_nInput = n_nSize;
+		ReceiveTcpMessage(this, m_sCache, n_szData, (int)n_nSize);
+	}
+
+	void Reset()
+	{
+		m_nFrames = 0;
+		m_nCopied = 0;
+		m_nChecksum = 0;
+		m_sCache.clear();
+	}
+
+	unsigned long long	m_nFrames = 0;
+	unsigned long long	m_nCopied = 0;
+	// 校验时累加每个数据包的哈希，计时时不计算
+	unsigned long long	m_nChecksum = 0;
+	bool				m_bVerify = false;
+
+protected:
+	std::string			m_sCache;
+	const char*			m_szInput = nullptr;
+	size_t				m_nInput = 0;
+};
+
+// 生成数据包(数据头+数据)，数据不可为空，各字节按位置变化
+static std::string MakeFrame(const size_t n_nPayload)
+{
+	std::string sPayload(n_nPayload, 'x');
+	for (size_t i = 0; i < n_nPayload; i++) sPayload[i] = (char)(i * 131 + n_nPayload);
+
+	FNetBuffer NetBuffer;
+	NetBuffer.SetData(sPayload);
+	return std::string(NetBuffer.Buffer, NetBuffer.nLength);
+}
+
+static void Print(const std::string& n_sName, const double n_dNs, const unsigned long long n_nFrames,
+	const unsigned long long n_nCopied, const unsigned long long n_nBytes)
+{
+	auto nFrames = n_nFrames > 0 ? n_nFrames : 1;
+
+	std::cout << std::left << std::setw(36) << n_sName << std::right << std::fixed
+		<< std::setprecision(1) << std::setw(12) << n_dNs / nFrames << " ns/frame"
+		<< std::setprecision(0) << std::setw(12) << (double)n_nCopied / nFrames << " B copied/frame"
+		<< std::setprecision(1) << std::setw(10) << (n_dNs > 0 ? n_nBytes / n_dNs * 1e3 : 0) << " MB/s"
+		<< std::endl;
+}
+
+static void Expect(const std::string& n_sName, const char* n_szWhat,
+	const unsigned long long n_nActual, const unsigned long long n_nExpected)
+{
+	if (n_nActual == n_nExpected) return;
+
+	std::cerr << n_sName << ": " << n_szWhat << " " << n_nActual << ", expected " << n_nExpected << std::endl;
+	g_nFailed++;
+}
+
+// 校验计时输入的数据包数量，再执行一轮 n_fnRound 校验数据包内容
+static void Verify(const std::string& n_sName, CFrameSink& n_Sink, const std::function<void()>& n_fnRound,
+	const unsigned long long n_nRounds, const unsigned long long n_nFrames, const std::string& n_sFrame)
+{
+	Expect(n_sName, "frames", n_Sink.m_nFrames, n_nRounds * n_nFrames);
+
+	n_Sink.Reset();
+	n_Sink.m_bVerify = true;
+	n_fnRound();
+	n_Sink.m_bVerify = false;
+
+	Expect(n_sName, "verified frames", n_Sink.m_nFrames, n_nFrames);
+	Expect(n_sName, "checksum", n_Sink.m_nChecksum,
+		n_nFrames * Checksum(n_sFrame.data() + kHeaderSize, n_sFrame.size() - kHeaderSize));
+}
+
+// 重复执行 n_fnRound 直到达到最少运行时长，返回总耗时(纳秒)及轮数
+static double Repeat(const std::function<void()>& n_fnRound, unsigned long long& n_nRounds)
+{
+	n_nRounds = 0;
+	auto Start = FClock::now();
+	double dNs = 0;
+
+	do
+	{
+		n_fnRound();
+		n_nRounds++;
+		dNs = std::chrono::duration<double, std::nano>(FClock::now() - Start).count();
+	} while (dNs < g_nMinMs * 1e6);
+
+	return dNs;
+}
+
+// 一次输入包含大量小数据包
+static void BenchTinyFrames(const size_t n_nPayload)
+{
+	auto sFrame = MakeFrame(n_nPayload);
+	std::string sStream;
+	while (sStream.size() + sFrame.size() <= kReadSize) sStream += sFrame;
+
+	CFrameSink Sink;
+	unsigned long long nRounds = 0;
+	auto fnRound = [&]() { Sink.Feed(sStream.data(), sStream.size()); };
+	auto dNs = Repeat(fnRound, nRounds);
+
+	auto nFrames = sStream.size() / sFrame.size();
+	auto sName = "tiny " + std::to_string(n_nPayload) + "B x" + std::to_string(nFrames) + "/read";
+	Print(sName, dNs, Sink.m_nFrames, Sink.m_nCopied, nRounds * sStream.size());
+	Verify(sName, Sink, fnRound, nRounds, nFrames, sFrame);
+}
+
+// 两个连续的数据包在每个字节偏移处拆分为两次输入，包括数据头内部
+static void BenchSplitFrames(const size_t n_nPayload)
+{
+	auto sFrame = MakeFrame(n_nPayload);
+	auto sStream = sFrame + sFrame;
+
+	CFrameSink Sink;
+	unsigned long long nRounds = 0;
+	auto fnEvery = [&]() {
+		for (size_t i = 1; i < sFrame.size(); i++)
+		{
+			Sink.Feed(sStream.data(), i);
+			Sink.Feed(sStream.data() + i, sStream.size() - i);
+		}
+	};
+	auto dNs = Repeat(fnEvery, nRounds);
+
+	auto sName = "split " + std::to_string(n_nPayload) + "B at every offset";
+	Print(sName, dNs, Sink.m_nFrames, Sink.m_nCopied, nRounds * (sFrame.size() - 1) * sStream.size());
+	Verify(sName, Sink, fnEvery, nRounds, 2 * (sFrame.size() - 1), sFrame);
+
+	// 只在数据头内拆分
+	Sink.Reset();
+	auto fnHeader = [&]() {
+		for (size_t i = 1; i < kHeaderSize; i++)
+		{
+			Sink.Feed(sStream.data(), i);
+			Sink.Feed(sStream.data() + i, sStream.size() - i);
+		}
+	};
+	dNs = Repeat(fnHeader, nRounds);
+
+	sName = "split " + std::to_string(n_nPayload) + "B inside header";
+	Print(sName, dNs, Sink.m_nFrames, Sink.m_nCopied, nRounds * (kHeaderSize - 1) * sStream.size());
+	Verify(sName, Sink, fnHeader, nRounds, 2 * (kHeaderSize - 1), sFrame);
+}
+
+// 大数据包按接收缓存长度分段输入，n_nSize 为数据包总长度(含数据头)
+static void BenchLargeFrame(const size_t n_nSize)
+{
+	auto sFrame = MakeFrame(n_nSize - kHeaderSize);
+
+	CFrameSink Sink;
+	unsigned long long nRounds = 0;
+	auto fnRound = [&]() {
+		for (size_t nOffset = 0; nOffset < sFrame.size(); nOffset += kReadSize)
+			Sink.Feed(sFrame.data() + nOffset, std::min(kReadSize, sFrame.size() - nOffset));
+	};
+	auto dNs = Repeat(fnRound, nRounds);
+
+	auto sName = "large " + std::to_string(n_nSize >> 20) + "MB in 64KB reads";
+	Print(sName, dNs, Sink.m_nFrames, Sink.m_nCopied, nRounds * sFrame.size());
+	Verify(sName, Sink, fnRound, nRounds, 1, sFrame);
+}
+
+// FNetBuffer 构造、复制及 Alloc 的开销
+static void BenchNetBuffer(const size_t n_nSize)
+{
+	std::string sData(n_nSize, 'x');
+	volatile size_t nSink = 0;
+	unsigned long long nRounds = 0;
+	auto sSize = std::to_string(n_nSize) + "B";
+
+	auto dNs = Repeat([&]() {
+		FNetBuffer NetBuffer(sData);
+		nSink = nSink + NetBuffer.nLength;
+	}, nRounds);
+	FNetBuffer Source(sData);
+	Print("FNetBuffer construct " + sSize, dNs, nRounds, nRounds * n_nSize, nRounds * n_nSize);
+
+	dNs = Repeat([&]() {
+		FNetBuffer NetBuffer(Source);
+		nSink = nSink + NetBuffer.nLength;
+	}, nRounds);
+	Print("FNetBuffer copy " + sSize, dNs, nRounds, nRounds * Source.nLength, nRounds * n_nSize);
+
+	dNs = Repeat([&]() {
+		FNetBuffer NetBuffer;
+		NetBuffer.Alloc(n_nSize);
+		nSink = nSink + NetBuffer.nCapacity;
+	}, nRounds);
+	Print("FNetBuffer Alloc " + sSize, dNs, nRounds, 0, nRounds * n_nSize);
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc > 1) g_nMinMs = std::max(1, atoi(argv[1]));
+
+	BenchTinyFrames(1);
+	BenchTinyFrames(16);
+	BenchTinyFrames(256);
+
+	BenchSplitFrames(64);
+	BenchSplitFrames(1024);
+
+	BenchLargeFrame(1 << 20);
+	BenchLargeFrame(8 << 20);
+	// 数据包上限为 64MB(含数据头)
+	BenchLargeFrame(64 << 20);
+
+	BenchNetBuffer(64);
+	BenchNetBuffer(4096);
+	BenchNetBuffer(65536);
+
+	if (g_nFailed)
+	{
+		std::cerr << g_nFailed << " check(s) failed" << std::endl;
+		return 1;
+	}
+	return 0;
+}
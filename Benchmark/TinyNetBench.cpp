@@ -0,0 +1,324 @@
+﻿// TinyNetBench.cpp: 回环地址上的吞吐量及延时测试
+// TCP/UDP: 服务端回显，客户端在消息前 8 字节写入发送时间，收到回显时记录往返延时；
+// 组播: 接收端记录单向延时；延时记录在 HDR 风格的直方图中
+// TCP 分别测试 ET/LT 模式及不同的接收缓存长度
+//
+// 用法: tinynet_bench [协议=all(tcp|udp|multicast|all)] [连接数=4] [消息长度=64] [每连接速率=0(不限) 条/秒] [时长=3 秒]
+
+#include "TinyNet.h"
+#include "LatencyTrace.h"
+#include <string.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <iomanip>
+#include <iostream>
+
+using namespace tinynet;
+
+#define HOST "127.0.0.1"
+#define PORT 8300
+#define MULTICAST "239.0.0.1"
+
+// 每个连接未收到回显的最大消息数，避免发送速度超过处理速度时队列无限增长
+constexpr unsigned long long kWindow = 64;
+// 预热时长(毫秒)，期间发送的消息不计入结果
+constexpr int kWarmupMs = 200;
+// 窗口已满且超过该时长(纳秒)未收到回显，视为 UDP 丢包
+constexpr unsigned long long kStallNs = 100000000ull;
+
+typedef std::chrono::steady_clock FClock;
+
+struct FOptions
+{
+	std::string		sProtocol = "all";
+	int				nClients = 4;
+	int				nSize = 64;
+	// 每个连接每秒发送的消息数，0 表示不限
+	int				nRate = 0;
+	int				nSeconds = 3;
+};
+
+struct FResult
+{
+	// 计入结果的消息数及数据长度
+	unsigned long long	nMsgs = 0;
+	unsigned long long	nBytes = 0;
+	unsigned long long	nLost = 0;
+	double				dSeconds = 0;
+	CLatencyHistogram	Latency;
+};
+
+// 计入结果的发送时间范围(纳秒)
+static std::atomic<unsigned long long> g_nMeasureStart{ ~0ull };
+static std::atomic<unsigned long long> g_nMeasureEnd{ ~0ull };
+static unsigned short g_nPort = PORT;
+
+static unsigned long long NowNs()
+{
+	return (unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		FClock::now().time_since_epoch()).count();
+}
+
+// 统计一条带发送时间的消息，在接收线程调用
+static void Measure(CLatencyHistogram& n_Latency, std::atomic<unsigned long long>& n_nMsgs,
+	std::atomic<unsigned long long>& n_nBytes, const char* n_szData, const int n_nSize)
+{
+	if (n_nSize < (int)sizeof(unsigned long long)) return;
+
+	unsigned long long nSent = 0;
+	memcpy(&nSent, n_szData, sizeof(nSent));
+	if (nSent < g_nMeasureStart || nSent >= g_nMeasureEnd) return;
+
+	n_Latency.Record(NowNs() - nSent);
+	n_nMsgs++;
+	n_nBytes += n_nSize;
+}
+
+static void Print(const std::string& n_sName, const FResult& n_Result)
+{
+	auto dSeconds = n_Result.dSeconds > 0 ? n_Result.dSeconds : 1;
+	auto& Latency = n_Result.Latency;
+
+	std::cout << std::left << std::setw(24) << n_sName << std::right << std::fixed
+		<< std::setprecision(0) << std::setw(10) << n_Result.nMsgs / dSeconds << " msgs/s"
+		<< std::setprecision(2) << std::setw(9) << n_Result.nBytes / dSeconds / 1e6 << " MB/s"
+		<< std::setprecision(1)
+		<< "  p50 " << std::setw(7) << Latency.Percentile(50) / 1e3
+		<< "  p99 " << std::setw(7) << Latency.Percentile(99) / 1e3
+		<< "  p99.9 " << std::setw(7) << Latency.Percentile(99.9) / 1e3
+		<< "  max " << std::setw(8) << Latency.Max() / 1e3 << " us";
+	if (n_Result.nLost > 0) std::cout << "  lost " << n_Result.nLost;
+	std::cout << std::endl;
+}
+
+// 按速率发送，n_fnInflight 返回未收到回显的消息数，为空则不限制
+static unsigned long long SendLoop(const FOptions& n_Options, const std::atomic<bool>& n_bStop,
+	const std::function<int(const std::string&)>& n_fnSend,
+	const std::function<unsigned long long()>& n_fnInflight)
+{
+	std::string sData((size_t)n_Options.nSize, 'x');
+	auto nInterval = n_Options.nRate > 0 ? 1000000000ull / n_Options.nRate : 0;
+	auto nNext = NowNs();
+	unsigned long long nLost = 0, nStall = 0;
+
+	while (!n_bStop)
+	{
+		auto nNow = NowNs();
+		if (nInterval > 0)
+		{
+			if (nNow < nNext)
+			{
+				std::this_thread::sleep_for(std::chrono::nanoseconds(std::min(nNext - nNow, 1000000ull)));
+				continue;
+			}
+			nNext += nInterval;
+		}
+
+		if (n_fnInflight && n_fnInflight() - nLost >= kWindow)
+		{
+			if (nStall == 0) nStall = nNow;
+			else if (nNow - nStall > kStallNs)
+			{
+				nLost = n_fnInflight();
+				nStall = 0;
+			}
+			std::this_thread::yield();
+			continue;
+		}
+		nStall = 0;
+
+		memcpy(&sData[0], &nNow, sizeof(nNow));
+		if (n_fnSend(sData) <= 0) break;
+	}
+
+	return nLost;
+}
+
+struct FBenchClient
+{
+	CTinyClient		Client;
+	CLatencyHistogram	Latency;
+	std::atomic<unsigned long long> nSent{ 0 };
+	std::atomic<unsigned long long> nRecv{ 0 };
+	std::atomic<unsigned long long> nMsgs{ 0 };
+	std::atomic<unsigned long long> nBytes{ 0 };
+	unsigned long long nLost = 0;
+	std::thread		Sender;
+};
+
+// 开始计时，等待预热及测试时长后结束，返回计入结果的时长(秒)
+static double RunFor(const FOptions& n_Options)
+{
+	auto nStart = NowNs() + kWarmupMs * 1000000ull;
+	g_nMeasureEnd = ~0ull;
+	g_nMeasureStart = nStart;
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(kWarmupMs + n_Options.nSeconds * 1000));
+
+	auto nEnd = NowNs();
+	g_nMeasureEnd = nEnd;
+	return (nEnd - nStart) / 1e9;
+}
+
+static void RunEcho(const std::string& n_sName, const ENetType n_eType,
+	const FOptions& n_Options, const bool n_bEt, const int n_nRecvBuff)
+{
+	auto nPort = g_nPort++;
+	// UDP 消息不可超过接收缓存
+	auto nRecvBuff = std::max(n_nRecvBuff, n_Options.nSize + 64);
+
+	CTinyServer Server;
+	Server.Init(n_eType, HOST, nPort);
+	Server.SetEt(n_bEt);
+	Server.SetRecvBuffSize(nRecvBuff);
+	Server.fnRecvCallback = [](FNetNode* n_pNetNode, const char* n_szData, int n_nSize) {
+		n_pNetNode->Send(n_szData, n_nSize);
+	};
+	if (!Server.Start())
+	{
+		std::cout << n_sName << ": server start error" << std::endl;
+		return;
+	}
+
+	std::vector<std::unique_ptr<FBenchClient>> vecClients;
+	for (int i = 0; i < n_Options.nClients; i++)
+	{
+		auto pClient = new FBenchClient;
+		vecClients.emplace_back(pClient);
+
+		pClient->Client.Init(n_eType, HOST, nPort);
+		pClient->Client.SetRecvBuffSize(nRecvBuff);
+		pClient->Client.fnRecvCallback = [pClient](FNetNode*, const char* n_szData, int n_nSize) {
+			pClient->nRecv++;
+			Measure(pClient->Latency, pClient->nMsgs, pClient->nBytes, n_szData, n_nSize);
+		};
+
+		if (!pClient->Client.Start())
+		{
+			std::cout << n_sName << ": client start error" << std::endl;
+			return;
+		}
+	}
+
+	// 等待 UDP 会话建立
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+	std::atomic<bool> bStop{ false };
+	for (auto& pClient : vecClients)
+	{
+		auto p = pClient.get();
+		p->Sender = std::thread([p, &n_Options, &bStop]() {
+			p->nLost = SendLoop(n_Options, bStop,
+				[p](const std::string& n_sData) {
+					p->nSent++;
+					return p->Client.Send(n_sData);
+				},
+				[p]() { return p->nSent - p->nRecv; });
+		});
+	}
+
+	FResult Result;
+	Result.dSeconds = RunFor(n_Options);
+
+	bStop = true;
+	for (auto& pClient : vecClients) pClient->Sender.join();
+
+	// 等待已发送的消息回显
+	std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+	for (auto& pClient : vecClients)
+	{
+		pClient->Client.Stop();
+		Result.Latency.Merge(pClient->Latency);
+		Result.nMsgs += pClient->nMsgs;
+		Result.nBytes += pClient->nBytes;
+		Result.nLost += pClient->nSent - pClient->nRecv;
+	}
+	Server.Stop();
+
+	Print(n_sName, Result);
+}
+
+static void RunMulticast(const FOptions& n_Options)
+{
+	auto nPort = g_nPort++;
+
+	CLatencyHistogram Latency;
+	std::atomic<unsigned long long> nMsgs{ 0 }, nBytes{ 0 };
+
+	// Release 等待接收线程退出，回调引用的局部变量在此之后析构
+	CMulticast Receiver;
+	Receiver.Init(MULTICAST, nPort);
+	Receiver.SetRecvBuffSize(std::max(1024, n_Options.nSize + 64));
+	Receiver.fnRecvCallback = [&](const char* n_szData, int n_nSize) {
+		Measure(Latency, nMsgs, nBytes, n_szData, n_nSize);
+	};
+	if (Receiver.Receiver() < 0)
+	{
+		std::cout << "multicast: receiver error" << std::endl;
+		return;
+	}
+
+	CMulticast Sender;
+	Sender.Init(MULTICAST, nPort);
+	Sender.Sender();
+
+	std::atomic<bool> bStop{ false };
+	std::thread Thread([&]() {
+		SendLoop(n_Options, bStop,
+			[&](const std::string& n_sData) { return Sender.Send(n_sData); },
+			nullptr);
+	});
+
+	FResult Result;
+	Result.dSeconds = RunFor(n_Options);
+
+	bStop = true;
+	Thread.join();
+	std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+	Receiver.Release();
+	Sender.Release();
+
+	Result.Latency.Merge(Latency);
+	Result.nMsgs = nMsgs;
+	Result.nBytes = nBytes;
+
+	if (Result.nMsgs == 0) std::cout << "multicast: no data received (no multicast route?)" << std::endl;
+	else Print("multicast (one-way)", Result);
+}
+
+int main(int argc, char* argv[])
+{
+	FOptions Options;
+	if (argc > 1) Options.sProtocol = argv[1];
+	if (argc > 2) Options.nClients = std::max(1, atoi(argv[2]));
+	if (argc > 3) Options.nSize = std::max((int)sizeof(unsigned long long), atoi(argv[3]));
+	if (argc > 4) Options.nRate = std::max(0, atoi(argv[4]));
+	if (argc > 5) Options.nSeconds = std::max(1, atoi(argv[5]));
+
+	auto bAll = Options.sProtocol == "all";
+
+	std::cout << "clients " << Options.nClients << ", payload " << Options.nSize << " bytes, rate "
+		<< (Options.nRate > 0 ? std::to_string(Options.nRate) + " msgs/s" : std::string("unlimited"))
+		<< " per client, " << Options.nSeconds << " s" << std::endl;
+
+	if (bAll || Options.sProtocol == "tcp")
+	{
+		RunEcho("tcp et  buff 1024", ENetType::TCP, Options, true, 1024);
+		RunEcho("tcp lt  buff 1024", ENetType::TCP, Options, false, 1024);
+		RunEcho("tcp et  buff 16384", ENetType::TCP, Options, true, 16384);
+		RunEcho("tcp lt  buff 16384", ENetType::TCP, Options, false, 16384);
+		RunEcho("tcp et  buff 65536", ENetType::TCP, Options, true, 65536);
+	}
+
+	if (bAll || Options.sProtocol == "udp")
+		RunEcho("udp", ENetType::UDP, Options, true, 1024);
+
+	if (bAll || Options.sProtocol == "multicast")
+		RunMulticast(Options);
+
+	return 0;
+}
@@ -58,6 +58,14 @@ int main()
 		case ENetEvent::Quit:
 			cout << "Socket Quit: " << pNode->ToString() << endl;
 			break;
+		case ENetEvent::Reconnect:
+		{
+			auto p = (unsigned int*)s.data();
+			cout << "Reconnect: " << pNode->ToString() << ": [" << p[0] << ":" << p[1] << "]" << endl;
+		}
+			break;
+		default:
+			break;
 		}
 	};
 
@@ -72,6 +72,14 @@ int main()
 		case ENetEvent::Quit:
 			cout << "Socket Quit: " << pNode->ToString() << endl;
 			break;
+		case ENetEvent::Unwritable:
+			cout << "Socket Unwritable: " << pNode->ToString() << endl;
+			break;
+		case ENetEvent::Writable:
+			cout << "Socket Writable: " << pNode->ToString() << endl;
+			break;
+		default:
+			break;
 		}
 	};
 
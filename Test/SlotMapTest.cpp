@@ -0,0 +1,91 @@
+// SlotMapTest.cpp: CSlotMap 的 Id 校验
+// 失败时输出所在行并返回非 0
+
+#include "SlotMap.h"
+#include <iostream>
+
+using namespace tinynet;
+
+static int g_nFailed = 0;
+
+#define CHECK(expr) \
+	do { if (!(expr)) { std::cerr << __LINE__ << ": " << #expr << std::endl; g_nFailed++; } } while (0)
+
+typedef CSlotMap<int> FMap;
+
+static FMap::Id MakeId(const unsigned int n_nGeneration, const unsigned int n_nSlot)
+{
+	return ((FMap::Id)n_nGeneration << 32) | n_nSlot;
+}
+
+// 已删除元素的 Id 不再命中，复用槽位后新 Id 命中新元素
+static void TestErase()
+{
+	FMap Map;
+	auto a = Map.Insert(1);
+	auto b = Map.Insert(2);
+
+	CHECK(Map.Erase(a));
+	CHECK(!Map.Find(a));
+	CHECK(!Map.Erase(a));
+	CHECK(Map.Find(b) && *Map.Find(b) == 2);
+
+	auto c = Map.Insert(3);
+	CHECK(c != a);
+	CHECK(!Map.Find(a));
+	CHECK(Map.Find(c) && *Map.Find(c) == 3);
+}
+
+// 未分配过的 Id：空闲槽位的版本号已递增，与其下次分配的 Id 相同
+static void TestNeverIssued()
+{
+	FMap Map;
+	auto a = Map.Insert(1);
+	Map.Insert(2);
+	Map.Erase(a);
+
+	CHECK(!Map.Find(MakeId(2, 0)));
+	CHECK(!Map.Contains(MakeId(2, 0)));
+	CHECK(!Map.Erase(MakeId(2, 0)));
+	CHECK(Map.Size() == 1);
+
+	// 两个空闲槽位，链表指向另一个空闲槽位
+	auto b = Map.Insert(3);
+	Map.Erase(MakeId(1, 1));
+	Map.Erase(b);
+	CHECK(Map.Empty());
+	CHECK(!Map.Find(MakeId(2, 1)));
+	CHECK(!Map.Find(MakeId(3, 0)));
+
+	CHECK(!Map.Find(0));
+	CHECK(!Map.Find(MakeId(1, 100)));
+}
+
+// 清空后之前的 Id 不再命中
+static void TestClear()
+{
+	FMap Map;
+	auto a = Map.Insert(1);
+	auto b = Map.Insert(2);
+	Map.Clear();
+
+	CHECK(Map.Empty());
+	CHECK(!Map.Find(a));
+	CHECK(!Map.Find(b));
+
+	auto c = Map.Insert(3);
+	CHECK(c != a && c != b);
+	CHECK(Map.Find(c) && *Map.Find(c) == 3);
+	// 另一个槽位仍空闲，只有一个 Id 命中
+	CHECK((Map.Find(MakeId(2, 0)) != nullptr) + (Map.Find(MakeId(2, 1)) != nullptr) == 1);
+}
+
+int main()
+{
+	TestErase();
+	TestNeverIssued();
+	TestClear();
+
+	if (g_nFailed) std::cerr << g_nFailed << " check(s) failed" << std::endl;
+	return g_nFailed ? 1 : 0;
+}
@@ -0,0 +1,60 @@
+#ifndef __BUFFERPOOL_H__
+#define __BUFFERPOOL_H__
+#include <cstddef>
+
+namespace tinynet
+{
+	// 内存池统计
+	struct FBufferPoolStats
+	{
+		// 从线程缓存或全局缓存分配的次数
+		unsigned long long nHits = 0;
+		// 缓存为空，从系统分配的次数
+		unsigned long long nMisses = 0;
+		// 超出最大规格，直接从系统分配的次数
+		unsigned long long nOversize = 0;
+		// 释放回缓存的次数
+		unsigned long long nRecycled = 0;
+		// 缓存已满，释放回系统的次数
+		unsigned long long nReleased = 0;
+
+		// 命中率
+		const double HitRate() const
+		{
+			auto nTotal = nHits + nMisses + nOversize;
+			return nTotal > 0 ? (double)nHits / nTotal : 0;
+		}
+	};
+
+	/// <summary>
+	/// 按规格分级的内存池，每个线程有独立缓存
+	/// </summary>
+	/// 规格为 2 的幂，64 字节 ~ 1M，超出最大规格直接使用 malloc/free；
+	/// 线程缓存为空时从全局缓存批量获取，已满时批量归还全局缓存
+	class CBufferPool
+	{
+	public:
+		/// <summary>
+		/// 分配内存
+		/// </summary>
+		/// <param name="n_nSize">需要的长度</param>
+		/// <param name="n_nCapacity">返回实际容量，释放时需传入</param>
+		/// <returns></returns>
+		static char* Alloc(const size_t n_nSize, size_t& n_nCapacity);
+
+		/// <summary>
+		/// 释放内存，可在任意线程释放
+		/// </summary>
+		/// <param name="n_szBuffer">Alloc 返回的地址</param>
+		/// <param name="n_nCapacity">Alloc 返回的容量</param>
+		static void Free(char* n_szBuffer, const size_t n_nCapacity);
+
+		// 获取统计
+		static FBufferPoolStats GetStats();
+
+		// 释放全局缓存中的空闲内存
+		static void Trim();
+	};
+}
+
+#endif // !__BUFFERPOOL_H__
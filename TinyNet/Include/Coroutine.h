@@ -0,0 +1,629 @@
+#ifndef __COROUTINE_H__
+#define __COROUTINE_H__
+// C++20 协程接口，只有头文件，核心库仍为 C++11；
+// 需以 C++20 编译，CMake 中启用 TINYNET_COROUTINE 选项并链接 TinyNetCoro
+#include "TinyNet.h"
+
+#if !defined(__cpp_impl_coroutine) || __cpp_impl_coroutine < 201902L
+#error "Coroutine.h requires C++20 coroutines: enable TINYNET_COROUTINE and link TinyNetCoro"
+#else
+#include <coroutine>
+#include <exception>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <unordered_map>
+
+namespace tinynet
+{
+	/// <summary>
+	/// 协程任务
+	/// </summary>
+	/// 调用后立即执行到第一次挂起，结束时自动释放；未捕获的异常终止程序
+	struct FCoTask
+	{
+		struct promise_type
+		{
+			FCoTask get_return_object() noexcept { return {}; }
+			std::suspend_never initial_suspend() noexcept { return {}; }
+			std::suspend_never final_suspend() noexcept { return {}; }
+			void return_void() noexcept {}
+			void unhandled_exception() noexcept { std::terminate(); }
+		};
+	};
+
+	// 收到的数据包(去除数据头)，连接关闭时为空
+	struct FCoFrame
+	{
+		const char*	Data = nullptr;
+		int			nSize = 0;
+
+		explicit operator bool() const { return Data != nullptr; }
+		std::string_view View() const { return std::string_view(Data, Data ? nSize : 0); }
+	};
+
+	class CCoNet;
+
+	// 连接的协程状态，受 Mutex 保护；持有 Mutex 且 NetNode 不为空时连接不会释放
+	struct FCoState
+	{
+		CCoNet*			Owner = nullptr;
+		// 连接关闭后为空
+		FNetNode*		NetNode = nullptr;
+		unsigned long long nId = 0;
+
+		// 发送时可能在当前线程触发事件回调，可重入
+		std::recursive_mutex Mutex;
+		bool			bClosed = false;
+		// 等待数据包、等待可写的协程
+		std::coroutine_handle<> hRead;
+		std::coroutine_handle<> hWrite;
+		// 回调时直接交给等待的协程，指向接收缓存
+		FCoFrame		Direct;
+		// 没有协程等待时复制的数据包
+		std::deque<std::string> Frames;
+		// 交给协程的复制的数据包
+		std::string		sCurrent;
+		// 复制的数据包过多，已暂停读取
+		bool			bPaused = false;
+	};
+
+	/// <summary>
+	/// 协程中使用的连接
+	/// </summary>
+	/// 复制开销很小，协程持有时连接关闭后仍可安全调用(读取返回空数据包，发送返回 -1)；
+	/// 每个连接同时只能有一个协程等待读取、一个协程等待发送
+	class CCoConnection
+	{
+	public:
+		CCoConnection() = default;
+
+		explicit operator bool() const { return m_pState != nullptr; }
+		// 连接节点，连接关闭后为空
+		FNetNode* GetNode() const;
+		const bool IsClosed() const;
+
+		/// <summary>
+		/// 读取一个数据包
+		/// </summary>
+		/// 已有复制的数据包时直接返回；否则挂起，收到数据包时在连接的回调线程恢复，
+		/// 数据包不复制，指向接收缓存，在协程下一次挂起前有效，需跨越挂起时由调用者复制；
+		/// 连接关闭时返回空数据包
+		auto ReadFrame();
+
+		/// <summary>
+		/// 发送消息
+		/// </summary>
+		/// 消息立即发送(或进入发送队列)；设置了发送队列的水位且不可写时挂起，可写时在连接的回调线程恢复；
+		/// 返回发送的长度，失败或等待期间连接关闭返回 -1
+		auto Send(const char* n_szData, const int n_nSize);
+		auto Send(const std::string& n_sData);
+
+		/// <summary>
+		/// 延时(毫秒)
+		/// </summary>
+		/// 由共享的定时器线程计时，到期后在连接的回调线程恢复；连接已关闭时在定时器线程恢复；
+		/// CCoNet 析构时取消，协程不再恢复
+		auto Sleep(const unsigned int n_nMilliSeconds);
+
+	protected:
+		explicit CCoConnection(std::shared_ptr<FCoState> n_pState) : m_pState(std::move(n_pState)) {}
+
+		std::shared_ptr<FCoState> m_pState;
+
+		friend class CCoNet;
+	};
+
+	/// <summary>
+	/// 协程适配器，在 ITinyNet 的回调之上提供协程接口
+	/// </summary>
+	/// 接管实例的 fnEventCallback 及 fnRecvCallback，事件仍通过本类的 fnEventCallback 转发；
+	/// 使用连接的 FNetNode::UserData 保存协程状态；协程在连接的回调线程(I/O 线程，启用回调线程时为该连接的回调线程)
+	/// 恢复，不创建线程；需在实例 Stop 后析构，析构时销毁仍在等待读写的协程
+	class CCoNet
+	{
+	public:
+		// 服务端，每个接收的 TCP 连接调用 fnAccept
+		explicit CCoNet(CTinyServer& n_Server) : m_Net(n_Server) { Attach(); }
+#if !defined(_WIN32) && !defined(_WIN64)
+		// 连接池，通过 Connect 建立连接
+		explicit CCoNet(CTinyClientPool& n_Pool) : m_Net(n_Pool), m_pPool(&n_Pool) { Attach(); }
+#endif
+		~CCoNet();
+
+		CCoNet(const CCoNet&) = delete;
+		CCoNet& operator=(const CCoNet&) = delete;
+
+		/// <summary>
+		/// 建立一个连接(仅连接池)
+		/// </summary>
+		/// 挂起直到连接就绪(ENetEvent::Ready)，在该连接的回调线程恢复；失败或连接池停止时返回空连接
+		auto Connect();
+
+		// 复制的数据包达到该数量时暂停读取该连接，降到一半时恢复，默认 64
+		void SetMaxFrames(const size_t n_nMax) { m_nMaxFrames = n_nMax; }
+
+		ITinyNet& Net() const { return m_Net; }
+
+		// 新连接，服务端接收的连接及连接池中不是由 Connect 建立的连接；在连接的回调线程调用
+		std::function<FCoTask(CCoConnection)> fnAccept = nullptr;
+
+		// 事件转发
+		std::function<void(FNetNode*, const ENetEvent, const std::string&)> fnEventCallback = nullptr;
+
+	protected:
+		// 等待连接的协程
+		struct FConnectWaiter
+		{
+			std::coroutine_handle<> Handle;
+			CCoConnection*	Result = nullptr;
+		};
+
+		void Attach()
+		{
+			m_Net.fnEventCallback = [this](FNetNode* n_pNetNode, const ENetEvent n_eNetEvent, const std::string& n_sData) {
+				OnEvent(n_pNetNode, n_eNetEvent, n_sData);
+			};
+			m_Net.fnRecvCallback = [this](FNetNode* n_pNetNode, const char* n_szData, int n_nSize) {
+				OnRecv(n_pNetNode, n_szData, n_nSize);
+			};
+		}
+
+		CCoConnection Open(FNetNode* n_pNetNode);
+		void Close(FNetNode* n_pNetNode);
+		// 恢复一个等待连接的协程，n_pNetNode 为空表示失败
+		bool ResumeConnect(FNetNode* n_pNetNode);
+		// 添加延时，到期时投递到连接 n_nId 的回调线程恢复协程；添加失败返回 false
+		bool AddSleep(const unsigned long long n_nId, const unsigned int n_nDelay, std::coroutine_handle<> n_Handle);
+
+		void OnEvent(FNetNode* n_pNetNode, const ENetEvent n_eNetEvent, const std::string& n_sData);
+		void OnRecv(FNetNode* n_pNetNode, const char* n_szData, int n_nSize);
+		// 协程取出复制的数据包后，降到一半时恢复读取
+		void OnFrameTaken(FCoState& n_State);
+
+	protected:
+		ITinyNet&		m_Net;
+#if !defined(_WIN32) && !defined(_WIN64)
+		CTinyClientPool* m_pPool = nullptr;
+#endif
+		size_t			m_nMaxFrames = 64;
+
+		std::mutex		m_mutex;
+		// 未关闭的连接
+		std::unordered_map<FCoState*, std::shared_ptr<FCoState>> m_States;
+		std::deque<FConnectWaiter> m_Connects;
+		// 等待延时的协程，以序号索引，析构时取消其定时器
+		struct FSleeper
+		{
+			unsigned long long nTimer = 0;
+			std::coroutine_handle<> Handle;
+		};
+		unsigned long long m_nSleepSeq = 0;
+		std::unordered_map<unsigned long long, FSleeper> m_Sleeps;
+
+		friend class CCoConnection;
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+#pragma region 连接
+	inline FNetNode* CCoConnection::GetNode() const
+	{
+		if (!m_pState) return nullptr;
+
+		std::unique_lock<std::recursive_mutex> lock(m_pState->Mutex);
+		return m_pState->NetNode;
+	}
+
+	inline const bool CCoConnection::IsClosed() const
+	{
+		if (!m_pState) return true;
+
+		std::unique_lock<std::recursive_mutex> lock(m_pState->Mutex);
+		return m_pState->bClosed;
+	}
+
+	inline auto CCoConnection::ReadFrame()
+	{
+		struct FAwaiter
+		{
+			FCoState*	pState;
+
+			bool await_ready() const
+			{
+				if (!pState) return true;
+
+				std::unique_lock<std::recursive_mutex> lock(pState->Mutex);
+				return pState->bClosed || !pState->Frames.empty();
+			}
+
+			// 检查后收到的数据包已复制，不挂起
+			bool await_suspend(std::coroutine_handle<> n_Handle)
+			{
+				std::unique_lock<std::recursive_mutex> lock(pState->Mutex);
+				if (pState->bClosed || !pState->Frames.empty()) return false;
+
+				pState->hRead = n_Handle;
+				return true;
+			}
+
+			FCoFrame await_resume()
+			{
+				FCoFrame Frame;
+				if (!pState) return Frame;
+				{
+					std::unique_lock<std::recursive_mutex> lock(pState->Mutex);
+					if (pState->Direct)
+					{
+						Frame = std::exchange(pState->Direct, FCoFrame());
+						return Frame;
+					}
+
+					if (pState->Frames.empty()) return Frame;
+
+					pState->sCurrent = std::move(pState->Frames.front());
+					pState->Frames.pop_front();
+					Frame.Data = pState->sCurrent.data();
+					Frame.nSize = (int)pState->sCurrent.size();
+				}
+
+				pState->Owner->OnFrameTaken(*pState);
+				return Frame;
+			}
+		};
+
+		return FAwaiter{ m_pState.get() };
+	}
+
+	inline auto CCoConnection::Send(const char* n_szData, const int n_nSize)
+	{
+		struct FAwaiter
+		{
+			FCoState*	pState;
+			int			nResult;
+
+			bool await_ready() const
+			{
+				if (nResult < 0) return true;
+
+				std::unique_lock<std::recursive_mutex> lock(pState->Mutex);
+				return pState->bClosed || pState->NetNode->IsWritable();
+			}
+
+			// 可写事件需持有 Mutex 取出等待者，检查时仍不可写则之后的可写事件恢复协程
+			bool await_suspend(std::coroutine_handle<> n_Handle)
+			{
+				std::unique_lock<std::recursive_mutex> lock(pState->Mutex);
+				if (pState->bClosed || pState->NetNode->IsWritable()) return false;
+
+				pState->hWrite = n_Handle;
+				return true;
+			}
+
+			int await_resume() const
+			{
+				if (nResult < 0) return nResult;
+
+				std::unique_lock<std::recursive_mutex> lock(pState->Mutex);
+				return pState->bClosed ? -1 : nResult;
+			}
+		};
+
+		int nResult = -1;
+		if (m_pState)
+		{
+			std::unique_lock<std::recursive_mutex> lock(m_pState->Mutex);
+			if (!m_pState->bClosed) nResult = m_pState->NetNode->Send(n_szData, n_nSize);
+		}
+
+		return FAwaiter{ m_pState.get(), nResult };
+	}
+
+	inline auto CCoConnection::Send(const std::string& n_sData)
+	{
+		return Send(n_sData.data(), (int)n_sData.size());
+	}
+
+	inline auto CCoConnection::Sleep(const unsigned int n_nMilliSeconds)
+	{
+		struct FAwaiter
+		{
+			FCoState*	pState;
+			unsigned int nDelay;
+
+			bool await_ready() const
+			{
+				if (!pState || nDelay == 0) return true;
+
+				std::unique_lock<std::recursive_mutex> lock(pState->Mutex);
+				return pState->bClosed;
+			}
+
+			bool await_suspend(std::coroutine_handle<> n_Handle)
+			{
+				// 定时器可能在返回前到期并恢复协程，之后不再访问成员
+				return pState->Owner->AddSleep(pState->nId, nDelay, n_Handle);
+			}
+
+			void await_resume() const {}
+		};
+
+		return FAwaiter{ m_pState.get(), n_nMilliSeconds };
+	}
+#pragma endregion
+
+	////////////////////////////////////////////////////////////////////////////////
+#pragma region 适配器
+	inline CCoNet::~CCoNet()
+	{
+		m_Net.fnEventCallback = nullptr;
+		m_Net.fnRecvCallback = nullptr;
+
+		std::vector<std::shared_ptr<FCoState>> vecStates;
+		std::vector<std::coroutine_handle<>> vecHandles;
+		std::vector<unsigned long long> vecTimers;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			for (auto& State : m_States) vecStates.push_back(State.second);
+			m_States.clear();
+
+			for (auto& Waiter : m_Connects) vecHandles.push_back(Waiter.Handle);
+			m_Connects.clear();
+
+			for (auto& Sleep : m_Sleeps)
+			{
+				vecTimers.push_back(Sleep.second.nTimer);
+				vecHandles.push_back(Sleep.second.Handle);
+			}
+			m_Sleeps.clear();
+		}
+
+		// 等待正在执行的定时器回调完成，其在 m_Sleeps 中找不到协程，不再恢复
+		for (auto nTimer : vecTimers) ITinyNet::CancelTimer(nTimer);
+
+		for (auto& pState : vecStates)
+		{
+			std::unique_lock<std::recursive_mutex> lock(pState->Mutex);
+			pState->bClosed = true;
+			pState->NetNode = nullptr;
+			if (pState->hRead) vecHandles.push_back(std::exchange(pState->hRead, nullptr));
+			if (pState->hWrite) vecHandles.push_back(std::exchange(pState->hWrite, nullptr));
+		}
+
+		// 实例已停止，不会再恢复
+		for (auto Handle : vecHandles) Handle.destroy();
+	}
+
+	inline auto CCoNet::Connect()
+	{
+		struct FAwaiter
+		{
+			CCoNet*			pOwner;
+			CCoConnection	Result;
+
+			bool await_ready() const { return false; }
+
+			bool await_suspend(std::coroutine_handle<> n_Handle)
+			{
+#if !defined(_WIN32) && !defined(_WIN64)
+				auto pPool = pOwner->m_pPool;
+				if (!pPool) return false;
+
+				{
+					std::unique_lock<std::mutex> lock(pOwner->m_mutex);
+					pOwner->m_Connects.push_back(FConnectWaiter{ n_Handle, &Result });
+				}
+
+				// 连接可能在返回前就绪并恢复协程，之后不再访问成员
+				if (pPool->Connect(1) > 0) return true;
+
+				// 发起失败，已被其他连接取走时由其恢复
+				std::unique_lock<std::mutex> lock(pOwner->m_mutex);
+				for (auto it = pOwner->m_Connects.begin(); it != pOwner->m_Connects.end(); ++it)
+				{
+					if (it->Handle != n_Handle) continue;
+
+					pOwner->m_Connects.erase(it);
+					return false;
+				}
+				return true;
+#else
+				return false;
+#endif
+			}
+
+			CCoConnection await_resume() { return std::move(Result); }
+		};
+
+		return FAwaiter{ this, CCoConnection() };
+	}
+
+	inline bool CCoNet::AddSleep(const unsigned long long n_nId, const unsigned int n_nDelay,
+		std::coroutine_handle<> n_Handle)
+	{
+		unsigned long long nSeq = 0;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			nSeq = ++m_nSleepSeq;
+			m_Sleeps[nSeq].Handle = n_Handle;
+		}
+
+		// 析构时取消定时器并等待回调完成，回调中可安全访问成员
+		auto nTimer = ITinyNet::AddTimer(n_nDelay, 0, [this, nSeq, n_nId]() {
+			std::coroutine_handle<> Handle;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				auto it = m_Sleeps.find(nSeq);
+				if (it == m_Sleeps.end()) return;
+
+				Handle = it->second.Handle;
+				m_Sleeps.erase(it);
+			}
+
+			if (!m_Net.Post(n_nId, [Handle]() { Handle.resume(); })) Handle.resume();
+		});
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		auto it = m_Sleeps.find(nSeq);
+		if (nTimer == 0)
+		{
+			if (it != m_Sleeps.end()) m_Sleeps.erase(it);
+			return false;
+		}
+
+		// 已到期的定时器不再保存
+		if (it != m_Sleeps.end()) it->second.nTimer = nTimer;
+		return true;
+	}
+
+	inline CCoConnection CCoNet::Open(FNetNode* n_pNetNode)
+	{
+		auto pState = std::make_shared<FCoState>();
+		pState->Owner = this;
+		pState->NetNode = n_pNetNode;
+		pState->nId = n_pNetNode->Id;
+		n_pNetNode->UserData = pState.get();
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_States[pState.get()] = pState;
+		}
+
+		return CCoConnection(std::move(pState));
+	}
+
+	inline void CCoNet::Close(FNetNode* n_pNetNode)
+	{
+		auto pRaw = (FCoState*)n_pNetNode->UserData;
+		if (!pRaw) return;
+		n_pNetNode->UserData = nullptr;
+
+		// 恢复期间保持有效
+		std::shared_ptr<FCoState> pState;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			auto it = m_States.find(pRaw);
+			if (it == m_States.end()) return;
+
+			pState = std::move(it->second);
+			m_States.erase(it);
+		}
+
+		std::coroutine_handle<> hRead, hWrite;
+		{
+			std::unique_lock<std::recursive_mutex> lock(pState->Mutex);
+			pState->bClosed = true;
+			pState->NetNode = nullptr;
+			hRead = std::exchange(pState->hRead, nullptr);
+			hWrite = std::exchange(pState->hWrite, nullptr);
+		}
+
+		if (hRead) hRead.resume();
+		if (hWrite) hWrite.resume();
+	}
+
+	inline bool CCoNet::ResumeConnect(FNetNode* n_pNetNode)
+	{
+		FConnectWaiter Waiter;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			if (m_Connects.empty()) return false;
+
+			Waiter = m_Connects.front();
+			m_Connects.pop_front();
+		}
+
+		if (n_pNetNode) *Waiter.Result = Open(n_pNetNode);
+		Waiter.Handle.resume();
+		return true;
+	}
+
+	inline void CCoNet::OnEvent(FNetNode* n_pNetNode, const ENetEvent n_eNetEvent, const std::string& n_sData)
+	{
+		if (n_pNetNode == &m_Net)
+		{
+			// 连接池停止，等待连接的协程返回空连接
+			if (n_eNetEvent == ENetEvent::Quit) while (ResumeConnect(nullptr));
+		}
+		else if (n_pNetNode && n_pNetNode->eNetType == ENetType::TCP)
+		{
+			switch (n_eNetEvent)
+			{
+			case ENetEvent::Accept:
+				if (fnAccept) fnAccept(Open(n_pNetNode));
+				else Open(n_pNetNode);
+				break;
+			case ENetEvent::Ready:
+				if (!ResumeConnect(n_pNetNode))
+				{
+					if (fnAccept) fnAccept(Open(n_pNetNode));
+					else Open(n_pNetNode);
+				}
+				break;
+			case ENetEvent::Quit:
+				// 未就绪的连接池连接，连接失败
+				if (!n_pNetNode->UserData) ResumeConnect(nullptr);
+				else Close(n_pNetNode);
+				break;
+			case ENetEvent::Writable:
+			{
+				auto pState = (FCoState*)n_pNetNode->UserData;
+				if (!pState) break;
+
+				std::coroutine_handle<> hWrite;
+				{
+					std::unique_lock<std::recursive_mutex> lock(pState->Mutex);
+					hWrite = std::exchange(pState->hWrite, nullptr);
+				}
+				if (hWrite) hWrite.resume();
+			}
+			break;
+			default:
+				break;
+			}
+		}
+
+		if (fnEventCallback) fnEventCallback(n_pNetNode, n_eNetEvent, n_sData);
+	}
+
+	inline void CCoNet::OnRecv(FNetNode* n_pNetNode, const char* n_szData, int n_nSize)
+	{
+		auto pState = (FCoState*)n_pNetNode->UserData;
+		if (!pState) return;
+
+		std::coroutine_handle<> hRead;
+		{
+			std::unique_lock<std::recursive_mutex> lock(pState->Mutex);
+			if (!pState->hRead || !pState->Frames.empty())
+			{
+				pState->Frames.emplace_back(n_szData, n_nSize);
+				if (!pState->bPaused && m_nMaxFrames > 0 && pState->Frames.size() >= m_nMaxFrames)
+					pState->bPaused = m_Net.PauseRead(n_pNetNode);
+				return;
+			}
+
+			hRead = std::exchange(pState->hRead, nullptr);
+			pState->Direct.Data = n_szData;
+			pState->Direct.nSize = n_nSize;
+		}
+
+		// 协程在回调中处理数据包，挂起或结束后数据才失效
+		hRead.resume();
+	}
+
+	inline void CCoNet::OnFrameTaken(FCoState& n_State)
+	{
+		std::unique_lock<std::recursive_mutex> lock(n_State.Mutex);
+		if (!n_State.bPaused || n_State.bClosed || n_State.Frames.size() > m_nMaxFrames / 2) return;
+
+		n_State.bPaused = false;
+		m_Net.ResumeRead(n_State.NetNode);
+	}
+#pragma endregion
+}
+#endif
+
+#endif // !__COROUTINE_H__
@@ -1,21 +1,301 @@
 #ifndef __DEBUG_H__
 #define __DEBUG_H__
 #include <iostream>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <type_traits>
+
+// 编译期日志级别，低于该级别的日志不生成代码：0 Trace，1 Debug，2 Info，3 Warn，4 Error，5 关闭
+#ifndef TINYNET_LOG_LEVEL
+#define TINYNET_LOG_LEVEL 1
+#endif
 
 namespace tinynet
 {
-#define STD_Out		std::cout 
+#define STD_Out		std::cout
 #define STD_Endl	std::endl
 
+	// 日志级别
+	enum class ELogLevel
+	{
+		Trace = 0,
+		Debug,
+		Info,
+		Warn,
+		Error,
+		Off,
+	};
+
+	/// <summary>
+	/// 日志输出目标，只在日志线程调用
+	/// </summary>
+	class ILogSink
+	{
+	public:
+		virtual ~ILogSink() {}
+
+		// 输出一行格式化后的日志(含换行)
+		virtual void Write(const ELogLevel n_eLevel, const char* n_szLine, const size_t n_nSize) = 0;
+		virtual void Flush() {}
+	};
+
+	// 输出到标准错误，合并一批日志后写入
+	class CStderrSink : public ILogSink
+	{
+	public:
+		void Write(const ELogLevel n_eLevel, const char* n_szLine, const size_t n_nSize) override;
+		void Flush() override;
+
+	protected:
+		std::string	m_sBuffer;
+	};
+
+	// 追加到文件
+	class CFileSink : public ILogSink
+	{
+	public:
+		CFileSink(const std::string& n_sPath);
+		~CFileSink();
+
+		const bool IsOpen() const { return m_pFile != nullptr; }
+
+		void Write(const ELogLevel n_eLevel, const char* n_szLine, const size_t n_nSize) override;
+		void Flush() override;
+
+	protected:
+		FILE*	m_pFile = nullptr;
+	};
+
+	// 调用处的限流计数，由日志宏定义为静态变量
+	struct FLogSite
+	{
+		// 当前计数的秒
+		std::atomic<long long>		nWindow{ 0 };
+		std::atomic<unsigned int>	nCount{ 0 };
+		// 被限流丢弃的条数，在下一条输出的日志中报告
+		std::atomic<unsigned int>	nSuppressed{ 0 };
+	};
+
+	// 日志记录头，之后为编码的参数
+	struct FLogRecord
+	{
+		// 记录长度(含记录头)
+		unsigned int	nSize = 0;
+		unsigned char	nLevel = 0;
+		unsigned char	nReserved = 0;
+		// 线程序号
+		unsigned short	nThread = 0;
+		int				nLine = 0;
+		// 调用时的 errno，%m 输出其描述
+		int				nErrno = 0;
+		unsigned int	nSuppressed = 0;
+		// 调用时间(纳秒)
+		long long		nTime = 0;
+		// 函数名及格式须为字符串常量，只保存地址
+		const char*		szFunc = nullptr;
+		const char*		szFormat = nullptr;
+	};
+
+	namespace logdetail
+	{
+		// 参数类型
+		enum class EArg : unsigned char
+		{
+			Int = 1,
+			UInt,
+			Double,
+			String,
+			Pointer,
+		};
+
+		// 字符串参数的最大长度，超出截断
+		constexpr size_t kMaxString = 1024;
+
+		template <typename T>
+		inline char* PutValue(char* n_pData, const EArg n_eArg, const T n_Value)
+		{
+			*n_pData++ = (char)n_eArg;
+			memcpy(n_pData, &n_Value, sizeof(T));
+			return n_pData + sizeof(T);
+		}
+
+		inline size_t StringSize(const size_t n_nLength)
+		{
+			return 1 + sizeof(unsigned int) + std::min(n_nLength, kMaxString);
+		}
+
+		inline char* PutString(char* n_pData, const char* n_szValue, size_t n_nLength)
+		{
+			n_nLength = std::min(n_nLength, kMaxString);
+			n_pData = PutValue(n_pData, EArg::String, (unsigned int)n_nLength);
+			memcpy(n_pData, n_szValue, n_nLength);
+			return n_pData + n_nLength;
+		}
+
+		// 参数编码，不支持的类型编译失败
+		template <typename T, typename Enable = void>
+		struct TArg;
+
+		template <typename T>
+		struct TArg<T, typename std::enable_if<(std::is_integral<T>::value && std::is_signed<T>::value) ||
+			std::is_enum<T>::value>::type>
+		{
+			static size_t Size(const T&) { return 1 + sizeof(long long); }
+			static char* Put(char* n_pData, const T& n_Value) { return PutValue(n_pData, EArg::Int, (long long)n_Value); }
+		};
+
+		template <typename T>
+		struct TArg<T, typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value>::type>
+		{
+			static size_t Size(const T&) { return 1 + sizeof(unsigned long long); }
+			static char* Put(char* n_pData, const T& n_Value) { return PutValue(n_pData, EArg::UInt, (unsigned long long)n_Value); }
+		};
+
+		template <typename T>
+		struct TArg<T, typename std::enable_if<std::is_floating_point<T>::value>::type>
+		{
+			static size_t Size(const T&) { return 1 + sizeof(double); }
+			static char* Put(char* n_pData, const T& n_Value) { return PutValue(n_pData, EArg::Double, (double)n_Value); }
+		};
+
+		template <typename T>
+		struct TArg<T, typename std::enable_if<std::is_pointer<T>::value &&
+			std::is_same<typename std::remove_cv<typename std::remove_pointer<T>::type>::type, char>::value>::type>
+		{
+			static size_t Size(const char* n_szValue)
+			{
+				return StringSize(n_szValue ? strlen(n_szValue) : 6);
+			}
+			static char* Put(char* n_pData, const char* n_szValue)
+			{
+				return n_szValue ? PutString(n_pData, n_szValue, strlen(n_szValue)) : PutString(n_pData, "(null)", 6);
+			}
+		};
+
+		template <typename T>
+		struct TArg<T, typename std::enable_if<(std::is_pointer<T>::value &&
+			!std::is_same<typename std::remove_cv<typename std::remove_pointer<T>::type>::type, char>::value) ||
+			std::is_same<T, std::nullptr_t>::value>::type>
+		{
+			static size_t Size(const void*) { return 1 + sizeof(const void*); }
+			static char* Put(char* n_pData, const void* n_pValue) { return PutValue(n_pData, EArg::Pointer, n_pValue); }
+		};
+
+		template <>
+		struct TArg<std::string, void>
+		{
+			static size_t Size(const std::string& n_sValue) { return StringSize(n_sValue.size()); }
+			static char* Put(char* n_pData, const std::string& n_sValue) { return PutString(n_pData, n_sValue.data(), n_sValue.size()); }
+		};
+
+		inline size_t ArgsSize() { return 0; }
+
+		template <typename T, typename... Args>
+		inline size_t ArgsSize(const T& n_Value, const Args&... n_Args)
+		{
+			return TArg<typename std::decay<T>::type>::Size(n_Value) + ArgsSize(n_Args...);
+		}
+
+		inline char* PutArgs(char* n_pData) { return n_pData; }
+
+		template <typename T, typename... Args>
+		inline char* PutArgs(char* n_pData, const T& n_Value, const Args&... n_Args)
+		{
+			return PutArgs(TArg<typename std::decay<T>::type>::Put(n_pData, n_Value), n_Args...);
+		}
+	}
+
+	/// <summary>
+	/// 异步日志
+	/// </summary>
+	/// 每个线程写入自己的无锁环形缓冲区，只保存格式地址及编码后的参数，不在调用线程格式化；
+	/// 日志线程汇总各线程的记录，格式化后输出到所有目标(默认标准错误)；
+	/// 缓冲区已满时丢弃并在之后报告丢弃条数；同一调用处每秒超出限流的日志被丢弃
+	class CLogger
+	{
+	public:
+		/// <summary>
+		/// 写入日志，通常通过 DebugLog 等宏调用
+		/// </summary>
+		/// <param name="n_pSite">调用处的限流计数，为空不限流</param>
+		/// <param name="n_szFormat">printf 格式，须为字符串常量；支持 %m 输出调用时 errno 的描述</param>
+		template <typename... Args>
+		static void Write(FLogSite* n_pSite, const ELogLevel n_eLevel, const char* n_szFunc,
+			const int n_nLine, const char* n_szFormat, const Args&... n_Args)
+		{
+			FLogRecord Record;
+			Record.nErrno = errno;
+			if (n_pSite && !Admit(*n_pSite, Record.nSuppressed)) return;
+
+			Record.nSize = (unsigned int)(sizeof(FLogRecord) + logdetail::ArgsSize(n_Args...));
+			Record.nLevel = (unsigned char)n_eLevel;
+			Record.nLine = n_nLine;
+			Record.nTime = Now();
+			Record.szFunc = n_szFunc;
+			Record.szFormat = n_szFormat;
+
+			auto szRecord = Reserve(Record.nSize);
+			if (!szRecord) return;
+
+			memcpy(szRecord, &Record, sizeof(FLogRecord));
+			logdetail::PutArgs(szRecord + sizeof(FLogRecord), n_Args...);
+			Commit(szRecord);
+		}
+
+		// 运行时日志级别，默认 Debug
+		static void SetLevel(const ELogLevel n_eLevel);
+		static const ELogLevel GetLevel();
+		static const bool IsEnabled(const ELogLevel n_eLevel);
+
+		// 同一调用处每秒最多输出的日志条数，0 不限制，默认 100
+		static void SetRateLimit(const unsigned int n_nPerSecond);
+
+		// 添加输出目标
+		static void AddSink(std::shared_ptr<ILogSink> n_pSink);
+		// 移除所有输出目标(包括默认的标准错误)
+		static void ClearSinks();
+
+		// 输出所有已写入的日志，返回时已交给输出目标
+		static void Flush();
+
+		// 缓冲区已满而丢弃的日志条数
+		static unsigned long long GetDropped();
+
+	protected:
+		static bool Admit(FLogSite& n_Site, unsigned int& n_nSuppressed);
+		static long long Now();
+
+		// 在当前线程的缓冲区中预留记录，失败返回 nullptr
+		static char* Reserve(const size_t n_nSize);
+		// 提交 Reserve 返回的记录
+		static void Commit(char* n_szRecord);
+	};
+
+	// 兼容接口，调用线程格式化后写入
 	void LogDebug(const char* func, int line, const char* format, ...);
-#define DebugLog(format, ...) LogDebug(__FUNCTION__, __LINE__, format, __VA_ARGS__)
+
+#define TINYNET_LOG(level, format, ...) do { \
+		if ((int)(level) >= TINYNET_LOG_LEVEL && tinynet::CLogger::IsEnabled(level)) { \
+			static tinynet::FLogSite s_LogSite; \
+			tinynet::CLogger::Write(&s_LogSite, level, __FUNCTION__, __LINE__, format, ##__VA_ARGS__); \
+		} \
+	} while (0)
+
+#define DebugTrace(format, ...) TINYNET_LOG(tinynet::ELogLevel::Trace, format, ##__VA_ARGS__)
+#define DebugLog(format, ...) TINYNET_LOG(tinynet::ELogLevel::Debug, format, ##__VA_ARGS__)
+#define DebugInfo(format, ...) TINYNET_LOG(tinynet::ELogLevel::Info, format, ##__VA_ARGS__)
+#define DebugWarn(format, ...) TINYNET_LOG(tinynet::ELogLevel::Warn, format, ##__VA_ARGS__)
 
 #if !defined(_WIN32) && !defined(_WIN64)
+	// 兼容接口，输出 message 及 errno 的描述
 	void ErrDebug(const char* func, int line, const char* message);
-#define DebugError(message) ErrDebug(__FUNCTION__, __LINE__, message)
+#define DebugError(message) TINYNET_LOG(tinynet::ELogLevel::Error, "%s: %m", message)
 #endif
 }
 
 #endif // !__DEBUG_H__
-
-
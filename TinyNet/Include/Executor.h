@@ -0,0 +1,71 @@
+#ifndef __EXECUTOR_H__
+#define __EXECUTOR_H__
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <functional>
+
+namespace tinynet
+{
+	/// <summary>
+	/// 按键串行执行任务的线程池
+	/// </summary>
+	/// 每个键按哈希固定分配到一个工作线程，同一个键的任务按投递顺序在该线程执行；
+	/// 记录每个键未执行完的任务数，达到上限后降到上限的一半时通知恢复
+	class CSerialExecutor
+	{
+	public:
+		typedef unsigned long long Key;
+		typedef std::function<void()> FTask;
+
+		CSerialExecutor() : m_bRun(false) {}
+		~CSerialExecutor();
+
+		CSerialExecutor(const CSerialExecutor&) = delete;
+		CSerialExecutor& operator=(const CSerialExecutor&) = delete;
+
+		/// <summary>
+		/// 启动工作线程
+		/// </summary>
+		/// <param name="n_nWorkers">工作线程数</param>
+		/// <param name="n_nMaxPending">每个键未执行完的任务上限，0 不限制</param>
+		/// <param name="n_fnResume">任务数达到上限后降到一半时调用，在工作线程执行</param>
+		bool Start(const unsigned int n_nWorkers, const unsigned int n_nMaxPending,
+			std::function<void(Key)> n_fnResume);
+
+		/// <summary>
+		/// 执行完已投递的任务后退出
+		/// </summary>
+		/// 退出期间投递的任务仍然执行；在任务中调用时，当前线程的剩余任务在本次调用中执行
+		void Stop();
+
+		const bool IsRunning() const { return m_bRun; }
+
+		/// <summary>
+		/// 投递任务
+		/// </summary>
+		/// <param name="n_nKey">键，不可为 0</param>
+		/// <param name="n_fnTask">任务，投递成功才会被取走</param>
+		/// <param name="n_nLimit">不为 0 时，该键未执行完的任务数达到该值则丢弃</param>
+		/// <returns>该键未执行完的任务数(含本任务)；未启动或已退出返回 0，由调用者直接执行；丢弃返回 -1</returns>
+		int Post(const Key n_nKey, FTask&& n_fnTask, const unsigned int n_nLimit = 0);
+
+		// 该键未执行完的任务数
+		unsigned int Pending(const Key n_nKey);
+		const unsigned int MaxPending() const { return m_nMaxPending; }
+
+	protected:
+		struct FLane;
+
+		// 工作线程，只访问所属的 Lane
+		static void Run(std::shared_ptr<FLane> n_pLane);
+		FLane* Lane(const Key n_nKey) const;
+
+	protected:
+		std::vector<std::shared_ptr<FLane>> m_vecLanes;
+		unsigned int		m_nMaxPending = 0;
+		std::atomic<bool>	m_bRun;
+	};
+}
+
+#endif // !__EXECUTOR_H__
@@ -0,0 +1,146 @@
+#ifndef __HASHMAP_H__
+#define __HASHMAP_H__
+#include <cstddef>
+#include <vector>
+
+namespace tinynet
+{
+	/// <summary>
+	/// 以 64 位整数为键的开放寻址哈希表
+	/// </summary>
+	/// 线性探测，容量为 2 的幂，负载超过 70% 时扩容；
+	/// 删除时将后续元素前移，不留删除标记，查找不分配内存
+	/// 键 0 保留为空槽位，不可使用
+	template <typename T>
+	class CHashMap
+	{
+	public:
+		typedef unsigned long long Key;
+
+		T* Find(const Key n_nKey)
+		{
+			if (n_nKey == 0 || m_nSize == 0) return nullptr;
+
+			for (size_t i = Hash(n_nKey) & m_nMask; ; i = (i + 1) & m_nMask)
+			{
+				auto& Entry = m_vecEntries[i];
+				if (Entry.nKey == n_nKey) return &Entry.Value;
+				if (Entry.nKey == 0) return nullptr;
+			}
+		}
+
+		// 插入，已存在时返回已有元素，键为 0 返回 nullptr
+		T* Insert(const Key n_nKey, const T& n_Value)
+		{
+			if (n_nKey == 0) return nullptr;
+			if ((m_nSize + 1) * 10 > m_vecEntries.size() * 7)
+				Rehash(m_vecEntries.empty() ? 16 : m_vecEntries.size() * 2);
+
+			for (size_t i = Hash(n_nKey) & m_nMask; ; i = (i + 1) & m_nMask)
+			{
+				auto& Entry = m_vecEntries[i];
+				if (Entry.nKey == n_nKey) return &Entry.Value;
+				if (Entry.nKey != 0) continue;
+
+				Entry.nKey = n_nKey;
+				Entry.Value = n_Value;
+				m_nSize++;
+				return &Entry.Value;
+			}
+		}
+
+		bool Erase(const Key n_nKey)
+		{
+			if (n_nKey == 0 || m_nSize == 0) return false;
+
+			size_t i = Hash(n_nKey) & m_nMask;
+			for (; m_vecEntries[i].nKey != n_nKey; i = (i + 1) & m_nMask)
+			{
+				if (m_vecEntries[i].nKey == 0) return false;
+			}
+
+			// 后续元素若不在其理想位置与空位之间，则前移填补空位
+			for (size_t j = (i + 1) & m_nMask; m_vecEntries[j].nKey != 0; j = (j + 1) & m_nMask)
+			{
+				auto nIdeal = Hash(m_vecEntries[j].nKey) & m_nMask;
+				if (((j - nIdeal) & m_nMask) < ((j - i) & m_nMask)) continue;
+
+				m_vecEntries[i] = m_vecEntries[j];
+				i = j;
+			}
+
+			m_vecEntries[i] = FEntry();
+			m_nSize--;
+			return true;
+		}
+
+		// 预留容量，避免插入时扩容
+		void Reserve(const size_t n_nCount)
+		{
+			size_t nCapacity = 16;
+			while (nCapacity * 7 < n_nCount * 10) nCapacity <<= 1;
+			if (nCapacity > m_vecEntries.size()) Rehash(nCapacity);
+		}
+
+		void Clear()
+		{
+			m_vecEntries.clear();
+			m_nSize = 0;
+			m_nMask = 0;
+		}
+
+		const size_t Size() const { return m_nSize; }
+		const bool Empty() const { return m_nSize == 0; }
+
+		// 遍历所有元素，遍历时不可插入或删除
+		template <typename FCallback>
+		void ForEach(FCallback n_fnCallback)
+		{
+			for (auto& Entry : m_vecEntries)
+			{
+				if (Entry.nKey != 0) n_fnCallback(Entry.nKey, Entry.Value);
+			}
+		}
+
+	protected:
+		struct FEntry
+		{
+			Key	nKey = 0;
+			T	Value = T();
+		};
+
+		// 64 位整数混合，使相邻的 IP、端口分散
+		static size_t Hash(Key n_nKey)
+		{
+			n_nKey ^= n_nKey >> 33;
+			n_nKey *= 0xff51afd7ed558ccdULL;
+			n_nKey ^= n_nKey >> 33;
+			n_nKey *= 0xc4ceb9fe1a85ec53ULL;
+			n_nKey ^= n_nKey >> 33;
+			return (size_t)n_nKey;
+		}
+
+		void Rehash(const size_t n_nCapacity)
+		{
+			std::vector<FEntry> vecEntries(n_nCapacity);
+			vecEntries.swap(m_vecEntries);
+			m_nMask = n_nCapacity - 1;
+
+			for (auto& Entry : vecEntries)
+			{
+				if (Entry.nKey == 0) continue;
+
+				size_t i = Hash(Entry.nKey) & m_nMask;
+				while (m_vecEntries[i].nKey != 0) i = (i + 1) & m_nMask;
+				m_vecEntries[i] = Entry;
+			}
+		}
+
+	protected:
+		std::vector<FEntry>	m_vecEntries;
+		size_t				m_nSize = 0;
+		size_t				m_nMask = 0;
+	};
+}
+
+#endif // !__HASHMAP_H__
@@ -0,0 +1,213 @@
+#ifndef __LATENCYTRACE_H__
+#define __LATENCYTRACE_H__
+#include <atomic>
+#include <cstddef>
+#include <algorithm>
+#include <cmath>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace tinynet
+{
+	// 延时追踪的阶段
+	enum class ELatencyStage
+	{
+		// 内核接收(SO_TIMESTAMPING)到工作线程取出
+		Kernel = 0,
+		// 工作线程取出到拆分出完整数据包
+		Reassembly,
+		// 数据回调(含事件消息处理)耗时
+		Callback,
+		// 发送到内核调度发送(SOF_TIMESTAMPING_TX_SCHED)
+		TxSched,
+		Count,
+	};
+
+	// 延时分布快照(纳秒)
+	struct FLatencySummary
+	{
+		unsigned long long nCount = 0;
+		unsigned long long nMin = 0;
+		unsigned long long nMax = 0;
+		unsigned long long nMean = 0;
+		unsigned long long nP50 = 0;
+		unsigned long long nP90 = 0;
+		unsigned long long nP99 = 0;
+		unsigned long long nP999 = 0;
+	};
+
+	/// <summary>
+	/// 可多线程同时记录的延时直方图，性能测试程序也使用此直方图
+	/// </summary>
+	/// 数值按 2 的幂分段，每段等分为 32 个子桶，相对误差不超过 1/32；
+	/// 小于 64 的数值精确记录，超过 2^40(约 18 分钟)的数值计入最后一个子桶
+	class CLatencyHistogram
+	{
+	public:
+		CLatencyHistogram() { Reset(); }
+
+		CLatencyHistogram(const CLatencyHistogram&) = delete;
+		CLatencyHistogram& operator=(const CLatencyHistogram&) = delete;
+
+		void Record(const unsigned long long n_nValue)
+		{
+			m_Counts[Index(n_nValue)].fetch_add(1, std::memory_order_relaxed);
+			m_nCount.fetch_add(1, std::memory_order_relaxed);
+			m_nSum.fetch_add(n_nValue, std::memory_order_relaxed);
+
+			auto nMin = m_nMin.load(std::memory_order_relaxed);
+			while (n_nValue < nMin && !m_nMin.compare_exchange_weak(nMin, n_nValue, std::memory_order_relaxed));
+			auto nMax = m_nMax.load(std::memory_order_relaxed);
+			while (n_nValue > nMax && !m_nMax.compare_exchange_weak(nMax, n_nValue, std::memory_order_relaxed));
+		}
+
+		// 合并其他线程记录的直方图
+		void Merge(const CLatencyHistogram& n_Other)
+		{
+			for (size_t i = 0; i < kBucketCount; i++)
+				m_Counts[i].fetch_add(n_Other.m_Counts[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+			m_nCount.fetch_add(n_Other.m_nCount.load(std::memory_order_relaxed), std::memory_order_relaxed);
+			m_nSum.fetch_add(n_Other.m_nSum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+			auto nOtherMin = n_Other.m_nMin.load(std::memory_order_relaxed);
+			auto nMin = m_nMin.load(std::memory_order_relaxed);
+			while (nOtherMin < nMin && !m_nMin.compare_exchange_weak(nMin, nOtherMin, std::memory_order_relaxed));
+			auto nOtherMax = n_Other.m_nMax.load(std::memory_order_relaxed);
+			auto nMax = m_nMax.load(std::memory_order_relaxed);
+			while (nOtherMax > nMax && !m_nMax.compare_exchange_weak(nMax, nOtherMax, std::memory_order_relaxed));
+		}
+
+		// 百分位数(0~100)，返回所在子桶的上限，不超过最大值
+		unsigned long long Percentile(const double n_dPercent) const
+		{
+			unsigned long long nTotal = 0;
+			for (size_t i = 0; i < kBucketCount; i++) nTotal += m_Counts[i].load(std::memory_order_relaxed);
+			if (nTotal == 0) return 0;
+
+			auto nTarget = std::max(1ull, (unsigned long long)std::ceil(n_dPercent / 100.0 * (double)nTotal));
+			auto nMax = Max();
+
+			unsigned long long nSeen = 0;
+			for (size_t i = 0; i < kBucketCount; i++)
+			{
+				nSeen += m_Counts[i].load(std::memory_order_relaxed);
+				if (nSeen >= nTarget) return std::min(UpperBound(i), nMax);
+			}
+
+			return nMax;
+		}
+
+		// 记录与读取同时进行时各项不保证一致
+		FLatencySummary Summary() const
+		{
+			FLatencySummary Summary;
+
+			Summary.nCount = Count();
+			if (Summary.nCount == 0) return Summary;
+
+			Summary.nMin = Min();
+			Summary.nMax = Max();
+			Summary.nMean = (unsigned long long)Mean();
+			Summary.nP50 = Percentile(50);
+			Summary.nP90 = Percentile(90);
+			Summary.nP99 = Percentile(99);
+			Summary.nP999 = Percentile(99.9);
+
+			return Summary;
+		}
+
+		unsigned long long Count() const { return m_nCount.load(std::memory_order_relaxed); }
+		unsigned long long Min() const { return Count() ? m_nMin.load(std::memory_order_relaxed) : 0; }
+		unsigned long long Max() const { return m_nMax.load(std::memory_order_relaxed); }
+		double Mean() const
+		{
+			auto nCount = Count();
+			return nCount ? (double)m_nSum.load(std::memory_order_relaxed) / (double)nCount : 0;
+		}
+
+		void Reset()
+		{
+			for (auto& Count : m_Counts) Count.store(0, std::memory_order_relaxed);
+			m_nCount.store(0, std::memory_order_relaxed);
+			m_nSum.store(0, std::memory_order_relaxed);
+			m_nMin.store(~0ull, std::memory_order_relaxed);
+			m_nMax.store(0, std::memory_order_relaxed);
+		}
+
+	protected:
+		// 子桶位数，每段 2^(kSubBits - 1) 个子桶
+		static constexpr int kSubBits = 6;
+		static constexpr unsigned long long kLinear = 1ull << kSubBits;
+		static constexpr unsigned long long kHalf = kLinear >> 1;
+		// 最高记录到 2^kMaxBits
+		static constexpr int kMaxBits = 40;
+		static constexpr size_t kBucketCount = (size_t)(kLinear + (kMaxBits - kSubBits) * kHalf);
+
+		static int HighestBit(const unsigned long long n_nValue)
+		{
+#if defined(_MSC_VER)
+			unsigned long nIndex = 0;
+			_BitScanReverse64(&nIndex, n_nValue);
+			return (int)nIndex;
+#else
+			return 63 - __builtin_clzll(n_nValue);
+#endif
+		}
+
+		static size_t Index(const unsigned long long n_nValue)
+		{
+			if (n_nValue < kLinear) return (size_t)n_nValue;
+
+			auto nBit = HighestBit(n_nValue);
+			if (nBit >= kMaxBits) return kBucketCount - 1;
+
+			// 右移后位于 [32, 64)
+			auto nShift = nBit - (kSubBits - 1);
+			return (size_t)(kLinear + (unsigned long long)(nBit - kSubBits) * kHalf + ((n_nValue >> nShift) - kHalf));
+		}
+
+		static unsigned long long UpperBound(const size_t n_nIndex)
+		{
+			if (n_nIndex < kLinear) return n_nIndex;
+
+			auto nBit = (int)((n_nIndex - kLinear) / kHalf) + kSubBits;
+			auto nSub = (n_nIndex - kLinear) % kHalf + kHalf;
+			auto nShift = nBit - (kSubBits - 1);
+			return ((nSub + 1) << nShift) - 1;
+		}
+
+	protected:
+		std::atomic<unsigned long long>	m_Counts[kBucketCount];
+		std::atomic<unsigned long long>	m_nCount;
+		std::atomic<unsigned long long>	m_nSum;
+		std::atomic<unsigned long long>	m_nMin;
+		std::atomic<unsigned long long>	m_nMax;
+	};
+
+	// 各阶段的延时直方图
+	class CLatencyTrace
+	{
+	public:
+		void Record(const ELatencyStage n_eStage, const long long n_nNanoSeconds)
+		{
+			// 时钟回拨时计为 0
+			m_Stages[(int)n_eStage].Record(n_nNanoSeconds > 0 ? (unsigned long long)n_nNanoSeconds : 0);
+		}
+
+		FLatencySummary Summary(const ELatencyStage n_eStage) const
+		{
+			return m_Stages[(int)n_eStage].Summary();
+		}
+
+		void Reset()
+		{
+			for (auto& Stage : m_Stages) Stage.Reset();
+		}
+
+	protected:
+		CLatencyHistogram m_Stages[(int)ELatencyStage::Count];
+	};
+}
+
+#endif // !__LATENCYTRACE_H__
@@ -0,0 +1,166 @@
+#ifndef __NETSTATS_H__
+#define __NETSTATS_H__
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace tinynet
+{
+	// 统计项
+	enum class ENetStat
+	{
+		// 接收的字节数(含数据头)
+		BytesRecv = 0,
+		// 发送的字节数(含数据头，包括进入发送队列的数据)
+		BytesSent,
+		// 接收的数据包(TCP 拆分出的完整数据包，UDP 数据报)
+		FramesRecv,
+		// 发送的数据包
+		FramesSent,
+		// 丢弃的数据报(被截断或不足数据头)
+		Drops,
+		// 长度超出 kMaxTCPBufferSize 而丢弃的 TCP 数据包
+		Oversize,
+		// 部分发送，剩余数据进入发送队列或继续发送
+		PartialSends,
+		// 发送返回 EAGAIN / EWOULDBLOCK(阻塞 Socket 为发送超时)
+		Eagain,
+		Count,
+	};
+
+	// 统计快照
+	struct FNetStats
+	{
+		unsigned long long nBytesRecv = 0;
+		unsigned long long nBytesSent = 0;
+		unsigned long long nFramesRecv = 0;
+		unsigned long long nFramesSent = 0;
+		unsigned long long nDrops = 0;
+		unsigned long long nOversize = 0;
+		unsigned long long nPartialSends = 0;
+		unsigned long long nEagain = 0;
+
+		// 按统计项顺序填充
+		static FNetStats FromValues(const unsigned long long* n_pValues)
+		{
+			FNetStats Stats;
+			Stats.nBytesRecv = n_pValues[(int)ENetStat::BytesRecv];
+			Stats.nBytesSent = n_pValues[(int)ENetStat::BytesSent];
+			Stats.nFramesRecv = n_pValues[(int)ENetStat::FramesRecv];
+			Stats.nFramesSent = n_pValues[(int)ENetStat::FramesSent];
+			Stats.nDrops = n_pValues[(int)ENetStat::Drops];
+			Stats.nOversize = n_pValues[(int)ENetStat::Oversize];
+			Stats.nPartialSends = n_pValues[(int)ENetStat::PartialSends];
+			Stats.nEagain = n_pValues[(int)ENetStat::Eagain];
+			return Stats;
+		}
+	};
+
+	/// <summary>
+	/// 单个连接的统计计数
+	/// </summary>
+	/// 连接通常只由所属线程更新，计数不做缓存行填充；复制时复制当前值
+	class CNodeStats
+	{
+	public:
+		CNodeStats() { Reset(); }
+		CNodeStats(const CNodeStats& other) { *this = other; }
+
+		CNodeStats& operator=(const CNodeStats& other)
+		{
+			for (int i = 0; i < (int)ENetStat::Count; i++)
+				m_Values[i].store(other.m_Values[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+			return *this;
+		}
+
+		void Add(const ENetStat n_eStat, const unsigned long long n_nValue = 1)
+		{
+			m_Values[(int)n_eStat].fetch_add(n_nValue, std::memory_order_relaxed);
+		}
+
+		FNetStats Snapshot() const
+		{
+			unsigned long long Values[(int)ENetStat::Count];
+			for (int i = 0; i < (int)ENetStat::Count; i++)
+				Values[i] = m_Values[i].load(std::memory_order_relaxed);
+			return FNetStats::FromValues(Values);
+		}
+
+		void Reset()
+		{
+			for (auto& Value : m_Values) Value.store(0, std::memory_order_relaxed);
+		}
+
+	protected:
+		std::atomic<unsigned long long> m_Values[(int)ENetStat::Count];
+	};
+
+	/// <summary>
+	/// 按线程分散的统计计数，无锁
+	/// </summary>
+	/// 每个线程固定使用一个槽位，每个槽位独占一个缓存行，热路径上不与其他线程争用；
+	/// 线程数超过槽位数时共用槽位，计数仍然准确；读取时汇总所有槽位
+	class CNetCounters
+	{
+	public:
+		CNetCounters()
+		{
+			// C++11 的 new 不保证超过 16 字节的对齐，手动对齐到缓存行
+			auto nAddr = ((uintptr_t)m_Storage + kCacheLine - 1) & ~(uintptr_t)(kCacheLine - 1);
+			m_pSlots = (FSlot*)nAddr;
+			Reset();
+		}
+
+		CNetCounters(const CNetCounters&) = delete;
+		CNetCounters& operator=(const CNetCounters&) = delete;
+
+		void Add(const ENetStat n_eStat, const unsigned long long n_nValue = 1)
+		{
+			m_pSlots[ThreadSlot()].Values[(int)n_eStat].fetch_add(n_nValue, std::memory_order_relaxed);
+		}
+
+		FNetStats Snapshot() const
+		{
+			unsigned long long Values[(int)ENetStat::Count] = { 0 };
+			for (size_t i = 0; i < kSlots; i++)
+			{
+				for (int k = 0; k < (int)ENetStat::Count; k++)
+					Values[k] += m_pSlots[i].Values[k].load(std::memory_order_relaxed);
+			}
+			return FNetStats::FromValues(Values);
+		}
+
+		void Reset()
+		{
+			for (size_t i = 0; i < kSlots; i++)
+			{
+				for (auto& Value : m_pSlots[i].Values) Value.store(0, std::memory_order_relaxed);
+			}
+		}
+
+	protected:
+		static constexpr size_t kCacheLine = 64;
+		static constexpr size_t kSlots = 16;
+
+		struct FSlot
+		{
+			std::atomic<unsigned long long> Values[kCacheLine / sizeof(unsigned long long)];
+		};
+		static_assert((int)ENetStat::Count <= (int)(kCacheLine / sizeof(unsigned long long)),
+			"statistics exceed one cache line");
+
+		// 线程首次计数时分配槽位
+		static size_t ThreadSlot()
+		{
+			static std::atomic<unsigned int> s_nNext(0);
+			static thread_local size_t s_nSlot = s_nNext.fetch_add(1, std::memory_order_relaxed) % kSlots;
+			return s_nSlot;
+		}
+
+	protected:
+		FSlot*	m_pSlots = nullptr;
+		char	m_Storage[sizeof(FSlot) * kSlots + kCacheLine];
+	};
+}
+
+#endif // !__NETSTATS_H__
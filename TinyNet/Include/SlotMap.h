@@ -0,0 +1,141 @@
+#ifndef __SLOTMAP_H__
+#define __SLOTMAP_H__
+#include <cstddef>
+#include <vector>
+
+namespace tinynet
+{
+	/// <summary>
+	/// 槽位表，插入、删除、查找均为 O(1)，元素连续存放便于遍历
+	/// </summary>
+	/// Id 由 (版本号 << 32) | 槽位序号 组成，槽位复用时版本号递增，
+	/// 已删除元素的 Id 不会再命中；Id 为 0 表示无效
+	/// 删除时将最后一个元素移到被删除的位置，遍历顺序不固定
+	template <typename T>
+	class CSlotMap
+	{
+	public:
+		typedef unsigned long long Id;
+
+		Id Insert(const T& n_Value)
+		{
+			unsigned int nSlot = 0;
+			if (m_nFreeHead != kInvalid)
+			{
+				nSlot = m_nFreeHead;
+				m_nFreeHead = m_vecSlots[nSlot].nIndex;
+			}
+			else
+			{
+				nSlot = (unsigned int)m_vecSlots.size();
+				m_vecSlots.push_back(FSlot());
+			}
+
+			auto& Slot = m_vecSlots[nSlot];
+			Slot.nIndex = (unsigned int)m_vecValues.size();
+
+			m_vecValues.push_back(n_Value);
+			m_vecOwners.push_back(nSlot);
+
+			return ((Id)Slot.nGeneration << 32) | nSlot;
+		}
+
+		bool Erase(const Id n_nId)
+		{
+			auto pSlot = GetSlot(n_nId);
+			if (!pSlot) return false;
+
+			// 最后一个元素移到被删除的位置
+			auto nIndex = pSlot->nIndex;
+			auto nLast = (unsigned int)m_vecValues.size() - 1;
+			if (nIndex != nLast)
+			{
+				m_vecValues[nIndex] = m_vecValues[nLast];
+				m_vecOwners[nIndex] = m_vecOwners[nLast];
+				m_vecSlots[m_vecOwners[nIndex]].nIndex = nIndex;
+			}
+
+			m_vecValues.pop_back();
+			m_vecOwners.pop_back();
+
+			// 版本号递增，槽位加入空闲链表
+			pSlot->nGeneration++;
+			if (pSlot->nGeneration == 0) pSlot->nGeneration = 1;
+			pSlot->nIndex = m_nFreeHead;
+			m_nFreeHead = (unsigned int)(n_nId & 0xFFFFFFFF);
+
+			return true;
+		}
+
+		T* Find(const Id n_nId)
+		{
+			auto pSlot = GetSlot(n_nId);
+			return pSlot ? &m_vecValues[pSlot->nIndex] : nullptr;
+		}
+
+		const bool Contains(const Id n_nId) const
+		{
+			return GetSlot(n_nId) != nullptr;
+		}
+
+		const size_t Size() const { return m_vecValues.size(); }
+		const bool Empty() const { return m_vecValues.empty(); }
+
+		// 保留槽位，占用的槽位版本号递增并加入空闲链表，清空前的 Id 不会再命中
+		void Clear()
+		{
+			for (auto nSlot : m_vecOwners)
+			{
+				auto& Slot = m_vecSlots[nSlot];
+				Slot.nGeneration++;
+				if (Slot.nGeneration == 0) Slot.nGeneration = 1;
+				Slot.nIndex = m_nFreeHead;
+				m_nFreeHead = nSlot;
+			}
+
+			m_vecValues.clear();
+			m_vecOwners.clear();
+		}
+
+		// 连续存放的元素
+		const std::vector<T>& Values() const { return m_vecValues; }
+
+		typename std::vector<T>::iterator begin() { return m_vecValues.begin(); }
+		typename std::vector<T>::iterator end() { return m_vecValues.end(); }
+		typename std::vector<T>::const_iterator begin() const { return m_vecValues.begin(); }
+		typename std::vector<T>::const_iterator end() const { return m_vecValues.end(); }
+
+	protected:
+		static const unsigned int kInvalid = 0xFFFFFFFF;
+
+		struct FSlot
+		{
+			// 版本号，从1开始
+			unsigned int nGeneration = 1;
+			// 占用时为元素序号，空闲时为下一个空闲槽位
+			unsigned int nIndex = 0;
+		};
+
+		FSlot* GetSlot(const Id n_nId) const
+		{
+			auto nSlot = (unsigned int)(n_nId & 0xFFFFFFFF);
+			auto nGeneration = (unsigned int)(n_nId >> 32);
+			if (nSlot >= m_vecSlots.size()) return nullptr;
+
+			auto pSlot = (FSlot*)&m_vecSlots[nSlot];
+			if (pSlot->nGeneration != nGeneration) return nullptr;
+			// 空闲槽位的版本号与下次分配的 Id 相同，nIndex 为空闲链表，需确认已被占用
+			if (pSlot->nIndex >= m_vecOwners.size() || m_vecOwners[pSlot->nIndex] != nSlot) return nullptr;
+			return pSlot;
+		}
+
+	protected:
+		std::vector<FSlot>			m_vecSlots;
+		// 元素，及其所属槽位
+		std::vector<T>				m_vecValues;
+		std::vector<unsigned int>	m_vecOwners;
+		unsigned int				m_nFreeHead = kInvalid;
+	};
+}
+
+#endif // !__SLOTMAP_H__
@@ -0,0 +1,101 @@
+#ifndef __TIMERWHEEL_H__
+#define __TIMERWHEEL_H__
+#include <cstddef>
+#include <functional>
+#include "SlotMap.h"
+
+namespace tinynet
+{
+	/// <summary>
+	/// 分层时间轮，添加、取消定时器均为 O(1)
+	/// </summary>
+	/// 共 4 层：第一层 256 个槽位，每槽位一个 Tick；其余各层 64 个槽位，
+	/// 每槽位为下一层一圈的时长；上层槽位到期时将定时器重新分配到下层；
+	/// 超出最大范围(2^26 个 Tick)的定时器放在最高层，到期时重新分配
+	/// 非线程安全，只能在同一线程使用；回调中可添加或取消定时器(包括自身)
+	class CTimerWheel
+	{
+	public:
+		typedef unsigned long long Id;
+		typedef std::function<void()> Callback;
+
+		/// <summary>
+		/// 构造
+		/// </summary>
+		/// <param name="n_nTick">每个 Tick 的时长(毫秒)</param>
+		explicit CTimerWheel(const unsigned int n_nTick = 1);
+		~CTimerWheel();
+
+		/// <summary>
+		/// 添加定时器
+		/// </summary>
+		/// <param name="n_nDelay">首次触发的延时(毫秒)</param>
+		/// <param name="n_nPeriod">触发周期(毫秒)，0 表示只触发一次</param>
+		/// <param name="n_fnCallback">回调</param>
+		/// <returns>定时器Id，不为 0</returns>
+		Id Schedule(const unsigned int n_nDelay, const unsigned int n_nPeriod, Callback n_fnCallback);
+
+		// 取消定时器，在回调中取消自身时，回调返回后释放
+		bool Cancel(const Id n_nId);
+
+		// 推进到当前时间，执行到期的定时器，返回执行的数量
+		size_t Advance();
+
+		// 距离下一次需要推进的毫秒数，无定时器返回 -1
+		int NextTimeout() const;
+
+		// 正在执行的定时器，没有返回 0
+		const Id Running() const { return m_nRunning; }
+
+		const size_t Size() const { return m_Timers.Size(); }
+		const bool Empty() const { return m_Timers.Empty(); }
+
+		// 单调时钟(毫秒)
+		static unsigned long long Now();
+
+	protected:
+		// 双向循环链表
+		struct FTimerLink
+		{
+			FTimerLink* pPrev = this;
+			FTimerLink* pNext = this;
+
+			const bool Empty() const { return pNext == this; }
+			void Unlink();
+			void PushBack(FTimerLink* n_pLink);
+			// 将链表内容移到 n_pList
+			void MoveTo(FTimerLink* n_pList);
+		};
+
+		struct FTimer : public FTimerLink
+		{
+			Id					nId = 0;
+			// 到期的 Tick
+			unsigned long long	nExpire = 0;
+			// 周期 Tick 数，0 表示只触发一次
+			unsigned long long	nPeriod = 0;
+			Callback			fnCallback = nullptr;
+		};
+
+		const unsigned long long CurrentTick() const;
+		// 按到期时间放入对应槽位
+		void Insert(FTimer* n_pTimer);
+		// 将上层槽位的定时器重新分配
+		void Cascade(FTimerLink* n_pSlot);
+
+	protected:
+		unsigned int		m_nTick = 1;
+		// 下一个需要处理的 Tick
+		unsigned long long	m_nNext = 0;
+
+		FTimerLink			m_Wheel0[256];
+		FTimerLink			m_Wheels[3][64];
+
+		CSlotMap<FTimer*>	m_Timers;
+		Id					m_nRunning = 0;
+		// 正在执行的定时器在回调中被取消
+		bool				m_bRunningCancelled = false;
+	};
+}
+
+#endif // !__TIMERWHEEL_H__
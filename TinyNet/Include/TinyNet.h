@@ -1,13 +1,20 @@
 ﻿#ifndef __TINYNET_H__
 #define __TINYNET_H__
 #include <list>
+#include <vector>
 #include <string>
 #include <thread>
 #include <mutex>
+#include <atomic>
+#include <condition_variable>
 #include <functional>
+#include "SlotMap.h"
+#include "NetStats.h"
+#include "LatencyTrace.h"
 
 struct sockaddr;
 struct sockaddr_in;
+struct io_uring_cqe;
 #define stSockaddrIn struct sockaddr_in
 #define stSockaddr struct sockaddr
 #define stIpMreq struct ip_mreq
@@ -35,6 +42,32 @@ namespace tinynet
 		Heart,
 		// 退出
 		Quit,
+		// 客户端重连，事件消息返回unsigned int 数组，依次是：重连次数-延时(毫秒)
+		Reconnect,
+		// 发送队列中未发送的数据达到高水位
+		Unwritable,
+		// 发送队列中未发送的数据降到低水位
+		Writable,
+	};
+
+	// I/O 模型
+	enum class EIoEngine
+	{
+		// Linux 服务端为 epoll，客户端为阻塞接收；Windows 为 IOCP
+		Default = 0,
+		// io_uring，仅 Linux，不支持时使用 Default
+		IoUring,
+	};
+
+	// 负载均衡策略
+	enum class EBalance
+	{
+		// 轮询
+		RoundRobin = 0,
+		// 最少连接
+		LeastConnections,
+		// 最少未完成请求，用于客户端连接池；服务端视为 LeastConnections
+		LeastOutstanding,
 	};
 
 	// 获取本机CPU核数
@@ -77,6 +110,17 @@ namespace tinynet
 #define SOCKADDR_SIZE 16
 #define EVENTMSGDATA_SIZE 16
 
+#if !defined(_WIN32) && !defined(_WIN64)
+	// Reactor(一个 epoll 或 io_uring 实例及其工作线程)
+	struct FReactor;
+	// io_uring 实例
+	class CUring;
+#endif
+	// 非阻塞 Socket 的发送队列
+	struct FSendQueue;
+	// 按连接串行执行回调的线程池
+	class CSerialExecutor;
+
 #pragma region 数据缓存
 	struct FNetBuffer
 	{
@@ -88,9 +132,11 @@ namespace tinynet
 		FNetBuffer(const std::string& n_sData);
 		~FNetBuffer();
 
-		// 分配内存
+		// 分配内存并清空数据，内存从 CBufferPool 获取
 		void Alloc(const size_t n_nSize);
-		// 释放内存
+		// 分配内存，不清空数据
+		void Resize(const size_t n_nSize);
+		// 释放内存，归还 CBufferPool
 		void Free();
 		// 清空数据
 		void Zero();
@@ -123,6 +169,7 @@ namespace tinynet
 		bool PointTo(const std::string& n_sData);
 
 		FNetBuffer& operator=(const FNetBuffer& other);
+		FNetBuffer& operator=(FNetBuffer&& other) noexcept;
 		FNetBuffer& operator=(const std::string& n_sData);
 
 		// 数据，格式: 数据头+数据
@@ -135,18 +182,36 @@ namespace tinynet
 #pragma endregion
 
 #pragma region 网络节点
+	// 分散发送的数据片段
+	struct FNetIoVec
+	{
+		const char*		Data = nullptr;
+		size_t			nSize = 0;
+	};
+
 	struct FNetNode
 	{
 		// 协议
 		ENetType		eNetType = ENetType::None;
 		// Socket
 		size_t			fd = 0;
+		// 连接Id，由服务端分配，同一服务端内不重复，0 表示无效
+		unsigned long long Id = 0;
 		// Sockaddr
 		char			Addr[SOCKADDR_SIZE] = {0};
 		// 用户数据，适用于TCP服务端，指向为客户端分配的数据地址
 		void*			UserData = nullptr;
 		// 用于解决TCP粘包, 最大缓存长度为 kMaxTCPBufferSize 默认64M，超出长度则认为异常，舍弃
 		std::string 	sCache;
+		// 发送队列，适用于服务端接收的 TCP 客户端(非阻塞)
+		// 无法立即发送的数据缓存在队列中，Socket 可写时由所属 Reactor 继续发送
+		FSendQueue*		SendQueue = nullptr;
+		// UDP 批量发送时使用 GSO(UDP_SEGMENT)，由 SetUdpOffload 设置
+		bool			bUdpGso = false;
+		// 连接的统计计数，收发时更新，任意线程可读取快照
+		mutable CNodeStats Stats;
+		// 所属实例的统计，由实例创建连接时设置，为空则只统计连接
+		CNetCounters*	Counters = nullptr;
 
 		void Init(const ENetType n_eType,
 			const std::string& n_sHost, const unsigned short n_nPort);
@@ -169,6 +234,24 @@ namespace tinynet
 		int Send(const std::string& n_sData) const;
 		int Send(const FNetBuffer& n_Buffer) const;
 
+		/// <summary>
+		/// 将多个数据片段作为一条消息发送
+		/// </summary>
+		/// <param name="n_pIoVec">数据片段</param>
+		/// <param name="n_nCount">片段数量</param>
+		/// <returns></returns>
+		/// Linux 下数据头与数据片段通过 sendmsg 一同发送，不复制用户数据
+		int Send(const FNetIoVec* n_pIoVec, const int n_nCount) const;
+
+		/// <summary>
+		/// 批量发送多条消息，每个数据片段为一条消息
+		/// </summary>
+		/// <param name="n_pMessages">消息</param>
+		/// <param name="n_nCount">消息数量</param>
+		/// <returns>发送的消息数量，失败返回 -1</returns>
+		/// Linux 下 UDP 通过 sendmmsg 一次系统调用发送多个数据报
+		int SendBatch(const FNetIoVec* n_pMessages, const int n_nCount) const;
+
 		/// <summary>
 		/// 发送UDP消息给服务端外的用户
 		/// </summary>
@@ -184,6 +267,18 @@ namespace tinynet
 		int Send(const FNetBuffer& n_Buffer,
 			const std::string& n_sHost, const unsigned short n_nPort) const;
 
+		/// <summary>
+		/// 设置该连接发送队列的高低水位(字节)
+		/// </summary>
+		/// <param name="n_nHigh">未发送的数据达到该值时触发 ENetEvent::Unwritable 事件，0 不启用</param>
+		/// <param name="n_nLow">降到该值时触发 ENetEvent::Writable 事件，大于高水位时取高水位</param>
+		/// <returns>没有发送队列的连接返回 false</returns>
+		bool SetWriteWatermark(const size_t n_nHigh, const size_t n_nLow);
+		// 未发送的数据未超过高水位，没有发送队列时始终可写
+		const bool IsWritable() const;
+		// 发送队列中未发送的字节数
+		const size_t GetSendPending() const;
+
 		const bool IsValid() const;
 
 		const std::string ToString();
@@ -211,6 +306,9 @@ namespace tinynet
 		/// 通知服务端或客户端退出
 		/// </summary>
 		int Quit();
+
+		// 连接池代替其连接收发事件消息
+		friend class CTinyClientPool;
 	};
 #pragma endregion
 
@@ -246,20 +344,52 @@ namespace tinynet
 
 		void SetRecvBuffSize(const int n_nSize);
 
+		/// <summary>
+		/// 设置 UDP 单次批量接收的最大数据报数量，默认32，最大64，在Start前设置
+		/// </summary>
+		/// Linux 下通过 recvmmsg 一次系统调用接收多个数据报，接收缓存为 数量 * 接收缓存长度
+		void SetRecvBatch(const unsigned int n_nCount);
+
+		/// <summary>
+		/// 启用 UDP 分段卸载，在Start(Receiver)前设置，仅 Linux 有效
+		/// </summary>
+		/// 发送: SendBatch 将长度相同的连续数据报合并为一个缓存，通过 UDP_SEGMENT 由内核拆分；
+		/// 接收: 启用 UDP_GRO，内核合并的数据报在回调前按分段长度拆分，
+		/// 每个数据报的接收缓存扩大至 64K 以完整接收合并的数据
+		void SetUdpOffload(const bool n_bEnable);
+
 		// 设置接收事件回调及消息回调
 		void SetTinyCallback(ITinyCallback* n_TinyCallback);
 
+		/// <summary>
+		/// 获取收发统计的快照，包括所有连接
+		/// </summary>
+		/// 计数按线程分散在独立的缓存行中，读取时汇总，各项不保证为同一时刻的值；
+		/// 单个连接的计数通过 FNetNode::Stats 获取
+		FNetStats GetStats() const;
+		// 统计清零
+		void ResetStats();
+
 	protected:
 		void Startup();
 		void Cleanup();
 
+		// 单个数据报的接收缓存长度
+		const int DatagramBuffSize() const;
+
 	protected:
 #if defined(_WIN32) || defined(_WIN64)
 		static int m_nRef;
 #endif
 		int				m_nBuffSize = 1024;
+		// UDP 单次批量接收的数据报数量
+		unsigned int	m_nRecvBatch = 32;
+		// UDP_SEGMENT / UDP_GRO
+		bool			m_bUdpOffload = false;
 		// 回调接口
 		ITinyCallback*	m_TinyCallback = nullptr;
+		// 收发统计
+		CNetCounters	m_Counters;
 	};
 #pragma endregion
 
@@ -311,6 +441,7 @@ namespace tinynet
 		/// 退出组播
 		/// </summary>
 		/// <returns></returns>
+		/// 结束接收线程并等待其退出，返回后不再调用接收回调；在接收回调中调用时不等待
 		int Release();
 
 		/// <summary>
@@ -322,6 +453,15 @@ namespace tinynet
 		int Send(const char* n_szData, const int n_nSize);
 		int Send(const std::string n_sData);
 
+		/// <summary>
+		/// 批量发送组播消息，每个数据片段为一个数据报
+		/// </summary>
+		/// <param name="n_pMessages">消息</param>
+		/// <param name="n_nCount">消息数量</param>
+		/// <returns>发送的消息数量，失败返回 -1</returns>
+		/// Linux 下通过 sendmmsg 一次系统调用发送多个数据报
+		int SendBatch(const FNetIoVec* n_pMessages, const int n_nCount);
+
 		// 数据接收回调
 		std::function<void(const char*, int)> fnRecvCallback = nullptr;
 	protected:
@@ -331,6 +471,9 @@ namespace tinynet
 		FNetNode	m_NetNode;
 
 		std::string m_sLocalIp;
+		// 接收线程
+		std::thread	m_thread;
+		std::atomic<bool> m_bRun{ false };
 	};
 #pragma endregion
 
@@ -358,13 +501,84 @@ namespace tinynet
 		/// <param name="n_nTimeoutCnt">心跳允许超时次数</param>
 		virtual void EnableHeart(unsigned int n_nPeriod, unsigned int n_nTimeoutCnt);
 		
-		// 设置超时，在Start前设置
+		// 设置超时(发送及客户端连接)，在Start前设置
 		void SetTimeout(int n_nMilliSeconds);
 		// 设置TTL，取值范围：0~255，在Start前设置
 		void SetTTL(int n_nTTL);
 
+		/// <summary>
+		/// 设置 I/O 模型，在Start前设置
+		/// </summary>
+		/// io_uring 需编译时启用 TINYNET_IO_URING 且内核为 6.0 及以上，不支持时使用默认模型
+		void SetIoEngine(const EIoEngine n_eEngine);
+		// 实际使用的 I/O 模型，Start 后有效
+		const EIoEngine GetIoEngine() const;
+
+		/// <summary>
+		/// 启用延时追踪，在Start前设置
+		/// </summary>
+		/// 按阶段记录每个数据包的延时分布：内核接收到工作线程取出(Linux epoll，需 SO_TIMESTAMPING)、
+		/// 取出到拆分出完整数据包、数据回调耗时，以及服务端 TCP 连接(epoll)发送到内核调度发送的延时
+		void EnableLatencyTrace(const bool n_bEnable);
+		// 获取阶段的延时分布(纳秒)，未启用时为空
+		FLatencySummary GetLatency(const ELatencyStage n_eStage) const;
+		// 延时记录清零
+		void ResetLatency();
+
+		/// <summary>
+		/// 设置回调线程，在Start前设置
+		/// </summary>
+		/// <param name="n_nWorkers">回调线程数，0 表示在 I/O 线程直接回调(默认)</param>
+		/// <param name="n_nMaxPending">每个连接未执行的回调上限，达到后暂停读取该连接，降到一半时恢复</param>
+		/// 数据及事件回调交给回调线程执行，同一连接固定在一个线程、按接收顺序回调，慢回调不再阻塞其他连接的收发；
+		/// 数据包复制一次(跨越读取边界的数据包直接转移)，连接在其所有回调执行后才释放；
+		/// UDP 会话及 Windows 下不暂停读取，UDP 超出上限的数据报丢弃并计入 Drops
+		void SetCallbackWorkers(const unsigned int n_nWorkers, const unsigned int n_nMaxPending = 1024);
+
+		/// <summary>
+		/// 设置发送队列的高低水位(字节)，之后建立的连接生效
+		/// </summary>
+		/// <param name="n_nHigh">未发送的数据达到该值时触发 ENetEvent::Unwritable 事件，0 不启用(默认)</param>
+		/// <param name="n_nLow">降到该值时触发 ENetEvent::Writable 事件</param>
+		/// 仅 Linux 下服务端接收的 TCP 连接及连接池的连接有发送队列，可通过 FNetNode::SetWriteWatermark 单独设置；
+		/// 不可写事件在调用 Send 的线程触发，可写事件在连接所属的 I/O 线程触发，两者交替且与最终状态一致
+		void SetWriteWatermark(const size_t n_nHigh, const size_t n_nLow);
+
+		/// <summary>
+		/// 暂停读取连接，任意线程调用，由连接所属的 I/O 线程执行
+		/// </summary>
+		/// <returns>连接不存在或不支持返回 false</returns>
+		/// 仅 Linux 下服务端接收的 TCP 连接及连接池的连接支持；
+		/// 转发时可在目标连接的 Unwritable 事件中暂停读取来源连接，Writable 事件中恢复，使缓存的数据有上限
+		bool PauseRead(FNetNode* n_pNetNode);
+		// 恢复读取 PauseRead 暂停的连接
+		bool ResumeRead(FNetNode* n_pNetNode);
+
+		/// <summary>
+		/// 投递任务到连接的回调线程，与该连接的回调串行执行
+		/// </summary>
+		/// <param name="n_nId">连接Id</param>
+		/// <returns>未启动、不支持或交给 I/O 线程时连接不存在返回 false，任务不会执行</returns>
+		/// 启用回调线程时交给该连接的回调线程，否则交给所属的 I/O 线程(仅 Linux 下服务端及连接池)；
+		/// 任务执行时连接可能已关闭
+		bool Post(const unsigned long long n_nId, std::function<void()> n_fnTask);
+
 		const bool IsRunning() const { return m_bRun; }
 
+		/// <summary>
+		/// 添加定时器
+		/// </summary>
+		/// <param name="n_nDelay">首次触发的延时(毫秒)</param>
+		/// <param name="n_nPeriod">触发周期(毫秒)，0 表示只触发一次</param>
+		/// <param name="n_fnCallback">回调</param>
+		/// <returns>定时器Id，失败返回 0</returns>
+		/// 所有实例共享一个定时器线程(时间轮)，回调在该线程执行，不应长时间阻塞
+		static unsigned long long AddTimer(const unsigned int n_nDelay,
+			const unsigned int n_nPeriod, std::function<void()> n_fnCallback);
+
+		// 取消定时器，返回后回调不会再执行；在回调中取消时不等待
+		static bool CancelTimer(const unsigned long long n_nId);
+
 		/// <summary>
 		/// 事件回调
 		/// </summary>
@@ -389,33 +603,85 @@ namespace tinynet
 		virtual bool OnEventMessage(FNetNode* n_pNetNode, const char* n_szData, const int n_nSize);
 
 		/// <summary>
-		/// 接收到 TCP 数据
+		/// 接收到 TCP 数据，循环拆分出所有完整数据包
 		/// </summary>
 		/// <param name="FNetNode*">产生数据的Socket节点</param>
-		/// <param name="std::string&">未处理完的数据（不是完整数据包）</param>
+		/// <param name="std::string&">未处理完的数据（跨越读取边界的数据包）</param>
 		/// <param name="const char*">接收的数据</param>
 		/// <param name="const int">接收的长度</param>
+		/// 完整的数据包直接从接收的数据回调，只有跨越读取边界的数据包才会复制到缓存
 		void ReceiveTcpMessage(FNetNode* n_pNetNode, 
 			std::string& n_sLast, const char* n_szData, const int n_nSize);
 
+		// 分发一个完整的数据包(含数据头)，事件消息或数据回调；n_pFrame 为缓存该数据包的字符串，交给回调线程时直接转移
+		void DispatchFrame(FNetNode* n_pNetNode, const char* n_szData, const int n_nSize,
+			std::string* n_pFrame = nullptr);
+
 		/// <summary>
 		/// 接收到 UDP 数据
 		/// </summary>
 		/// <param name="FNetNode*">产生数据的Socket节点</param>
 		/// <param name="const char*">接收的数据</param>
 		/// <param name="const int">接收的长度</param>
-		void ReceiveUdpMessage(FNetNode* n_pNetNode, const char* n_szData, const int n_nSize);
+		/// <param name="const bool">节点只在本次回调中有效(如地址为发送方的监听节点)，不交给回调线程</param>
+		void ReceiveUdpMessage(FNetNode* n_pNetNode, const char* n_szData, const int n_nSize,
+			const bool n_bDirect = false);
 
 		void OnEventCallback(FNetNode* n_pNetNode, 
 			const ENetEvent n_eNetEvent, const std::string& n_sData);
 
 		void OnRecvCallback(FNetNode* n_pNetNode, const char* n_szData, const int n_nSize);
 
+		// 启动及停止回调线程，停止时执行完已投递的回调
+		void StartCallbacks();
+		void StopCallbacks();
+
+		/// <summary>
+		/// 数据包交给回调线程
+		/// </summary>
+		/// <param name="n_sFrame">数据包，回调的数据从 n_nOffset 开始，长 n_nSize</param>
+		/// <param name="n_bDropFull">未执行的回调达到上限时丢弃，否则暂停读取</param>
+		/// <returns>未启用回调线程返回 false，由调用者直接回调</returns>
+		bool DeferRecv(FNetNode* n_pNetNode, std::string&& n_sFrame, const size_t n_nOffset,
+			const int n_nSize, const bool n_bDropFull);
+
+		// 释放节点，启用回调线程时在该连接已投递的回调执行后释放
+		void RetireNode(FNetNode* n_pNetNode, std::function<void()> n_fnRelease);
+
+#if !defined(_WIN32) && !defined(_WIN64)
+		// 创建连接的发送队列，设置水位及可写事件
+		FSendQueue* CreateSendQueue(FNetNode* n_pNetNode);
+#endif
+		// 添加或移除暂停读取连接的原因，投递到所属 I/O 线程执行；不支持返回 false
+		virtual bool PostReadPause(const unsigned long long /*n_nId*/, const unsigned char /*n_nReason*/,
+			const bool /*n_bPause*/) { return false; }
+		// 投递任务到连接所属的 I/O 线程；连接不存在或不支持返回 false
+		virtual bool PostToNode(const unsigned long long /*n_nId*/, std::function<void()> /*n_fnTask*/) { return false; }
+
+		// 连接未执行的回调达到上限，暂停读取，在 I/O 线程调用
+		virtual void OnCallbackBacklog(FNetNode* /*n_pNetNode*/) {}
+		// 未执行的回调降到上限的一半，恢复读取，在回调线程调用；n_nKey 为连接Id(无Id 时为节点地址)
+		virtual void OnCallbackDrained(const unsigned long long /*n_nKey*/) {}
+
 	protected:
 		// 默认3秒超时
 		int			m_nTimeout = 3000;
 		// TTL
 		int			m_nTTL = -1;
+		// 设置的 I/O 模型
+		EIoEngine	m_eIoEngine = EIoEngine::Default;
+		// 是否使用 io_uring
+		bool		m_bUring = false;
+		// 延时追踪，未启用时为空
+		CLatencyTrace*	m_pTrace = nullptr;
+		// 回调线程数及每个连接未执行的回调上限
+		unsigned int	m_nCallbackWorkers = 0;
+		unsigned int	m_nMaxPending = 1024;
+		// 回调线程，未启用时为空
+		CSerialExecutor* m_pExecutor = nullptr;
+		// 新连接发送队列的高低水位，高水位为 0 不启用
+		size_t			m_nHighWater = 0;
+		size_t			m_nLowWater = 0;
 
 		bool		m_bRun = false;
 	};
@@ -432,10 +698,32 @@ namespace tinynet
 		bool Start() override;
 		void Stop() override;
 
-		// 获取 TCP 客户端
-		const std::list<FNetNode*>& GetClients();
+		// 获取 TCP 客户端(快照)
+		std::vector<FNetNode*> GetClients();
+		// 按连接Id 获取 TCP 客户端，不存在返回 nullptr
+		FNetNode* GetClient(const unsigned long long n_nId);
+		// 获取 TCP 客户端数量
+		const size_t GetClientCount();
+
+		/// <summary>
+		/// 广播消息给 TCP 客户端
+		/// </summary>
+		/// <param name="n_szData">消息内容</param>
+		/// <param name="n_nSize">消息长度</param>
+		/// <param name="n_fnFilter">筛选客户端，返回 true 则发送，为空则发送给所有客户端；
+		/// 在客户端列表锁外调用，可在其中调用 GetClient、Send 等接口，连接的有效性同 GetClients</param>
+		/// <returns>发送的客户端数量</returns>
+		/// 消息只编码一次，所有连接共享同一份数据；Linux 下加入各连接的发送队列后由所属 Reactor 发送，
+		/// 单个连接发送失败只关闭该连接
+		int Broadcast(const char* n_szData, const int n_nSize,
+			const std::function<bool(FNetNode*)>& n_fnFilter = nullptr);
+		int Broadcast(const std::string& n_sData,
+			const std::function<bool(FNetNode*)>& n_fnFilter = nullptr);
 
 	protected:
+		// 在锁外对客户端列表的快照调用筛选回调，返回选中连接的 Id
+		std::vector<unsigned long long> FilterClients(const std::function<bool(FNetNode*)>& n_fnFilter);
+
 #if defined(_WIN32) || defined(_WIN64)
 		bool InitSock();
 		void Accept();
@@ -453,16 +741,103 @@ namespace tinynet
 		void FreeSocketNodes();
 #else
 		bool InitSock();
-		void WorkerThread();
+		void WorkerThread(FReactor* n_pReactor);
+		// io_uring 模式的工作线程
+		void RingWorkerThread(FReactor* n_pReactor);
 
 	public:
 		void SetEt(const bool et = true);
+
+		/// <summary>
+		/// 设置单次可读事件最多读取(接收连接)的次数，默认16
+		/// </summary>
+		/// ET 模式下达到上限仍未读完的连接，在下一轮事件循环继续读取，避免单个连接独占 Reactor
+		void SetReadBudget(const unsigned int n_nReads);
+
+		/// <summary>
+		/// 设置 Reactor 线程数，每个线程拥有独立的 epoll，在Start前设置
+		/// </summary>
+		/// <param name="n_nNum">线程数，为0 则使用CPU核数，默认1</param>
+		/// <param name="n_eBalance">新连接分配策略</param>
+		/// 连接的收发及回调始终在其所属的 Reactor 线程执行
+		void SetReactorNum(const unsigned int n_nNum, 
+			const EBalance n_eBalance = EBalance::LeastConnections);
+
+		/// <summary>
+		/// 启用 SO_REUSEPORT 模式，在Start前设置
+		/// </summary>
+		/// <param name="n_bEnable">每个 Reactor 绑定独立的监听 Socket，由内核分配新连接及数据报，适用于TCP, UDP</param>
+		/// <param name="n_bCpuSteering">按接收数据的CPU选择 Socket，并将 Reactor 线程绑定到对应CPU</param>
+		void SetReusePort(const bool n_bEnable, const bool n_bCpuSteering = false);
+
+		/// <summary>
+		/// 设置空闲超时，在Start前设置
+		/// </summary>
+		/// <param name="n_nMilliSeconds">超时(毫秒)，0 表示不检测，默认0</param>
+		/// 超时未收到数据的 TCP 连接及 UDP 会话触发 ENetEvent::Quit 事件后关闭；
+		/// 每个 Reactor 按最近活动时间维护连接链表，收到数据时移到表尾，只检查表头已超时的连接
+		void SetIdleTimeout(const unsigned int n_nMilliSeconds);
 	protected:
+		// 创建并绑定(TCP 监听) Socket
+		bool BindSocket(size_t& n_nFd);
 		int SetNonblock(int n_nFd);
-		int AddSocketIntoPoll(FNetNode* n_pNetNode);
-		int DelSocketFromPoll(int n_nFd);
+		int AddSocketIntoPoll(FNetNode* n_pNetNode, FReactor* n_pReactor);
+		int DelSocketFromPoll(FNetNode* n_pNetNode);
+		// 选择新连接所属的 Reactor
+		FReactor* SelectReactor();
+		// 读取可读的 Socket
+		void ReadSocket(FReactor* n_pReactor, FNetNode* n_pNetNode, char* n_szBuff);
+		// 批量读取 UDP 数据报
+		void ReadDatagrams(FReactor* n_pReactor, FNetNode* n_pNetNode, char* n_szBuff);
+		// 批量接收新连接
+		void AcceptSocket(FReactor* n_pReactor);
+		// 创建新连接的节点，分配 Reactor
+		void CreateSocketNode(FReactor* n_pReactor, int n_nFd, const stSockaddrIn* n_pAddr);
+		// 新连接加入所属的 Reactor
+		void AttachSocketNode(FNetNode* n_pNetNode);
+		// 发送广播加入队列的数据，在所属 Reactor 线程调用
+		void FlushSocketNodes(const std::vector<unsigned long long>& n_vecIds);
 		void FreeSocketNode(FNetNode** n_pNetNode);
+		// 关闭 Socket 并释放节点，启用回调线程时在该连接的回调执行后释放
+		void ReleaseSocketNode(FNetNode* n_pNetNode);
 		void FreeSocketNodes();
+		// 退出并释放所有 Reactor；在 Reactor 线程的回调中调用时，该 Reactor 及所有连接交给其线程释放
+		void FreeReactors();
+		// 关闭 Reactor 的 epoll、UDP 会话及独有的监听 Socket
+		void ReleaseReactor(FReactor* n_pReactor);
+		// Reactor 线程退出时释放在其回调中调用 Stop 时交给它的 Reactor 及连接
+		void ReleaseOrphans(FReactor* n_pReactor);
+		// 关闭超时未收到数据的连接，在所属 Reactor 线程调用
+		void ReapIdleNodes(FReactor* n_pReactor);
+		/// <summary>
+		/// 分发 UDP 数据报
+		/// </summary>
+		/// 已建立会话的发送方使用其会话节点，上线消息(kHelloId)创建会话，退出消息(kQuitId)释放会话；
+		/// 未建立会话的发送方使用监听节点，回复地址为数据报的发送方
+		void DispatchDatagram(FReactor* n_pReactor, FNetNode* n_pListener,
+			const char* n_szAddr, const char* n_szData, const int n_nSize);
+		// 释放 UDP 会话，在所属 Reactor 线程调用
+		void FreePeerNode(FReactor* n_pReactor, FNetNode* n_pNetNode);
+		// 添加或移除暂停读取 TCP 连接的原因，没有原因时恢复读取，在所属 Reactor 线程调用
+		void SetReadPause(FNetNode* n_pNetNode, const unsigned char n_nReason, const bool n_bPause);
+		bool PostReadPause(const unsigned long long n_nId, const unsigned char n_nReason,
+			const bool n_bPause) override;
+		bool PostToNode(const unsigned long long n_nId, std::function<void()> n_fnTask) override;
+		void OnCallbackBacklog(FNetNode* n_pNetNode) override;
+		void OnCallbackDrained(const unsigned long long n_nKey) override;
+
+		// 创建 Reactor 的 io_uring 及接收缓存
+		bool CreateRing(FReactor* n_pReactor);
+		// 提交多次触发的接收(TCP 监听为 accept)
+		int ArmRecv(FReactor* n_pReactor, FNetNode* n_pNetNode);
+		// 取消连接多次触发的接收
+		void CancelRecv(FReactor* n_pReactor, FNetNode* n_pNetNode);
+		// 已关闭的连接在最后一个请求结束后释放，返回连接是否已关闭
+		bool FinishClosing(FReactor* n_pReactor, FNetNode* n_pNetNode);
+		// 以链接的 SQE 提交发送队列中的数据，在所属 Reactor 线程调用
+		void SubmitSendQueue(FReactor* n_pReactor, FNetNode* n_pNetNode);
+		// 处理完成事件
+		void OnRingEvent(FReactor* n_pReactor, const struct io_uring_cqe* n_pCqe);
 #endif
 
 	protected:
@@ -474,11 +849,25 @@ namespace tinynet
 		void*			m_hIocp = nullptr;
 		std::thread*	m_threads = nullptr;
 #else
-		int				m_nEpfd = 0;
 		bool			m_bEt = true;
+		// 单次可读事件最多读取次数
+		unsigned int	m_nReadBudget = 16;
+		// Reactor 数组，第一个 Reactor 负责监听
+		FReactor*		m_pReactors = nullptr;
+		unsigned int	m_nReactorNum = 1;
+		// 实际运行的 Reactor 数
+		unsigned int	m_nReactorCnt = 0;
+		// 轮询序号
+		unsigned int	m_nNextReactor = 0;
+		EBalance		m_eBalance = EBalance::LeastConnections;
+		bool			m_bReusePort = false;
+		bool			m_bCpuSteering = false;
+		// 空闲超时(毫秒)
+		unsigned int	m_nIdleTimeout = 0;
 #endif
 		std::mutex		m_mutex;
-		std::list<FNetNode*> m_lstNodes;
+		// 已连接的客户端，以连接Id 索引
+		CSlotMap<FNetNode*> m_Nodes;
 	};
 #pragma endregion
 
@@ -510,11 +899,42 @@ namespace tinynet
 		// 手动发送心跳包
 		int SendHeart();
 
+		/// <summary>
+		/// 启用自动重连，在Start前设置
+		/// </summary>
+		/// <param name="n_nMinDelay">首次重连的延时(毫秒)，0 表示禁用，默认禁用</param>
+		/// <param name="n_nMaxDelay">重连延时上限(毫秒)，每次失败后延时加倍</param>
+		/// <param name="n_nMaxTimes">最大连续重连次数，0 表示不限</param>
+		/// 连接断开或心跳超时后重连，实际延时在 [延时/2, 延时] 内随机，避免大量客户端同时重连；
+		/// 每次重连前触发 ENetEvent::Reconnect 事件，成功后重新发送 Hello 并触发 Ready 事件，
+		/// 收到服务端的 Hello 回复后重置次数及延时；调用 Stop 或重连次数用尽时触发 Quit 事件
+		void SetReconnect(const unsigned int n_nMinDelay, 
+			const unsigned int n_nMaxDelay = 30000, const unsigned int n_nMaxTimes = 0);
+
 	protected:
 		bool InitSock();
+		// 创建 Socket 并在超时内连接服务端
+		bool ConnectSock(size_t& n_nFd);
+		// 启用 UDP 分段卸载及 io_uring
+		void InitEngine();
+		// 等待退避延时后重连，成功返回 true，停止或次数用尽返回 false
+		bool Reconnect();
 		void WorkerThread();
-		// 心跳线程
-		void HeartThread();
+		// 接收数据，直到连接断开
+		void ReadSocket(char* n_szBuff);
+#if !defined(_WIN32) && !defined(_WIN64)
+		// 批量接收 UDP 数据报，直到 Socket 关闭
+		void ReadDatagrams(char* n_szBuff);
+		// 通过 io_uring 接收数据，直到 Socket 关闭
+		void ReadRing();
+#endif
+		// 心跳定时器回调
+		void OnHeartTimer();
+		// 心跳超时，断开连接，启用重连时由工作线程重连，否则工作线程退出；不等待工作线程
+		void HeartLost();
+		// 未执行的回调达到上限时等待，降到一半或停止时返回
+		void WaitCallbacks();
+		void OnCallbackDrained(const unsigned long long n_nKey) override;
 		void Join();
 
 		// 事件消息
@@ -533,7 +953,157 @@ namespace tinynet
 		unsigned int	m_nHeartPeriod = 0;
 		// 心跳允许超时次数
 		unsigned int 	m_nHeartTimeoutCnt = 0;
+		// 心跳定时器
+		unsigned long long m_nHeartTimer = 0;
+		// 最近发送的心跳序号
+		unsigned int	m_nHeartSent = 0;
+		// 心跳连续失败次数
+		unsigned int	m_nHeartFail = 0;
+
+		// 重连延时范围(毫秒)，为0 表示不重连
+		unsigned int	m_nReconnectMin = 0;
+		unsigned int	m_nReconnectMax = 0;
+		// 最大连续重连次数，0 表示不限
+		unsigned int	m_nReconnectTimes = 0;
+		// 连续重连次数及下次重连的延时
+		unsigned int	m_nReconnectCnt = 0;
+		unsigned int	m_nReconnectDelay = 0;
+		// 保护 Socket 的替换与关闭
+		std::mutex		m_mutex;
+		// 唤醒等待重连的工作线程
+		std::condition_variable m_cvReconnect;
+		// 唤醒等待回调执行的工作线程
+		std::condition_variable m_cvBacklog;
+#if !defined(_WIN32) && !defined(_WIN64)
+		// io_uring 模式下由工作线程使用并释放
+		CUring*			m_pRing = nullptr;
+#endif
 	};
+#pragma endregion
+	////////////////////////////////////////////////////////////////////////////////
+#pragma region 客户端连接池
+#if !defined(_WIN32) && !defined(_WIN64)
+	// 连接池的服务端地址及负载
+	struct FPoolServer;
+
+	/// <summary>
+	/// 客户端连接池，仅 Linux，TCP
+	/// </summary>
+	/// 由少量 Reactor 线程(各有一个 epoll)驱动多个连接，连接均为非阻塞 connect，
+	/// 超过 SetTimeout 设置的时间未连接成功则关闭；
+	/// 回调与 CTinyClient 相同，产生事件的节点为各个连接，回调在连接所属的 Reactor 线程执行
+	class CTinyClientPool : public ITinyNet
+	{
+	public:
+		CTinyClientPool();
+		~CTinyClientPool();
+
+		bool Start() override;
+		void Stop() override;
+
+		/// <summary>
+		/// 启用心跳包，在Start前设置
+		/// </summary>
+		/// <param name="n_nPeriod">心跳周期(毫秒)</param>
+		/// <param name="n_nTimeoutCnt">心跳允许超时次数</param>
+		/// 超时的连接触发 ENetEvent::Quit 事件后关闭
+		void EnableHeart(unsigned int n_nPeriod, unsigned int n_nTimeoutCnt) override;
+
+		// 添加服务端地址，在Start前设置；Init 设置的地址为第一个服务端
+		void AddServer(const std::string& n_sHost, const unsigned short n_nPort);
+
+		/// <summary>
+		/// 设置 Reactor 线程数及负载均衡策略，在Start前设置
+		/// </summary>
+		/// <param name="n_nNum">线程数，为0 则使用CPU核数，默认1</param>
+		/// <param name="n_eBalance">选择服务端及发送连接的策略，RoundRobin 或 LeastOutstanding</param>
+		void SetReactorNum(const unsigned int n_nNum,
+			const EBalance n_eBalance = EBalance::RoundRobin);
+
+		/// <summary>
+		/// 建立连接，在Start后调用
+		/// </summary>
+		/// <param name="n_nCount">连接数</param>
+		/// <returns>发起的连接数，未启动返回 -1</returns>
+		/// 按负载均衡策略选择服务端，连接成功后触发 ENetEvent::Ready 事件，失败或断开触发 ENetEvent::Quit 事件；
+		/// 可在回调中调用，如断开后重新连接
+		int Connect(const unsigned int n_nCount = 1);
+
+		/// <summary>
+		/// 按负载均衡策略选择一个已建立的连接发送消息
+		/// </summary>
+		/// <returns>发送的长度，没有可用连接返回 -1</returns>
+		/// 每发送一条消息计为该连接的一个未完成请求，收到一条数据消息时减一；
+		/// LeastOutstanding 随机选取两个连接，使用未完成请求较少的一个
+		int Send(const char* n_szData, const int n_nSize);
+		int Send(const std::string& n_sData);
+
+		// 获取已建立的连接(快照)
+		std::vector<FNetNode*> GetConnections();
+		// 按连接Id 获取连接，不存在返回 nullptr
+		FNetNode* GetConnection(const unsigned long long n_nId);
+		// 获取已建立的连接数量
+		const size_t GetConnectionCount();
+
+	protected:
+		void WorkerThread(FReactor* n_pReactor);
+		// 新连接加入所属的 Reactor
+		void AttachConnection(FNetNode* n_pNetNode);
+		// 连接完成(成功或失败)
+		void OnConnected(FReactor* n_pReactor, FNetNode* n_pNetNode);
+		// 读取可读的连接
+		void ReadConnection(FReactor* n_pReactor, FNetNode* n_pNetNode, char* n_szBuff);
+		// 触发退出事件并释放连接，在所属 Reactor 线程调用
+		void FreeConnection(FReactor* n_pReactor, FNetNode* n_pNetNode);
+		// 暂停及恢复读取未执行回调达到上限的连接
+		bool PostReadPause(const unsigned long long n_nId, const unsigned char n_nReason,
+			const bool n_bPause) override;
+		bool PostToNode(const unsigned long long n_nId, std::function<void()> n_fnTask) override;
+		void OnCallbackBacklog(FNetNode* n_pNetNode) override;
+		void OnCallbackDrained(const unsigned long long n_nKey) override;
+		// 发送心跳包并关闭超时的连接，在所属 Reactor 线程调用
+		void SendHearts(FReactor* n_pReactor);
+		// 退出并释放所有 Reactor 及连接
+		void FreeReactors();
+		// 选择新连接的服务端，需持有 m_mutex
+		FPoolServer* SelectServer();
+		// 选择发送的连接，需持有 m_mutex
+		FNetNode* SelectConnection();
+
+		// 事件消息
+		bool OnEventMessage(FNetNode* n_pNetNode, const char* n_szData, const int n_nSize) override;
+
+	protected:
+		FReactor*		m_pReactors = nullptr;
+		unsigned int	m_nReactorNum = 1;
+		// 实际运行的 Reactor 数
+		unsigned int	m_nReactorCnt = 0;
+		EBalance		m_eBalance = EBalance::RoundRobin;
+
+		// AddServer 添加的服务端 sockaddr
+		std::vector<std::string> m_vecAddrs;
+		// 运行中的服务端，第一个为 Init 设置的地址
+		std::vector<FPoolServer*> m_vecServers;
+
+		// 心跳周期
+		unsigned int	m_nHeartPeriod = 0;
+		// 心跳允许超时次数
+		unsigned int 	m_nHeartTimeoutCnt = 0;
+
+		// 以下受 m_mutex 保护
+		std::mutex		m_mutex;
+		// 已建立的连接，以连接Id 索引
+		CSlotMap<FNetNode*> m_Nodes;
+		// 轮询序号
+		unsigned int	m_nNextReactor = 0;
+		unsigned int	m_nNextServer = 0;
+		unsigned int	m_nNextNode = 0;
+		// 新连接的序号，作为所属 Reactor 中的索引
+		unsigned long long m_nNextKey = 0;
+		// 选择连接的随机数状态
+		unsigned long long m_nSeed = 0x9E3779B97F4A7C15ull;
+	};
+#endif
 #pragma endregion
 }
 
@@ -0,0 +1,135 @@
+#ifndef __URING_H__
+#define __URING_H__
+#if defined(TINYNET_IO_URING)
+#include <cstddef>
+#include <linux/io_uring.h>
+
+namespace tinynet
+{
+	/// <summary>
+	/// io_uring 的简单封装，直接使用系统调用，不依赖 liburing
+	/// </summary>
+	/// 只能在一个线程中提交及处理完成事件；
+	/// 以 R_DISABLED 方式创建，由使用的线程调用 Enable 后才能提交
+	class CUring
+	{
+	public:
+		CUring() = default;
+		~CUring();
+
+		CUring(const CUring&) = delete;
+		CUring& operator=(const CUring&) = delete;
+
+		/// <summary>
+		/// 创建 ring，内核不支持所需功能时返回 false
+		/// </summary>
+		/// <param name="n_nEntries">提交队列长度，完成队列为其8倍</param>
+		/// 需要多次触发的 accept/recv 及提供缓存环 (Linux 6.0)
+		bool Init(const unsigned int n_nEntries);
+		// 取消未完成的请求并等待其结束后释放，需在提交线程调用
+		void Exit();
+
+		// 启用 ring，调用线程成为唯一的提交者
+		bool Enable();
+
+		const bool IsValid() const { return m_nFd > 0; }
+
+		// 获取空闲 SQE 并清零，提交队列已满时先提交
+		struct io_uring_sqe* GetSqe();
+		// 提交队列剩余空间，链接的 SQE 需在同一次提交中
+		const unsigned int SqSpace() const;
+		// 已获取 SQE、尚未收到最终完成事件的请求数
+		const unsigned int Inflight() const { return m_nInflight; }
+
+		/// <summary>
+		/// 提交并等待完成事件
+		/// </summary>
+		/// <param name="n_nWait">至少等待的完成事件数</param>
+		/// <param name="n_nTimeout">最长等待时间(毫秒)，-1 表示不限，超时返回 -1 且 errno 为 ETIME</param>
+		/// <returns>提交的数量，失败返回 -1</returns>
+		int Submit(const unsigned int n_nWait = 0, const int n_nTimeout = -1);
+
+		/// <summary>
+		/// 依次处理已完成的事件
+		/// </summary>
+		/// <returns>处理的数量</returns>
+		template <typename FCallback>
+		unsigned int ForEachCqe(FCallback n_fnCallback)
+		{
+			unsigned int nCount = 0;
+			unsigned int nHead = *m_pCqHead;
+
+			for (;;)
+			{
+				unsigned int nTail = __atomic_load_n(m_pCqTail, __ATOMIC_ACQUIRE);
+				if (nHead == nTail) break;
+
+				for (; nHead != nTail; nHead++, nCount++)
+				{
+					auto pCqe = &m_pCqes[nHead & m_nCqMask];
+					// 多次触发的请求在最后一个完成事件结束
+					if (!(pCqe->flags & IORING_CQE_F_MORE)) m_nInflight--;
+					n_fnCallback(pCqe);
+				}
+
+				// 回调中可能提交新的请求，及时释放完成队列
+				__atomic_store_n(m_pCqHead, nHead, __ATOMIC_RELEASE);
+			}
+
+			return nCount;
+		}
+
+		/// <summary>
+		/// 注册提供缓存环，接收时由内核选择缓存
+		/// </summary>
+		/// <param name="n_nGroup">缓存组Id</param>
+		/// <param name="n_nCount">缓存数量，向上取整为 2 的幂</param>
+		/// <param name="n_nSize">单个缓存长度</param>
+		bool SetupBufRing(const unsigned short n_nGroup, unsigned int n_nCount, const unsigned int n_nSize);
+
+		// 缓存地址
+		char* GetBuffer(const unsigned short n_nBid) const;
+		// 归还缓存，CommitBuffers 后内核可见
+		void RecycleBuffer(const unsigned short n_nBid);
+		void CommitBuffers();
+
+		const unsigned int BufferSize() const { return m_nBufSize; }
+
+	protected:
+		int				m_nFd = 0;
+
+		// 提交队列
+		void*			m_pSqRing = nullptr;
+		size_t			m_nSqRingSize = 0;
+		unsigned int*	m_pSqHead = nullptr;
+		unsigned int*	m_pSqTail = nullptr;
+		unsigned int	m_nSqMask = 0;
+		unsigned int	m_nSqEntries = 0;
+		struct io_uring_sqe* m_pSqes = nullptr;
+		size_t			m_nSqesSize = 0;
+		// 已填充、未提交的 SQE 尾部
+		unsigned int	m_nSqeTail = 0;
+		unsigned int	m_nInflight = 0;
+
+		// 完成队列
+		void*			m_pCqRing = nullptr;
+		size_t			m_nCqRingSize = 0;
+		unsigned int*	m_pCqHead = nullptr;
+		unsigned int*	m_pCqTail = nullptr;
+		unsigned int	m_nCqMask = 0;
+		struct io_uring_cqe* m_pCqes = nullptr;
+
+		// 提供缓存环
+		struct io_uring_buf_ring* m_pBufRing = nullptr;
+		size_t			m_nBufRingSize = 0;
+		char*			m_szBuffers = nullptr;
+		unsigned int	m_nBufCount = 0;
+		unsigned int	m_nBufSize = 0;
+		unsigned short	m_nBufGroup = 0;
+		unsigned short	m_nBufTail = 0;
+		bool			m_bBufDirty = false;
+	};
+}
+
+#endif // TINYNET_IO_URING
+#endif // !__URING_H__
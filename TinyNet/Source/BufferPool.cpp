@@ -0,0 +1,280 @@
+#include "BufferPool.h"
+#include <cstdlib>
+#include <atomic>
+#include <mutex>
+#include <list>
+#include <vector>
+#include <algorithm>
+
+namespace tinynet
+{
+	// 最小规格 64 字节
+	constexpr int kMinClassShift = 6;
+	// 最大规格 1M
+	constexpr int kMaxClassShift = 20;
+	constexpr int kClassNum = kMaxClassShift - kMinClassShift + 1;
+
+	// 每个规格线程缓存的最大字节数
+	constexpr size_t kThreadCacheBytes = 1024 * 256;
+	// 每个规格线程缓存的最大数量
+	constexpr size_t kThreadCacheCount = 128;
+	// 每个规格全局缓存的最大字节数
+	constexpr size_t kGlobalCacheBytes = 1024 * 1024 * 8;
+
+	// 规格序号，超出最大规格返回 -1
+	static int SizeClass(const size_t n_nSize)
+	{
+		int nShift = kMinClassShift;
+		while (nShift <= kMaxClassShift && ((size_t)1 << nShift) < n_nSize) nShift++;
+
+		return nShift > kMaxClassShift ? -1 : nShift - kMinClassShift;
+	}
+
+	static size_t ClassSize(const int n_nClass)
+	{
+		return (size_t)1 << (n_nClass + kMinClassShift);
+	}
+
+	static size_t ThreadCacheMax(const int n_nClass)
+	{
+		auto nCount = kThreadCacheBytes / ClassSize(n_nClass);
+		return std::max<size_t>(2, std::min(nCount, kThreadCacheCount));
+	}
+
+	static size_t GlobalCacheMax(const int n_nClass)
+	{
+		return std::max<size_t>(4, kGlobalCacheBytes / ClassSize(n_nClass));
+	}
+
+	// 只由所属线程修改，其他线程读取统计
+	static void Increase(std::atomic<unsigned long long>& n_nCounter)
+	{
+		n_nCounter.store(n_nCounter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+
+	struct FThreadCache
+	{
+		std::vector<char*> Buffers[kClassNum];
+
+		std::atomic<unsigned long long> nHits;
+		std::atomic<unsigned long long> nMisses;
+		std::atomic<unsigned long long> nOversize;
+		std::atomic<unsigned long long> nRecycled;
+		std::atomic<unsigned long long> nReleased;
+
+		FThreadCache() : nHits(0), nMisses(0), nOversize(0), nRecycled(0), nReleased(0) {}
+
+		void Collect(FBufferPoolStats& n_Stats) const
+		{
+			n_Stats.nHits += nHits.load(std::memory_order_relaxed);
+			n_Stats.nMisses += nMisses.load(std::memory_order_relaxed);
+			n_Stats.nOversize += nOversize.load(std::memory_order_relaxed);
+			n_Stats.nRecycled += nRecycled.load(std::memory_order_relaxed);
+			n_Stats.nReleased += nReleased.load(std::memory_order_relaxed);
+		}
+	};
+
+	struct FGlobalPool
+	{
+		std::mutex			Mutex[kClassNum];
+		std::vector<char*>	Buffers[kClassNum];
+
+		// 存活的线程缓存，及已退出线程的统计
+		std::mutex				CacheMutex;
+		std::list<FThreadCache*> Caches;
+		FBufferPoolStats		Retired;
+
+		// 从全局缓存获取一批
+		void Fetch(const int n_nClass, std::vector<char*>& n_Buffers, size_t n_nCount)
+		{
+			std::unique_lock<std::mutex> lock(Mutex[n_nClass]);
+
+			auto& Free = Buffers[n_nClass];
+			n_nCount = std::min(n_nCount, Free.size());
+			n_Buffers.insert(n_Buffers.end(), Free.end() - n_nCount, Free.end());
+			Free.resize(Free.size() - n_nCount);
+		}
+
+		// 归还一批到全局缓存，返回超出上限释放回系统的数量
+		size_t Return(const int n_nClass, char** n_pBuffers, size_t n_nCount)
+		{
+			size_t nReleased = 0;
+			std::unique_lock<std::mutex> lock(Mutex[n_nClass]);
+
+			auto& Free = Buffers[n_nClass];
+			auto nMax = GlobalCacheMax(n_nClass);
+			for (size_t i = 0; i < n_nCount; i++)
+			{
+				if (Free.size() < nMax) Free.push_back(n_pBuffers[i]);
+				else
+				{
+					free(n_pBuffers[i]);
+					nReleased++;
+				}
+			}
+
+			return nReleased;
+		}
+	};
+
+	// 不析构，保证退出较晚的线程仍可归还内存
+	static FGlobalPool& GlobalPool()
+	{
+		static FGlobalPool* Pool = new FGlobalPool;
+		return *Pool;
+	}
+
+	static thread_local FThreadCache* t_ThreadCache = nullptr;
+	// 线程缓存已析构，之后的释放直接归还全局缓存
+	static thread_local bool t_bCacheExited = false;
+
+	struct FThreadCacheHolder
+	{
+		~FThreadCacheHolder()
+		{
+			auto pCache = t_ThreadCache;
+			t_ThreadCache = nullptr;
+			t_bCacheExited = true;
+			if (!pCache) return;
+
+			auto& Pool = GlobalPool();
+			for (int i = 0; i < kClassNum; i++)
+			{
+				auto& Buffers = pCache->Buffers[i];
+				if (Buffers.empty()) continue;
+
+				auto nReleased = Pool.Return(i, Buffers.data(), Buffers.size());
+				pCache->nReleased += nReleased;
+			}
+
+			std::unique_lock<std::mutex> lock(Pool.CacheMutex);
+			Pool.Caches.remove(pCache);
+			pCache->Collect(Pool.Retired);
+			delete pCache;
+		}
+	};
+
+	static FThreadCache* ThreadCache()
+	{
+		if (t_ThreadCache) return t_ThreadCache;
+		if (t_bCacheExited) return nullptr;
+
+		static thread_local FThreadCacheHolder Holder;
+		(void)Holder;
+
+		t_ThreadCache = new FThreadCache;
+
+		auto& Pool = GlobalPool();
+		std::unique_lock<std::mutex> lock(Pool.CacheMutex);
+		Pool.Caches.push_back(t_ThreadCache);
+
+		return t_ThreadCache;
+	}
+
+	char* CBufferPool::Alloc(const size_t n_nSize, size_t& n_nCapacity)
+	{
+		auto nClass = SizeClass(n_nSize);
+		auto pCache = ThreadCache();
+
+		if (nClass < 0)
+		{
+			if (pCache) Increase(pCache->nOversize);
+			n_nCapacity = n_nSize;
+			return (char*)malloc(n_nSize);
+		}
+
+		n_nCapacity = ClassSize(nClass);
+
+		char* szBuffer = nullptr;
+		if (pCache)
+		{
+			auto& Buffers = pCache->Buffers[nClass];
+			if (Buffers.empty())
+				GlobalPool().Fetch(nClass, Buffers, ThreadCacheMax(nClass) / 2);
+
+			if (!Buffers.empty())
+			{
+				szBuffer = Buffers.back();
+				Buffers.pop_back();
+			}
+		}
+		else
+		{
+			std::vector<char*> Buffers;
+			GlobalPool().Fetch(nClass, Buffers, 1);
+			if (!Buffers.empty()) szBuffer = Buffers.back();
+		}
+
+		if (szBuffer)
+		{
+			if (pCache) Increase(pCache->nHits);
+			return szBuffer;
+		}
+
+		if (pCache) Increase(pCache->nMisses);
+		return (char*)malloc(n_nCapacity);
+	}
+
+	void CBufferPool::Free(char* n_szBuffer, const size_t n_nCapacity)
+	{
+		if (!n_szBuffer) return;
+
+		// 非内存池规格的内存直接释放
+		auto nClass = SizeClass(n_nCapacity);
+		if (nClass < 0 || ClassSize(nClass) != n_nCapacity)
+		{
+			free(n_szBuffer);
+			return;
+		}
+
+		auto pCache = ThreadCache();
+		if (!pCache)
+		{
+			GlobalPool().Return(nClass, &n_szBuffer, 1);
+			return;
+		}
+
+		Increase(pCache->nRecycled);
+
+		auto& Buffers = pCache->Buffers[nClass];
+		Buffers.push_back(n_szBuffer);
+
+		// 线程缓存已满，归还一半到全局缓存
+		auto nMax = ThreadCacheMax(nClass);
+		if (Buffers.size() > nMax)
+		{
+			auto nCount = Buffers.size() / 2;
+			auto nReleased = GlobalPool().Return(nClass, Buffers.data() + Buffers.size() - nCount, nCount);
+			Buffers.resize(Buffers.size() - nCount);
+
+			for (size_t i = 0; i < nReleased; i++) Increase(pCache->nReleased);
+		}
+	}
+
+	FBufferPoolStats CBufferPool::GetStats()
+	{
+		auto& Pool = GlobalPool();
+		std::unique_lock<std::mutex> lock(Pool.CacheMutex);
+
+		FBufferPoolStats Stats = Pool.Retired;
+		for (auto pCache : Pool.Caches) pCache->Collect(Stats);
+
+		return Stats;
+	}
+
+	void CBufferPool::Trim()
+	{
+		auto& Pool = GlobalPool();
+
+		for (int i = 0; i < kClassNum; i++)
+		{
+			std::vector<char*> Buffers;
+			{
+				std::unique_lock<std::mutex> lock(Pool.Mutex[i]);
+				Buffers.swap(Pool.Buffers[i]);
+			}
+
+			for (auto szBuffer : Buffers) free(szBuffer);
+		}
+	}
+}
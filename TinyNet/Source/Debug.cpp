@@ -1,38 +1,636 @@
 #include <cstdarg>
+#include <cstdlib>
+#include <ctime>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
 #include "Debug.h"
 
-#if !defined(_WIN32) && !defined(_WIN64)
-#include <stdio.h>		// linux: perror
-#include <string.h>		// linux: memset
-#endif
-
 namespace tinynet
 {
 	const size_t kBufferSize = 1024;
-	char kDebugBuffer[kBufferSize + 1] = { 0 };
+
+	// 每个线程的缓冲区长度，需为 2 的幂
+	constexpr size_t kRingSize = 1024 * 64;
+	// 日志线程空闲时的等待时间(毫秒)
+	constexpr int kIdleMilliSeconds = 10;
+	// 默认同一调用处每秒最多输出的条数
+	constexpr unsigned int kDefaultRateLimit = 100;
+	// 标准错误合并写入的长度
+	constexpr size_t kSinkBufferSize = 1024 * 16;
+	// 填充记录的级别，环形缓冲区末尾不足一条记录时跳过
+	constexpr unsigned char kPadLevel = 0xFF;
+
+	static size_t AlignRecord(const size_t n_nSize)
+	{
+		return (n_nSize + 7) & ~(size_t)7;
+	}
+
+	// 单个线程的环形缓冲区，所属线程写入，日志线程读取
+	struct FLogRing
+	{
+		char*					Data = nullptr;
+		std::atomic<size_t>		nHead{ 0 };
+		std::atomic<size_t>		nTail{ 0 };
+		// 所属线程已退出，读完后释放
+		std::atomic<bool>		bClosed{ false };
+		// Reserve 预留的记录结束位置，只由所属线程使用
+		size_t					nReserved = 0;
+		unsigned short			nId = 0;
+
+		FLogRing() { Data = new char[kRingSize]; }
+		~FLogRing() { delete[] Data; }
+	};
+
+	struct FLogCore
+	{
+		std::atomic<int>			nLevel{ (int)ELogLevel::Debug };
+		std::atomic<unsigned int>	nRateLimit{ kDefaultRateLimit };
+		std::atomic<unsigned long long> nDropped{ 0 };
+
+		// 存活及待读完的线程缓冲区
+		std::mutex					RingMutex;
+		std::vector<FLogRing*>		Rings;
+		unsigned short				nNextId = 0;
+		bool						bThread = false;
+
+		// 读取、格式化及输出在同一时刻只由一个线程执行
+		std::mutex					DrainMutex;
+		std::vector<std::shared_ptr<ILogSink>> Sinks;
+		std::string					sLine;
+		unsigned long long			nReported = 0;
+
+		FLogCore() { Sinks.push_back(std::make_shared<CStderrSink>()); }
+	};
+
+	// 不析构，保证退出较晚的线程仍可写入
+	static FLogCore& LogCore()
+	{
+		static FLogCore* Core = new FLogCore;
+		return *Core;
+	}
+
+#pragma region 输出目标
+	void CStderrSink::Write(const ELogLevel /*n_eLevel*/, const char* n_szLine, const size_t n_nSize)
+	{
+		m_sBuffer.append(n_szLine, n_nSize);
+		if (m_sBuffer.size() >= kSinkBufferSize) Flush();
+	}
+
+	void CStderrSink::Flush()
+	{
+		if (m_sBuffer.empty()) return;
+
+		fwrite(m_sBuffer.data(), 1, m_sBuffer.size(), stderr);
+		fflush(stderr);
+		m_sBuffer.clear();
+	}
+
+	CFileSink::CFileSink(const std::string& n_sPath)
+	{
+		m_pFile = fopen(n_sPath.c_str(), "ab");
+	}
+
+	CFileSink::~CFileSink()
+	{
+		if (m_pFile) fclose(m_pFile);
+	}
+
+	void CFileSink::Write(const ELogLevel /*n_eLevel*/, const char* n_szLine, const size_t n_nSize)
+	{
+		if (m_pFile) fwrite(n_szLine, 1, n_nSize, m_pFile);
+	}
+
+	void CFileSink::Flush()
+	{
+		if (m_pFile) fflush(m_pFile);
+	}
+#pragma endregion
+
+#pragma region 格式化
+	struct FLogArg
+	{
+		logdetail::EArg		eType = logdetail::EArg::Int;
+		long long			nInt = 0;
+		unsigned long long	nUInt = 0;
+		double				fValue = 0;
+		const void*			pValue = nullptr;
+		std::string			sValue;
+	};
+
+	// 按写入顺序读取参数
+	static bool NextArg(const char*& n_pData, const char* n_pEnd, FLogArg& n_Arg)
+	{
+		if (n_pData >= n_pEnd) return false;
+
+		n_Arg.eType = (logdetail::EArg)*n_pData++;
+		switch (n_Arg.eType)
+		{
+		case logdetail::EArg::Int:
+			memcpy(&n_Arg.nInt, n_pData, sizeof(long long));
+			n_pData += sizeof(long long);
+			break;
+		case logdetail::EArg::UInt:
+			memcpy(&n_Arg.nUInt, n_pData, sizeof(unsigned long long));
+			n_pData += sizeof(unsigned long long);
+			break;
+		case logdetail::EArg::Double:
+			memcpy(&n_Arg.fValue, n_pData, sizeof(double));
+			n_pData += sizeof(double);
+			break;
+		case logdetail::EArg::Pointer:
+			memcpy(&n_Arg.pValue, n_pData, sizeof(const void*));
+			n_pData += sizeof(const void*);
+			break;
+		case logdetail::EArg::String:
+		{
+			unsigned int nLength = 0;
+			memcpy(&nLength, n_pData, sizeof(unsigned int));
+			n_pData += sizeof(unsigned int);
+			n_Arg.sValue.assign(n_pData, nLength);
+			n_pData += nLength;
+		}
+		break;
+		default:
+			n_pData = n_pEnd;
+			return false;
+		}
+
+		return true;
+	}
+
+	static long long ArgToInt(const FLogArg& n_Arg)
+	{
+		switch (n_Arg.eType)
+		{
+		case logdetail::EArg::UInt: return (long long)n_Arg.nUInt;
+		case logdetail::EArg::Double: return (long long)n_Arg.fValue;
+		case logdetail::EArg::Pointer: return (long long)(size_t)n_Arg.pValue;
+		default: return n_Arg.nInt;
+		}
+	}
+
+	template <typename T>
+	static void AppendFormat(std::string& n_sOut, const std::string& n_sSpec, const T n_Value)
+	{
+		char szBuff[256];
+		auto nSize = snprintf(szBuff, sizeof(szBuff), n_sSpec.c_str(), n_Value);
+		if (nSize < 0) return;
+		if ((size_t)nSize < sizeof(szBuff))
+		{
+			n_sOut.append(szBuff, nSize);
+			return;
+		}
+
+		auto nOffset = n_sOut.size();
+		n_sOut.resize(nOffset + nSize + 1);
+		snprintf(&n_sOut[nOffset], nSize + 1, n_sSpec.c_str(), n_Value);
+		n_sOut.resize(nOffset + nSize);
+	}
+
+	// 按格式输出已编码的参数，格式中的长度修饰由参数的实际类型决定
+	static void FormatMessage(const FLogRecord& n_Record, const char* n_pArgs, const char* n_pEnd, std::string& n_sOut)
+	{
+		auto szFormat = n_Record.szFormat ? n_Record.szFormat : "";
+		FLogArg Arg;
+		std::string sSpec;
+
+		while (*szFormat)
+		{
+			if (*szFormat != '%')
+			{
+				auto szBegin = szFormat;
+				while (*szFormat && *szFormat != '%') szFormat++;
+				n_sOut.append(szBegin, szFormat - szBegin);
+				continue;
+			}
+
+			auto szSpec = szFormat++;
+			if (*szFormat == '%')
+			{
+				n_sOut.push_back('%');
+				szFormat++;
+				continue;
+			}
+
+			sSpec.assign("%");
+			while (*szFormat && strchr("-+ #0", *szFormat)) sSpec.push_back(*szFormat++);
+
+			// 宽度及精度
+			for (int i = 0; i < 2; i++)
+			{
+				if (i == 1)
+				{
+					if (*szFormat != '.') break;
+					sSpec.push_back(*szFormat++);
+				}
+
+				if (*szFormat == '*')
+				{
+					szFormat++;
+					if (NextArg(n_pArgs, n_pEnd, Arg)) sSpec += std::to_string(ArgToInt(Arg));
+				}
+				else while (*szFormat >= '0' && *szFormat <= '9') sSpec.push_back(*szFormat++);
+			}
+
+			while (*szFormat && strchr("hlLqjzt", *szFormat)) szFormat++;
+
+			auto cConv = *szFormat;
+			if (!cConv)
+			{
+				n_sOut.append(szSpec);
+				break;
+			}
+			szFormat++;
+
+			if (cConv == 'm')
+			{
+				n_sOut.append(strerror(n_Record.nErrno));
+				continue;
+			}
+			if (cConv == 'n') continue;
+
+			// 参数不足时原样输出
+			if (!NextArg(n_pArgs, n_pEnd, Arg))
+			{
+				n_sOut.append(szSpec, szFormat - szSpec);
+				continue;
+			}
+
+			// 格式与参数类型不符时按参数类型输出
+			bool bString = cConv == 's';
+			if (Arg.eType == logdetail::EArg::String) cConv = 's';
+			else if (bString)
+			{
+				switch (Arg.eType)
+				{
+				case logdetail::EArg::UInt: cConv = 'u'; break;
+				case logdetail::EArg::Double: cConv = 'g'; break;
+				case logdetail::EArg::Pointer: cConv = 'p'; break;
+				default: cConv = 'd'; break;
+				}
+			}
+
+			switch (cConv)
+			{
+			case 'd': case 'i':
+				AppendFormat(n_sOut, sSpec + "lld", ArgToInt(Arg));
+				break;
+			case 'u': case 'o': case 'x': case 'X':
+				AppendFormat(n_sOut, sSpec + "ll" + cConv, (unsigned long long)ArgToInt(Arg));
+				break;
+			case 'c':
+				AppendFormat(n_sOut, sSpec + 'c', (int)ArgToInt(Arg));
+				break;
+			case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+				AppendFormat(n_sOut, sSpec + cConv,
+					Arg.eType == logdetail::EArg::Double ? Arg.fValue : (double)ArgToInt(Arg));
+				break;
+			case 'p':
+				AppendFormat(n_sOut, sSpec + 'p', Arg.eType == logdetail::EArg::Pointer ?
+					Arg.pValue : (const void*)(size_t)ArgToInt(Arg));
+				break;
+			case 's':
+				AppendFormat(n_sOut, sSpec + 's', Arg.sValue.c_str());
+				break;
+			default:
+				n_sOut.append(szSpec, szFormat - szSpec);
+				break;
+			}
+		}
+	}
+
+	static const char* LevelName(const unsigned char n_nLevel)
+	{
+		static const char* Names[] = { "TRACE", "DEBUG", "INFO ", "WARN ", "ERROR" };
+		return n_nLevel < sizeof(Names) / sizeof(Names[0]) ? Names[n_nLevel] : "?????";
+	}
+
+	// 格式化一条记录：时间 级别 [线程] 函数:行: 消息
+	static void FormatRecord(const char* n_szRecord, std::string& n_sLine)
+	{
+		FLogRecord Record;
+		memcpy(&Record, n_szRecord, sizeof(FLogRecord));
+
+		auto nSeconds = (time_t)(Record.nTime / 1000000000ll);
+		struct tm Time;
+#if defined(_WIN32) || defined(_WIN64)
+		localtime_s(&Time, &nSeconds);
+#else
+		localtime_r(&nSeconds, &Time);
+#endif
+
+		char szPrefix[128];
+		auto nSize = snprintf(szPrefix, sizeof(szPrefix), "%04d-%02d-%02d %02d:%02d:%02d.%06d %s [%u] ",
+			Time.tm_year + 1900, Time.tm_mon + 1, Time.tm_mday, Time.tm_hour, Time.tm_min, Time.tm_sec,
+			(int)(Record.nTime % 1000000000ll / 1000), LevelName(Record.nLevel), (unsigned int)Record.nThread);
+		n_sLine.assign(szPrefix, nSize > 0 ? std::min((size_t)nSize, sizeof(szPrefix) - 1) : 0);
+
+		if (Record.szFunc)
+		{
+			n_sLine.append(Record.szFunc);
+			n_sLine.append(":");
+			n_sLine.append(std::to_string(Record.nLine));
+			n_sLine.append(": ");
+		}
+
+		FormatMessage(Record, n_szRecord + sizeof(FLogRecord), n_szRecord + Record.nSize, n_sLine);
+
+		// 兼容以换行结尾的消息
+		while (!n_sLine.empty() && (n_sLine.back() == '\n' || n_sLine.back() == '\r')) n_sLine.pop_back();
+		if (Record.nSuppressed > 0)
+			n_sLine.append(" (" + std::to_string(Record.nSuppressed) + " suppressed)");
+		n_sLine.push_back('\n');
+	}
+
+	// 输出一条记录，需持有 DrainMutex
+	static void OutputRecord(FLogCore& n_Core, const char* n_szRecord)
+	{
+		FormatRecord(n_szRecord, n_Core.sLine);
+
+		auto eLevel = (ELogLevel)((const FLogRecord*)n_szRecord)->nLevel;
+		for (auto& pSink : n_Core.Sinks) pSink->Write(eLevel, n_Core.sLine.data(), n_Core.sLine.size());
+	}
+#pragma endregion
+
+#pragma region 日志线程
+	// 读取所有线程的缓冲区并输出，返回是否有输出
+	static bool Drain(FLogCore& n_Core)
+	{
+		std::unique_lock<std::mutex> lock(n_Core.DrainMutex);
+
+		std::vector<FLogRing*> vecRings;
+		{
+			std::unique_lock<std::mutex> lockRing(n_Core.RingMutex);
+			vecRings = n_Core.Rings;
+		}
+
+		bool bOutput = false;
+		for (auto pRing : vecRings)
+		{
+			// 先读取退出标记，读完之后的记录即可释放
+			auto bClosed = pRing->bClosed.load(std::memory_order_acquire);
+			auto nHead = pRing->nHead.load(std::memory_order_acquire);
+			auto nTail = pRing->nTail.load(std::memory_order_relaxed);
+
+			while (nTail != nHead)
+			{
+				auto szRecord = pRing->Data + (nTail & (kRingSize - 1));
+				auto pRecord = (const FLogRecord*)szRecord;
+				if (pRecord->nLevel != kPadLevel)
+				{
+					OutputRecord(n_Core, szRecord);
+					bOutput = true;
+				}
+				nTail += AlignRecord(pRecord->nSize);
+			}
+			pRing->nTail.store(nTail, std::memory_order_release);
+
+			if (!bClosed) continue;
+
+			std::unique_lock<std::mutex> lockRing(n_Core.RingMutex);
+			n_Core.Rings.erase(std::find(n_Core.Rings.begin(), n_Core.Rings.end(), pRing));
+			delete pRing;
+		}
+
+		// 报告缓冲区已满丢弃的条数
+		auto nDropped = n_Core.nDropped.load(std::memory_order_relaxed);
+		if (nDropped != n_Core.nReported)
+		{
+			n_Core.sLine = "log buffer full, " + std::to_string(nDropped - n_Core.nReported) + " messages dropped\n";
+			n_Core.nReported = nDropped;
+			for (auto& pSink : n_Core.Sinks) pSink->Write(ELogLevel::Warn, n_Core.sLine.data(), n_Core.sLine.size());
+			bOutput = true;
+		}
+
+		if (bOutput)
+		{
+			for (auto& pSink : n_Core.Sinks) pSink->Flush();
+		}
+
+		return bOutput;
+	}
+
+	static void LogThread()
+	{
+		auto& Core = LogCore();
+		while (true)
+		{
+			if (!Drain(Core)) std::this_thread::sleep_for(std::chrono::milliseconds(kIdleMilliSeconds));
+		}
+	}
+
+	static thread_local FLogRing* t_LogRing = nullptr;
+	// 线程缓冲区已释放，之后的日志在调用线程直接输出
+	static thread_local bool t_bRingExited = false;
+
+	struct FLogRingHolder
+	{
+		~FLogRingHolder()
+		{
+			auto pRing = t_LogRing;
+			t_LogRing = nullptr;
+			t_bRingExited = true;
+			if (pRing) pRing->bClosed.store(true, std::memory_order_release);
+		}
+	};
+
+	static FLogRing* ThreadRing()
+	{
+		if (t_LogRing) return t_LogRing;
+		if (t_bRingExited) return nullptr;
+
+		static thread_local FLogRingHolder Holder;
+		(void)Holder;
+
+		auto pRing = new FLogRing;
+		auto& Core = LogCore();
+		{
+			std::unique_lock<std::mutex> lock(Core.RingMutex);
+			pRing->nId = ++Core.nNextId;
+			Core.Rings.push_back(pRing);
+
+			// 首次写入时启动日志线程，随进程结束
+			if (!Core.bThread)
+			{
+				std::thread(LogThread).detach();
+				Core.bThread = true;
+			}
+		}
+
+		t_LogRing = pRing;
+		return pRing;
+	}
+
+	// 进程退出时输出剩余的日志
+	struct FLogExit
+	{
+		~FLogExit() { CLogger::Flush(); }
+	};
+	static FLogExit s_LogExit;
+#pragma endregion
+
+#pragma region 日志接口
+	bool CLogger::Admit(FLogSite& n_Site, unsigned int& n_nSuppressed)
+	{
+		auto nLimit = LogCore().nRateLimit.load(std::memory_order_relaxed);
+		if (nLimit > 0)
+		{
+			auto nNow = (long long)std::chrono::duration_cast<std::chrono::seconds>(
+				std::chrono::steady_clock::now().time_since_epoch()).count();
+
+			auto nWindow = n_Site.nWindow.load(std::memory_order_relaxed);
+			if (nWindow != nNow && n_Site.nWindow.compare_exchange_strong(nWindow, nNow, std::memory_order_relaxed))
+				n_Site.nCount.store(0, std::memory_order_relaxed);
+
+			if (n_Site.nCount.fetch_add(1, std::memory_order_relaxed) >= nLimit)
+			{
+				n_Site.nSuppressed.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+		}
+
+		n_nSuppressed = n_Site.nSuppressed.load(std::memory_order_relaxed) > 0 ?
+			n_Site.nSuppressed.exchange(0, std::memory_order_relaxed) : 0;
+		return true;
+	}
+
+	long long CLogger::Now()
+	{
+		return (long long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count();
+	}
+
+	char* CLogger::Reserve(const size_t n_nSize)
+	{
+		auto nSize = AlignRecord(n_nSize);
+		auto pRing = ThreadRing();
+		if (!pRing) return (char*)malloc(nSize);
+
+		auto& Core = LogCore();
+		if (nSize > kRingSize / 4)
+		{
+			Core.nDropped.fetch_add(1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		auto nHead = pRing->nHead.load(std::memory_order_relaxed);
+		auto nTail = pRing->nTail.load(std::memory_order_acquire);
+		auto nPos = nHead & (kRingSize - 1);
+
+		// 末尾不足一条记录时填充，从头开始
+		auto nPad = nPos + nSize > kRingSize ? kRingSize - nPos : 0;
+		if (kRingSize - (nHead - nTail) < nPad + nSize)
+		{
+			Core.nDropped.fetch_add(1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		if (nPad > 0)
+		{
+			auto pPad = (FLogRecord*)(pRing->Data + nPos);
+			pPad->nSize = (unsigned int)nPad;
+			pPad->nLevel = kPadLevel;
+			nHead += nPad;
+			nPos = 0;
+		}
+
+		pRing->nReserved = nHead + nSize;
+		return pRing->Data + nPos;
+	}
+
+	void CLogger::Commit(char* n_szRecord)
+	{
+		auto pRing = t_LogRing;
+		if (pRing)
+		{
+			((FLogRecord*)n_szRecord)->nThread = pRing->nId;
+			pRing->nHead.store(pRing->nReserved, std::memory_order_release);
+			return;
+		}
+
+		// 线程退出阶段，直接输出
+		auto& Core = LogCore();
+		{
+			std::unique_lock<std::mutex> lock(Core.DrainMutex);
+			OutputRecord(Core, n_szRecord);
+			for (auto& pSink : Core.Sinks) pSink->Flush();
+		}
+		free(n_szRecord);
+	}
+
+	void CLogger::SetLevel(const ELogLevel n_eLevel)
+	{
+		LogCore().nLevel.store((int)n_eLevel, std::memory_order_relaxed);
+	}
+
+	const ELogLevel CLogger::GetLevel()
+	{
+		return (ELogLevel)LogCore().nLevel.load(std::memory_order_relaxed);
+	}
+
+	const bool CLogger::IsEnabled(const ELogLevel n_eLevel)
+	{
+		return (int)n_eLevel >= LogCore().nLevel.load(std::memory_order_relaxed) && n_eLevel < ELogLevel::Off;
+	}
+
+	void CLogger::SetRateLimit(const unsigned int n_nPerSecond)
+	{
+		LogCore().nRateLimit.store(n_nPerSecond, std::memory_order_relaxed);
+	}
+
+	void CLogger::AddSink(std::shared_ptr<ILogSink> n_pSink)
+	{
+		if (!n_pSink) return;
+
+		auto& Core = LogCore();
+		std::unique_lock<std::mutex> lock(Core.DrainMutex);
+		Core.Sinks.push_back(n_pSink);
+	}
+
+	void CLogger::ClearSinks()
+	{
+		auto& Core = LogCore();
+		std::unique_lock<std::mutex> lock(Core.DrainMutex);
+		Core.Sinks.clear();
+	}
+
+	void CLogger::Flush()
+	{
+		auto& Core = LogCore();
+		while (Drain(Core));
+
+		std::unique_lock<std::mutex> lock(Core.DrainMutex);
+		for (auto& pSink : Core.Sinks) pSink->Flush();
+	}
+
+	unsigned long long CLogger::GetDropped()
+	{
+		return LogCore().nDropped.load(std::memory_order_relaxed);
+	}
+#pragma endregion
 
 	void LogDebug(const char* func, int line, const char* format, ...)
 	{
-		memset(kDebugBuffer, 0, kBufferSize);
+		if (!CLogger::IsEnabled(ELogLevel::Debug)) return;
+
+		char szBuffer[kBufferSize + 1] = { 0 };
 
 		va_list args;
 
 		va_start(args, format);
-		std::vsnprintf(kDebugBuffer, kBufferSize, format, args);
+		std::vsnprintf(szBuffer, kBufferSize, format, args);
 		va_end(args);
 
-		STD_Out << kDebugBuffer;
+		CLogger::Write(nullptr, ELogLevel::Debug, func, line, "%s", (const char*)szBuffer);
 	}
 
 #if !defined(_WIN32) && !defined(_WIN64)
 	void ErrDebug(const char* func, int line, const char* message)
 	{
-		STD_Out << func << " [" << line << "]: ";
-		perror(message);
-		STD_Out << STD_Endl;
+		if (!CLogger::IsEnabled(ELogLevel::Error)) return;
+		CLogger::Write(nullptr, ELogLevel::Error, func, line, "%s: %m", message);
 	}
 #endif
 }
-
-
-
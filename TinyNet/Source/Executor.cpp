@@ -0,0 +1,204 @@
+#include "Executor.h"
+#include "HashMap.h"
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <deque>
+#include <utility>
+
+namespace tinynet
+{
+	// 键的未执行任务数
+	struct FKeyState
+	{
+		unsigned int	nPending = 0;
+		// 达到上限，降到一半时通知恢复
+		bool			bFull = false;
+	};
+
+	// 一个工作线程及其任务队列，线程退出前一直持有
+	struct CSerialExecutor::FLane
+	{
+		std::mutex		Mutex;
+		std::condition_variable Cond;
+		std::deque<std::pair<Key, FTask>> Tasks;
+		CHashMap<FKeyState> Keys;
+
+		// 执行完队列后退出
+		bool			bStop = false;
+		// 已退出，之后投递的任务由调用者执行
+		bool			bExited = false;
+
+		unsigned int	nMaxPending = 0;
+		std::function<void(Key)> fnResume;
+		std::thread		Thread;
+
+		// 任务执行完，返回是否需通知恢复，需持有 Mutex
+		bool Complete(const Key n_nKey)
+		{
+			auto pState = Keys.Find(n_nKey);
+			if (!pState) return false;
+
+			bool bResume = false;
+			if (--pState->nPending <= nMaxPending / 2 && pState->bFull)
+			{
+				pState->bFull = false;
+				bResume = !bStop && fnResume != nullptr;
+			}
+
+			if (pState->nPending == 0) Keys.Erase(n_nKey);
+			return bResume;
+		}
+
+		// 取出并执行一个任务，队列为空返回 false，需持有 Mutex
+		bool RunOne(std::unique_lock<std::mutex>& n_Lock)
+		{
+			if (Tasks.empty()) return false;
+
+			auto Task = std::move(Tasks.front());
+			Tasks.pop_front();
+
+			n_Lock.unlock();
+			Task.second();
+			// 在锁外释放任务持有的数据
+			Task.second = nullptr;
+			n_Lock.lock();
+
+			if (Complete(Task.first))
+			{
+				n_Lock.unlock();
+				fnResume(Task.first);
+				n_Lock.lock();
+			}
+
+			return true;
+		}
+	};
+
+	// 当前线程所属的 Lane，用于识别在任务中调用 Stop
+	static thread_local const void* t_pLane = nullptr;
+
+	// 在任务中调用 Stop 后线程分离，执行器可能已释放
+	void CSerialExecutor::Run(std::shared_ptr<FLane> n_pLane)
+	{
+		auto& Lane = *n_pLane;
+		t_pLane = n_pLane.get();
+
+		std::unique_lock<std::mutex> lock(Lane.Mutex);
+		while (!Lane.bExited)
+		{
+			if (Lane.RunOne(lock)) continue;
+			if (Lane.bStop)
+			{
+				Lane.bExited = true;
+				break;
+			}
+
+			Lane.Cond.wait(lock);
+		}
+
+		t_pLane = nullptr;
+	}
+
+	CSerialExecutor::~CSerialExecutor()
+	{
+		Stop();
+	}
+
+	bool CSerialExecutor::Start(const unsigned int n_nWorkers, const unsigned int n_nMaxPending,
+		std::function<void(Key)> n_fnResume)
+	{
+		if (m_bRun || n_nWorkers == 0) return false;
+
+		m_vecLanes.clear();
+		m_nMaxPending = n_nMaxPending;
+
+		for (unsigned int i = 0; i < n_nWorkers; i++)
+		{
+			auto pLane = std::make_shared<FLane>();
+			pLane->nMaxPending = n_nMaxPending;
+			pLane->fnResume = n_fnResume;
+			m_vecLanes.push_back(pLane);
+		}
+
+		// 线程在所有 Lane 创建后启动，投递时 m_vecLanes 不再改变
+		for (auto& pLane : m_vecLanes) pLane->Thread = std::thread(&CSerialExecutor::Run, pLane);
+
+		m_bRun = true;
+		return true;
+	}
+
+	void CSerialExecutor::Stop()
+	{
+		if (!m_bRun.exchange(false)) return;
+
+		for (auto& pLane : m_vecLanes)
+		{
+			std::unique_lock<std::mutex> lock(pLane->Mutex);
+			pLane->bStop = true;
+			pLane->Cond.notify_all();
+		}
+
+		std::shared_ptr<FLane> pSelf;
+		for (auto& pLane : m_vecLanes)
+		{
+			if (!pLane->Thread.joinable()) continue;
+
+			// 在任务中调用 Stop
+			if (pLane.get() == t_pLane)
+			{
+				pLane->Thread.detach();
+				pSelf = pLane;
+			}
+			else pLane->Thread.join();
+		}
+
+		if (!pSelf) return;
+
+		// 当前线程的剩余任务在此执行，返回后调用者可释放任务引用的对象
+		std::unique_lock<std::mutex> lock(pSelf->Mutex);
+		while (pSelf->RunOne(lock));
+		pSelf->bExited = true;
+	}
+
+	CSerialExecutor::FLane* CSerialExecutor::Lane(const Key n_nKey) const
+	{
+		// 连接Id 及指针的低位分布不均，混合后取高位
+		auto nHash = (n_nKey * 0x9E3779B97F4A7C15ull) >> 32;
+		return m_vecLanes[(size_t)(nHash % m_vecLanes.size())].get();
+	}
+
+	int CSerialExecutor::Post(const Key n_nKey, FTask&& n_fnTask, const unsigned int n_nLimit)
+	{
+		if (m_vecLanes.empty() || n_nKey == 0) return 0;
+
+		auto pLane = Lane(n_nKey);
+		int nPending = 0;
+		{
+			std::unique_lock<std::mutex> lock(pLane->Mutex);
+			if (pLane->bExited) return 0;
+
+			auto pState = pLane->Keys.Insert(n_nKey, FKeyState());
+			if (n_nLimit > 0 && pState->nPending >= n_nLimit) return -1;
+
+			nPending = (int)++pState->nPending;
+			if (m_nMaxPending > 0 && pState->nPending >= m_nMaxPending) pState->bFull = true;
+
+			pLane->Tasks.emplace_back(n_nKey, std::move(n_fnTask));
+		}
+
+		pLane->Cond.notify_one();
+		return nPending;
+	}
+
+	unsigned int CSerialExecutor::Pending(const Key n_nKey)
+	{
+		if (m_vecLanes.empty() || n_nKey == 0) return 0;
+
+		auto pLane = Lane(n_nKey);
+		std::unique_lock<std::mutex> lock(pLane->Mutex);
+
+		auto pState = pLane->Keys.Find(n_nKey);
+		return pState ? pState->nPending : 0;
+	}
+}
@@ -0,0 +1,216 @@
+#include "TimerWheel.h"
+#include <chrono>
+
+namespace tinynet
+{
+	constexpr int kWheel0Bits = 8;
+	constexpr int kWheelBits = 6;
+	constexpr unsigned long long kWheel0Mask = (1ull << kWheel0Bits) - 1;
+	constexpr unsigned long long kWheelMask = (1ull << kWheelBits) - 1;
+	// 最大可表示的 Tick 数
+	constexpr unsigned long long kMaxTicks = (1ull << (kWheel0Bits + kWheelBits * 3)) - 1;
+
+	// 第 n_nLevel 层(从 1 开始)的槽位序号
+	static unsigned int SlotIndex(const unsigned long long n_nTick, const int n_nLevel)
+	{
+		return (unsigned int)((n_nTick >> (kWheel0Bits + kWheelBits * (n_nLevel - 1))) & kWheelMask);
+	}
+
+	void CTimerWheel::FTimerLink::Unlink()
+	{
+		pPrev->pNext = pNext;
+		pNext->pPrev = pPrev;
+		pPrev = pNext = this;
+	}
+
+	void CTimerWheel::FTimerLink::PushBack(FTimerLink* n_pLink)
+	{
+		n_pLink->pPrev = pPrev;
+		n_pLink->pNext = this;
+		pPrev->pNext = n_pLink;
+		pPrev = n_pLink;
+	}
+
+	void CTimerWheel::FTimerLink::MoveTo(FTimerLink* n_pList)
+	{
+		if (Empty()) return;
+
+		n_pList->pPrev = pPrev;
+		n_pList->pNext = pNext;
+		pNext->pPrev = n_pList;
+		pPrev->pNext = n_pList;
+		pPrev = pNext = this;
+	}
+
+	CTimerWheel::CTimerWheel(const unsigned int n_nTick)
+		: m_nTick(n_nTick > 0 ? n_nTick : 1)
+	{
+		m_nNext = CurrentTick();
+	}
+
+	CTimerWheel::~CTimerWheel()
+	{
+		for (auto pTimer : m_Timers) delete pTimer;
+		m_Timers.Clear();
+	}
+
+	CTimerWheel::Id CTimerWheel::Schedule(const unsigned int n_nDelay, const unsigned int n_nPeriod, Callback n_fnCallback)
+	{
+		if (!n_fnCallback) return 0;
+
+		auto pTimer = new FTimer;
+		pTimer->nExpire = CurrentTick() + (n_nDelay + m_nTick - 1) / m_nTick;
+		pTimer->nPeriod = n_nPeriod > 0 ? (n_nPeriod + m_nTick - 1) / m_nTick : 0;
+		pTimer->fnCallback = std::move(n_fnCallback);
+		pTimer->nId = m_Timers.Insert(pTimer);
+
+		Insert(pTimer);
+
+		return pTimer->nId;
+	}
+
+	bool CTimerWheel::Cancel(const Id n_nId)
+	{
+		auto ppTimer = m_Timers.Find(n_nId);
+		if (!ppTimer) return false;
+
+		auto pTimer = *ppTimer;
+		m_Timers.Erase(n_nId);
+
+		// 回调执行完成后释放
+		if (n_nId == m_nRunning)
+		{
+			m_bRunningCancelled = true;
+			return true;
+		}
+
+		pTimer->Unlink();
+		delete pTimer;
+
+		return true;
+	}
+
+	size_t CTimerWheel::Advance()
+	{
+		size_t nCount = 0;
+		auto nNow = CurrentTick();
+
+		// 没有定时器，直接跳到当前时间
+		if (m_Timers.Empty() && m_nNext < nNow) m_nNext = nNow;
+
+		while (m_nNext <= nNow)
+		{
+			auto nTick = m_nNext;
+
+			// 第一层转完一圈，从上层依次重新分配
+			if ((nTick & kWheel0Mask) == 0)
+			{
+				for (int i = 1; i <= 3; i++)
+				{
+					auto nIndex = SlotIndex(nTick, i);
+					Cascade(&m_Wheels[i - 1][nIndex]);
+					if (nIndex != 0) break;
+				}
+			}
+
+			FTimerLink Expired;
+			m_Wheel0[nTick & kWheel0Mask].MoveTo(&Expired);
+			// 回调中添加的定时器至少在下一个 Tick 触发
+			m_nNext = nTick + 1;
+
+			while (!Expired.Empty())
+			{
+				auto pTimer = (FTimer*)Expired.pNext;
+				pTimer->Unlink();
+
+				m_nRunning = pTimer->nId;
+				m_bRunningCancelled = false;
+				pTimer->fnCallback();
+				m_nRunning = 0;
+				nCount++;
+
+				if (m_bRunningCancelled) delete pTimer;
+				else if (pTimer->nPeriod == 0)
+				{
+					m_Timers.Erase(pTimer->nId);
+					delete pTimer;
+				}
+				else
+				{
+					// 错过的周期不再补发
+					pTimer->nExpire = (nNow > nTick ? nNow : nTick) + pTimer->nPeriod;
+					Insert(pTimer);
+				}
+			}
+
+			if (m_Timers.Empty() && m_nNext < nNow) m_nNext = nNow;
+		}
+
+		return nCount;
+	}
+
+	int CTimerWheel::NextTimeout() const
+	{
+		if (m_Timers.Empty()) return -1;
+
+		auto nNow = CurrentTick();
+		if (m_nNext <= nNow) return 0;
+
+		// 第一层查找到下次重新分配为止，之后的定时器在重新分配时处理
+		auto nTick = m_nNext;
+		if ((nTick & kWheel0Mask) == 0) return (int)((nTick - nNow) * m_nTick);
+
+		while (m_Wheel0[nTick & kWheel0Mask].Empty() && ((nTick + 1) & kWheel0Mask) != 0) nTick++;
+		if (m_Wheel0[nTick & kWheel0Mask].Empty()) nTick++;
+
+		return (int)((nTick - nNow) * m_nTick);
+	}
+
+	unsigned long long CTimerWheel::Now()
+	{
+		return (unsigned long long)std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	const unsigned long long CTimerWheel::CurrentTick() const
+	{
+		return Now() / m_nTick;
+	}
+
+	void CTimerWheel::Insert(FTimer* n_pTimer)
+	{
+		// 已到期的放在下一个处理的槽位
+		auto nExpire = n_pTimer->nExpire < m_nNext ? m_nNext : n_pTimer->nExpire;
+		auto nDelta = nExpire - m_nNext;
+
+		if (nDelta > kMaxTicks)
+		{
+			nDelta = kMaxTicks;
+			nExpire = m_nNext + kMaxTicks;
+		}
+
+		FTimerLink* pSlot = nullptr;
+		if (nDelta <= kWheel0Mask) pSlot = &m_Wheel0[nExpire & kWheel0Mask];
+		else
+		{
+			int nLevel = 1;
+			while (nLevel < 3 && nDelta >= (1ull << (kWheel0Bits + kWheelBits * nLevel))) nLevel++;
+			pSlot = &m_Wheels[nLevel - 1][SlotIndex(nExpire, nLevel)];
+		}
+
+		pSlot->PushBack(n_pTimer);
+	}
+
+	void CTimerWheel::Cascade(FTimerLink* n_pSlot)
+	{
+		FTimerLink List;
+		n_pSlot->MoveTo(&List);
+
+		while (!List.Empty())
+		{
+			auto pTimer = (FTimer*)List.pNext;
+			pTimer->Unlink();
+			Insert(pTimer);
+		}
+	}
+}
@@ -1,5 +1,18 @@
 ﻿#include "TinyNet.h"
 #include "Debug.h"
+#include "BufferPool.h"
+#include "Uring.h"
+#include "TimerWheel.h"
+#include "HashMap.h"
+#include "Executor.h"
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <deque>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <random>
 
 #if defined(_WIN32) || defined(_WIN64)
 #include <WinSock2.h>
@@ -9,10 +22,19 @@
 #include <sys/socket.h> //for socket
 #include <arpa/inet.h>  //for htonl htons
 #include <sys/epoll.h>  //for epoll_ctl
+#include <sys/eventfd.h>//for eventfd
+#include <sys/uio.h>    //for iovec
+#include <limits.h>     //for IOV_MAX
 #include <unistd.h>     //for close
 #include <fcntl.h>      //for fcntl
 #include <errno.h>      //for errno
 #include <ifaddrs.h>
+#include <pthread.h>    //for pthread_setaffinity_np
+#include <linux/filter.h>
+#include <netinet/udp.h> //for UDP_SEGMENT UDP_GRO
+#include <linux/net_tstamp.h> //for SOF_TIMESTAMPING_*
+#include <linux/errqueue.h>   //for scm_timestamping sock_extended_err
+#include <poll.h>       //for POLLIN
 #include <string.h>
 #endif
 
@@ -24,9 +46,21 @@ namespace tinynet
 {
 	// TCP 数据最大可缓存长度
 	constexpr int kMaxTCPBufferSize = 1024 * 1024 * 64;
+	// 数据包完成后保留的 TCP 缓存容量，超出则释放
+	constexpr size_t kKeepCacheSize = 1024 * 64;
 	constexpr unsigned int kHelloId = (('0' << 24) | ('L' << 16) | ('E' << 8) | ('H'));
 	constexpr unsigned int kHeartId = (('R' << 24) | ('A' << 16) | ('E' << 8) | ('H'));
 	constexpr unsigned int kQuitId = (('T' << 24) | ('I' << 16) | ('U' << 8) | ('Q'));
+	// 暂停读取的原因：未执行的回调达到上限，应用调用 PauseRead
+	constexpr unsigned char kPauseBacklog = 0x1;
+	constexpr unsigned char kPauseUser = 0x2;
+
+#if defined(_WIN32) || defined(_WIN64)
+	constexpr int kSendFlags = 0;
+#else
+	// 对端关闭时不产生 SIGPIPE
+	constexpr int kSendFlags = MSG_NOSIGNAL;
+#endif
 
 	const std::string kNetTypeString[] =
 	{
@@ -264,6 +298,90 @@ namespace tinynet
 		return ret;
 	}
 
+#if !defined(_WIN32) && !defined(_WIN64)
+	// 设置端口重用，多个 Socket 可绑定同一地址，由内核分配连接及数据报
+	static int SetSocketReusePort(const size_t n_nFd, int n_nReuse = 1)
+	{
+		auto ret = setsockopt(n_nFd,
+			SOL_SOCKET, SO_REUSEPORT,
+			(ValType)&n_nReuse, sizeof(int));
+
+		if (ret == -1)
+			DebugLog("setsockopt SO_REUSEPORT error: %d\n", LastError());
+		return ret;
+	}
+
+	// 允许接收 GRO 合并的 UDP 数据报
+	static int SetSocketUdpGro(const size_t n_nFd, int n_nEnable = 1)
+	{
+		auto ret = setsockopt(n_nFd,
+			SOL_UDP, UDP_GRO,
+			(ValType)&n_nEnable, sizeof(int));
+
+		if (ret == -1)
+			DebugLog("setsockopt UDP_GRO error: %d\n", LastError());
+		return ret;
+	}
+
+	// 启用软件接收时间戳，n_bTx 为 true 时(TCP)另启用调度发送时间戳，以发送的字节序号标识
+	static int SetSocketTimestamping(const size_t n_nFd, const bool n_bTx)
+	{
+		int nFlags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+		if (n_bTx) nFlags |= SOF_TIMESTAMPING_TX_SCHED | SOF_TIMESTAMPING_OPT_ID | SOF_TIMESTAMPING_OPT_TSONLY;
+
+		auto ret = setsockopt(n_nFd,
+			SOL_SOCKET, SO_TIMESTAMPING,
+			(ValType)&nFlags, sizeof(int));
+
+		if (ret == -1)
+			DebugLog("setsockopt SO_TIMESTAMPING error: %d\n", LastError());
+		return ret;
+	}
+
+	// 按接收数据的CPU选择 SO_REUSEPORT 组内的 Socket: 序号 = CPU % n_nNum
+	static int SetSocketReusePortCpu(const size_t n_nFd, unsigned int n_nNum)
+	{
+#ifdef SO_ATTACH_REUSEPORT_CBPF
+		struct sock_filter Code[] =
+		{
+			{ BPF_LD | BPF_W | BPF_ABS, 0, 0, (unsigned int)(SKF_AD_OFF + SKF_AD_CPU) },
+			{ BPF_ALU | BPF_MOD | BPF_K, 0, 0, n_nNum },
+			{ BPF_RET | BPF_A, 0, 0, 0 },
+		};
+
+		struct sock_fprog Prog;
+		Prog.len = sizeof(Code) / sizeof(Code[0]);
+		Prog.filter = Code;
+
+		auto ret = setsockopt(n_nFd,
+			SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF,
+			(ValType)&Prog, sizeof(Prog));
+
+		if (ret == -1)
+			DebugLog("setsockopt SO_ATTACH_REUSEPORT_CBPF error: %d\n", LastError());
+		return ret;
+#else
+		return -1;
+#endif
+	}
+
+	// 绑定线程到指定CPU
+	static int SetThreadAffinity(std::thread& n_Thread, unsigned int n_nIndex)
+	{
+		auto nCpuNum = GetCpuNum();
+		if (nCpuNum == 0) return -1;
+
+		cpu_set_t CpuSet;
+		CPU_ZERO(&CpuSet);
+		CPU_SET(n_nIndex % nCpuNum, &CpuSet);
+
+		auto ret = pthread_setaffinity_np(n_Thread.native_handle(), sizeof(cpu_set_t), &CpuSet);
+		if (ret != 0)
+			DebugLog("pthread_setaffinity_np error: %d\n", ret);
+		return ret;
+	}
+#endif
+
 	static int SetSocketTimeout(const size_t n_nFd, int n_nType, const int n_nMilliSeconds)
 	{
 		if (n_nMilliSeconds < 0) return -1;
@@ -304,6 +422,87 @@ namespace tinynet
 		return SetSocketTimeout(n_nFd, SO_RCVTIMEO, n_nMilliSeconds);
 	}
 
+	// 连接，超时为正数时以非阻塞方式连接并等待完成，之后恢复为阻塞 Socket
+	// 失败返回 SOCKET_ERROR，LastError 为错误码，超时为 ETIMEDOUT(WSAETIMEDOUT)
+	static int ConnectSocket(const size_t n_nFd, const stSockaddr* n_pAddr, const int n_nMilliSeconds)
+	{
+		if (n_nMilliSeconds <= 0) return connect(n_nFd, n_pAddr, sizeof(stSockaddr));
+
+		int nError = 0;
+#if defined(_WIN32) || defined(_WIN64)
+		u_long nMode = 1;
+		ioctlsocket(n_nFd, FIONBIO, &nMode);
+
+		if (connect(n_nFd, n_pAddr, sizeof(stSockaddr)) == SOCKET_ERROR)
+		{
+			nError = WSAGetLastError();
+			if (nError == WSAEWOULDBLOCK)
+			{
+				fd_set WriteSet, ErrorSet;
+				FD_ZERO(&WriteSet);
+				FD_ZERO(&ErrorSet);
+				FD_SET(n_nFd, &WriteSet);
+				FD_SET(n_nFd, &ErrorSet);
+
+				struct timeval tv;
+				tv.tv_sec = n_nMilliSeconds / 1000;
+				tv.tv_usec = (n_nMilliSeconds % 1000) * 1000;
+
+				// 连接失败时 Socket 在异常集合中
+				auto nResult = select(0, nullptr, &WriteSet, &ErrorSet, &tv);
+				if (nResult == 0) nError = WSAETIMEDOUT;
+				else if (nResult == SOCKET_ERROR) nError = WSAGetLastError();
+				else
+				{
+					int nLen = sizeof(nError);
+					nError = 0;
+					if (getsockopt(n_nFd, SOL_SOCKET, SO_ERROR, (char*)&nError, &nLen) == SOCKET_ERROR)
+						nError = WSAGetLastError();
+				}
+			}
+		}
+
+		nMode = 0;
+		ioctlsocket(n_nFd, FIONBIO, &nMode);
+		if (nError != 0) WSASetLastError(nError);
+#else
+		int nFlags = fcntl(n_nFd, F_GETFL, 0);
+		fcntl(n_nFd, F_SETFL, nFlags | O_NONBLOCK);
+
+		if (connect(n_nFd, n_pAddr, sizeof(stSockaddr)) == SOCKET_ERROR)
+		{
+			nError = errno;
+			if (nError == EINPROGRESS)
+			{
+				struct pollfd Poll;
+				Poll.fd = (int)n_nFd;
+				Poll.events = POLLOUT;
+				Poll.revents = 0;
+
+				int nResult = 0;
+				do
+				{
+					nResult = poll(&Poll, 1, n_nMilliSeconds);
+				} while (nResult == SOCKET_ERROR && errno == EINTR);
+
+				if (nResult == 0) nError = ETIMEDOUT;
+				else if (nResult == SOCKET_ERROR) nError = errno;
+				else
+				{
+					socklen_t nLen = sizeof(nError);
+					nError = 0;
+					if (getsockopt(n_nFd, SOL_SOCKET, SO_ERROR, &nError, &nLen) == SOCKET_ERROR)
+						nError = errno;
+				}
+			}
+		}
+
+		fcntl(n_nFd, F_SETFL, nFlags);
+		errno = nError;
+#endif
+		return nError == 0 ? 0 : SOCKET_ERROR;
+	}
+
 	////////////////////////////////////////////////////////////////////////////////
 #pragma region 数据缓存
 	struct FHeader
@@ -340,29 +539,35 @@ namespace tinynet
 	};
 
 	void FNetBuffer::Alloc(const size_t n_nSize)
+	{
+		Resize(n_nSize);
+		Zero();
+	};
+
+	void FNetBuffer::Resize(const size_t n_nSize)
 	{
 		auto nSize = n_nSize + sizeof(FHeader);
 		if (nSize > nCapacity || !Buffer)
 		{
 			Free();
 
-			Buffer = (char*)malloc(nSize);
+			size_t nAllocSize = 0;
+			Buffer = CBufferPool::Alloc(nSize, nAllocSize);
 			if (Buffer)
 			{
 				nLength = nSize;
-				nCapacity = nLength;
+				nCapacity = nAllocSize;
 			}
 		}
 		else nLength = nSize;
 
 		SetDataPacketSize(n_nSize);
 		SetEventId(0);
-		Zero();
-	};
+	}
 
 	void FNetBuffer::Free()
 	{
-		if (nCapacity > 0 && Buffer) free(Buffer);
+		if (nCapacity > 0 && Buffer) CBufferPool::Free(Buffer, nCapacity);
 
 		Buffer = nullptr;
 		nLength = 0;
@@ -373,7 +578,7 @@ namespace tinynet
 	{
 		if (!Buffer) return;
 
-		auto nSize = DataCapacity();
+		auto nSize = DataSize();
 		if (nSize > 0) memset((char*)GetData(), 0, nSize);
 	}
 
@@ -422,8 +627,8 @@ namespace tinynet
 	{
 		if (!n_szData || n_nSize == 0) return;
 
-		Alloc(n_nSize);
-		memcpy((char*)GetData(), n_szData, n_nSize);
+		Resize(n_nSize);
+		if (Buffer) memcpy((char*)GetData(), n_szData, n_nSize);
 	}
 
 	void FNetBuffer::SetData(const std::string& n_sData)
@@ -455,10 +660,26 @@ namespace tinynet
 
 	FNetBuffer& FNetBuffer::operator=(const FNetBuffer& other)
 	{
-		if (!other.Buffer || !other.nLength) return *this;
+		if (this == &other || !other.Buffer || !other.nLength) return *this;
+
+		Resize(other.DataSize());
+		if (Buffer) memcpy(Buffer, other.Buffer, other.nLength);
+
+		return *this;
+	}
+
+	FNetBuffer& FNetBuffer::operator=(FNetBuffer&& other) noexcept
+	{
+		if (this == &other) return *this;
+
+		Free();
+		Buffer = other.Buffer;
+		nLength = other.nLength;
+		nCapacity = other.nCapacity;
 
-		Alloc(other.DataSize());
-		memcpy(Buffer, other.Buffer, other.nLength);
+		other.Buffer = nullptr;
+		other.nLength = 0;
+		other.nCapacity = 0;
 
 		return *this;
 	}
@@ -470,1358 +691,5208 @@ namespace tinynet
 	}
 #pragma endregion
 	////////////////////////////////////////////////////////////////////////////////
-#pragma region 事件消息
-	struct FHeart
+#pragma region 延时追踪
+	// 当前时间(纳秒)，与内核软件时间戳同为 CLOCK_REALTIME
+	static long long TraceNow()
 	{
-		// 发送者，系统维护
-		unsigned int Sender = 0;
-		// 序号，若心跳返回，则序号会递增
-		unsigned int No = 0;
-		// 失败次数，更新序号时需重置
-		unsigned int Cnt = 0;
+		return (long long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count();
+	}
+
+	// 工作线程正在处理的读取的时间(纳秒)
+	struct FRecvStamp
+	{
+		// 内核接收时间，由接收处写入，0 表示没有
+		long long	nKernel = 0;
+		// 工作线程取出数据的时间
+		long long	nDequeue = 0;
 	};
-#pragma endregion
+	static thread_local FRecvStamp t_RecvStamp;
 
-	////////////////////////////////////////////////////////////////////////////////
-#pragma region 节点
-	void FNetNode::Init(const ENetType n_eType,
-		const std::string& n_sHost, const unsigned short n_nPort)
+	// 记录内核及拆分阶段的延时，返回回调开始的时间
+	static long long TraceDispatch(CLatencyTrace* n_pTrace)
 	{
-		eNetType = n_eType;
-		memset(Addr, 0, sizeof(stSockaddrIn));
-		BuildSockAddrIn(&Addr, n_sHost, n_nPort);
+		auto nNow = TraceNow();
+		if (t_RecvStamp.nKernel > 0)
+			n_pTrace->Record(ELatencyStage::Kernel, t_RecvStamp.nDequeue - t_RecvStamp.nKernel);
+		n_pTrace->Record(ELatencyStage::Reassembly, nNow - t_RecvStamp.nDequeue);
+		return nNow;
 	}
 
-	void FNetNode::Init(const ENetType n_eType, const stSockaddrIn* n_Addr)
+#if !defined(_WIN32) && !defined(_WIN64)
+	// 接收时间戳的控制信息长度
+	constexpr size_t kStampControlSize = CMSG_SPACE(sizeof(struct scm_timestamping));
+
+	// 控制信息中的软件时间戳(纳秒)，没有返回 0
+	static long long KernelStamp(struct msghdr* n_pMsg)
 	{
-		eNetType = n_eType;
-		if (n_Addr) memcpy(Addr, n_Addr, sizeof(stSockaddrIn));
-		else memset(Addr, 0, sizeof(stSockaddrIn));
+		for (auto pCmsg = CMSG_FIRSTHDR(n_pMsg); pCmsg; pCmsg = CMSG_NXTHDR(n_pMsg, pCmsg))
+		{
+			if (pCmsg->cmsg_level != SOL_SOCKET || pCmsg->cmsg_type != SCM_TIMESTAMPING) continue;
+
+			struct scm_timestamping Stamp;
+			memcpy(&Stamp, CMSG_DATA(pCmsg), sizeof(Stamp));
+			return (long long)Stamp.ts[0].tv_sec * 1000000000ll + Stamp.ts[0].tv_nsec;
+		}
+
+		return 0;
 	}
 
-	const unsigned short FNetNode::Port()
+	// 接收并取得内核接收时间戳，写入 t_RecvStamp
+	static ssize_t RecvStamped(const size_t n_nFd, char* n_szBuff, const int n_nSize, const int n_nFlags)
 	{
-		return SockaddrToPort(Addr);
-	}
+		struct iovec IoVec;
+		IoVec.iov_base = n_szBuff;
+		IoVec.iov_len = n_nSize;
 
-	const std::string FNetNode::Ip()
+		char Control[kStampControlSize];
+		struct msghdr Msg;
+		memset(&Msg, 0, sizeof(Msg));
+		Msg.msg_iov = &IoVec;
+		Msg.msg_iovlen = 1;
+		Msg.msg_control = Control;
+		Msg.msg_controllen = sizeof(Control);
+
+		auto nResult = recvmsg(n_nFd, &Msg, n_nFlags);
+		if (nResult > 0) t_RecvStamp.nKernel = KernelStamp(&Msg);
+		return nResult;
+	}
+#endif
+#pragma endregion
+	////////////////////////////////////////////////////////////////////////////////
+#pragma region 发送队列
+	// 更新连接及所属实例的统计
+	static void AddStat(const FNetNode* n_pNetNode, const ENetStat n_eStat, const unsigned long long n_nValue = 1)
 	{
-		return SockaddrToIp(Addr);
+		n_pNetNode->Stats.Add(n_eStat, n_nValue);
+		if (n_pNetNode->Counters) n_pNetNode->Counters->Add(n_eStat, n_nValue);
 	}
 
-	int FNetNode::Send(const char* n_szData, const int n_nSize) const
+	// 发送成功时统计发送的数据包及字节数，返回 n_nResult
+	static int CountSent(const FNetNode* n_pNetNode, const int n_nResult,
+		const size_t n_nBytes, const unsigned int n_nFrames = 1)
 	{
-		int nResult = 0;
+		if (n_nResult == SOCKET_ERROR || n_nBytes == 0) return n_nResult;
 
-		if (!IsValid() || n_nSize == 0) return nResult;
+		AddStat(n_pNetNode, ENetStat::BytesSent, n_nBytes);
+		AddStat(n_pNetNode, ENetStat::FramesSent, n_nFrames);
+		return n_nResult;
+	}
 
-		FNetBuffer NetBuffer(n_szData, n_nSize);
-		return Send(NetBuffer);
+	// 发送缓存已满(阻塞 Socket 为发送超时)
+	static bool IsSendBlocked(const int n_nError)
+	{
+#if defined(_WIN32) || defined(_WIN64)
+		return n_nError == WSAEWOULDBLOCK || n_nError == WSAETIMEDOUT;
+#else
+		return n_nError == EAGAIN || n_nError == EWOULDBLOCK;
+#endif
 	}
 
-	int FNetNode::Send(const std::string& n_sData) const
+	// 阻塞 Socket 发送完整数据，处理部分发送
+	static int SendStream(const FNetNode* n_pNetNode, const char* n_szData, const int n_nSize)
 	{
-		return Send(n_sData.c_str(), (int)n_sData.size());
+		int nSent = 0;
+
+		while (nSent < n_nSize)
+		{
+			auto nResult = send(n_pNetNode->fd, n_szData + nSent, n_nSize - nSent, kSendFlags);
+			if (nResult == SOCKET_ERROR)
+			{
+				auto nError = LastError();
+#if defined(_WIN32) || defined(_WIN64)
+				if (WSAEINTR == nError) continue;
+#else
+				if (EINTR == nError) continue;
+#endif
+				if (IsSendBlocked(nError)) AddStat(n_pNetNode, ENetStat::Eagain);
+				return SOCKET_ERROR;
+			}
+
+			if (nResult < n_nSize - nSent) AddStat(n_pNetNode, ENetStat::PartialSends);
+			nSent += nResult;
+		}
+
+		return nSent;
 	}
 
-	int FNetNode::Send(const FNetBuffer& n_Buffer) const
+#if !defined(_WIN32) && !defined(_WIN64)
+	// 可写时单次发送的最大段数
+	constexpr int kFlushIoVecSize = 64;
+
+#if defined(TINYNET_IO_URING)
+	// 请求所属 Reactor 提交连接的发送队列
+	static void RequestFlush(FReactor* n_pReactor, unsigned long long n_nId);
+#endif
+
+	// 发送队列中的一段数据
+	struct FSendSegment
 	{
-		int nResult = 0;
+		// 独占的数据，连续无法立即发送的数据合并到同一段
+		std::string		sData;
+		// 共享的数据包(含数据头)，广播时所有连接引用同一份
+		std::shared_ptr<const FNetBuffer> Shared;
 
-		if (!IsValid() || !n_Buffer.Buffer || !n_Buffer.nLength)
-			return nResult;
+		const char* Data() const { return Shared ? Shared->Buffer : sData.data(); }
+		size_t Size() const { return Shared ? Shared->nLength : sData.size(); }
+	};
 
-		if (eNetType == ENetType::TCP)
+	struct FSendQueue
+	{
+		std::mutex		Mutex;
+		// 未发送的数据
+		std::deque<FSendSegment> Segments;
+		// 第一段中已发送的长度
+		size_t			nOffset = 0;
+		// 未发送的总长度
+		size_t			nPending = 0;
+
+		// 延时追踪：已交给内核的字节数，及每次发送的 (最后一个字节的序号, 时间)
+		bool			bTxStamp = false;
+		unsigned int	nTxBytes = 0;
+		std::deque<std::pair<unsigned int, long long>> TxStamps;
+
+		// 所属的 epoll 及注册的节点、事件
+		int				nEpfd = 0;
+		FNetNode*		NetNode = nullptr;
+		unsigned int	nEvents = 0;
+		// 是否已监听 EPOLLOUT(io_uring 模式下为已请求或正在发送)
+		bool			bWaitWrite = false;
+
+		// 高低水位，未发送的数据达到高水位时不可写，降到低水位时恢复，高水位为 0 不启用
+		size_t			nHighWater = 0;
+		size_t			nLowWater = 0;
+		bool			bUnwritable = false;
+		// 已通知的状态，正在通知时其他线程的改变由通知者继续通知
+		bool			bNotifiedUnwritable = false;
+		bool			bNotifying = false;
+		// 可写状态改变时的回调，由所属实例设置
+		std::function<void(FNetNode*, const bool)> fnWritable;
+#if defined(TINYNET_IO_URING)
+		// io_uring 模式下所属的 Reactor
+		FReactor*		Reactor = nullptr;
+		// 已提交、未完成发送的段数，这些段位于队列前部，数据不可移动
+		unsigned int	nInflight = 0;
+#endif
+
+		size_t Pending() const { return nPending; }
+
+		// 按水位更新可写状态，需持有队列锁
+		void UpdateWritable()
 		{
-			nResult = send(fd, n_Buffer.Buffer, (int)n_Buffer.nLength, 0);
+			if (nHighWater == 0) bUnwritable = false;
+			else if (!bUnwritable) bUnwritable = nPending >= nHighWater;
+			else bUnwritable = nPending > nLowWater;
 		}
-		else if (eNetType == ENetType::UDP)
+
+		// 可写状态与已通知的不同，需持有队列锁
+		bool WritableChanged() const { return bUnwritable != bNotifiedUnwritable; }
+
+		// 复制数据到队尾，需持有队列锁
+		void Append(const char* n_szData, const size_t n_nSize)
 		{
-			nResult = sendto(fd, n_Buffer.Buffer, (int)n_Buffer.nLength, 0,
-				(stSockaddr*)Addr, sizeof(stSockaddr));
+			bool bNew = Segments.empty() || Segments.back().Shared;
+#if defined(TINYNET_IO_URING)
+			// 正在发送的段不可追加
+			bNew = bNew || Segments.size() <= nInflight;
+#endif
+			if (bNew) Segments.push_back(FSendSegment());
+
+			Segments.back().sData.append(n_szData, n_nSize);
+			nPending += n_nSize;
+			UpdateWritable();
 		}
 
-		return nResult;
+		// 引用共享数据包，不复制，需持有队列锁
+		void Append(const std::shared_ptr<const FNetBuffer>& n_Shared)
+		{
+			FSendSegment Segment;
+			Segment.Shared = n_Shared;
+			Segments.push_back(std::move(Segment));
+			nPending += n_Shared->nLength;
+			UpdateWritable();
+		}
+
+		// 移除已发送的数据，需持有队列锁
+		void Consume(size_t n_nSize)
+		{
+			nPending -= n_nSize;
+
+			while (n_nSize > 0 && !Segments.empty())
+			{
+				auto nLeft = Segments.front().Size() - nOffset;
+				if (n_nSize < nLeft)
+				{
+					nOffset += n_nSize;
+					break;
+				}
+
+				n_nSize -= nLeft;
+				nOffset = 0;
+				Segments.pop_front();
+			}
+
+			// 已发送的数据过半，回收空间
+			bool bCompact = nOffset > 0 && !Segments.front().Shared && nOffset > Segments.front().sData.size() / 2;
+#if defined(TINYNET_IO_URING)
+			bCompact = bCompact && nInflight == 0;
+#endif
+			if (bCompact)
+			{
+				Segments.front().sData.erase(0, nOffset);
+				nOffset = 0;
+			}
+
+			UpdateWritable();
+		}
+	};
+
+	// 等待发送时间戳的最大发送次数，超出则丢弃最早的记录
+	constexpr size_t kMaxTxStamps = 1024;
+
+	// 发送开始的时间，未启用发送时间戳时为 0
+	static long long TxSendStart(const FSendQueue* n_pQueue)
+	{
+		return n_pQueue->bTxStamp ? TraceNow() : 0;
 	}
 
-	int FNetNode::Send(const char* n_szData, const int n_nSize,
-		const std::string& n_sHost, const unsigned short n_nPort) const
+	// 记录交给内核的发送，n_nStart 为调用 sendmsg 前的时间(调度时间戳在调用过程中产生)，需持有队列锁
+	static void RecordTxSend(FSendQueue* n_pQueue, const size_t n_nBytes, const long long n_nStart)
 	{
-		if (!IsValid() || n_nSize == 0 || eNetType == ENetType::TCP) return 0;
+		if (!n_pQueue->bTxStamp || n_nBytes == 0) return;
 
-		FNetBuffer NetBuffer(n_szData, n_nSize);
-		return Send(NetBuffer, n_sHost, n_nPort);
+		n_pQueue->nTxBytes += (unsigned int)n_nBytes;
+		if (n_pQueue->TxStamps.size() >= kMaxTxStamps) n_pQueue->TxStamps.pop_front();
+		n_pQueue->TxStamps.push_back(std::make_pair(n_pQueue->nTxBytes - 1, n_nStart));
 	}
 
-	int FNetNode::Send(const std::string& n_sData,
-		const std::string& n_sHost, const unsigned short n_nPort) const
+	// 读取错误队列中的调度发送时间戳，与记录的发送时间匹配，在所属 Reactor 线程调用
+	static void DrainTxStamps(FNetNode* n_pNetNode, CLatencyTrace* n_pTrace)
 	{
-		return Send(n_sData.c_str(), (int)n_sData.size(), n_sHost, n_nPort);
+		auto pQueue = n_pNetNode->SendQueue;
+		if (!pQueue || !pQueue->bTxStamp) return;
+
+		char Control[256];
+		struct msghdr Msg;
+
+		while (true)
+		{
+			memset(&Msg, 0, sizeof(Msg));
+			Msg.msg_control = Control;
+			Msg.msg_controllen = sizeof(Control);
+
+			if (recvmsg(n_pNetNode->fd, &Msg, MSG_ERRQUEUE | MSG_DONTWAIT) == SOCKET_ERROR)
+			{
+				if (errno == EINTR) continue;
+				break;
+			}
+
+			long long nStamp = KernelStamp(&Msg);
+			struct sock_extended_err Error;
+			bool bError = false;
+			for (auto pCmsg = CMSG_FIRSTHDR(&Msg); pCmsg; pCmsg = CMSG_NXTHDR(&Msg, pCmsg))
+			{
+				if (pCmsg->cmsg_level != IPPROTO_IP || pCmsg->cmsg_type != IP_RECVERR) continue;
+
+				memcpy(&Error, CMSG_DATA(pCmsg), sizeof(Error));
+				bError = true;
+			}
+
+			if (!bError || nStamp == 0 || Error.ee_origin != SO_EE_ORIGIN_TIMESTAMPING ||
+				Error.ee_info != SCM_TSTAMP_SCHED) continue;
+
+			// 序号为本次发送最后一个字节的序号，之前未收到时间戳的记录一并移除
+			std::unique_lock<std::mutex> lock(pQueue->Mutex);
+			while (!pQueue->TxStamps.empty())
+			{
+				auto& Front = pQueue->TxStamps.front();
+				auto nDiff = (int)(Front.first - Error.ee_data);
+				if (nDiff > 0) break;
+
+				if (nDiff == 0) n_pTrace->Record(ELatencyStage::TxSched, nStamp - Front.second);
+				pQueue->TxStamps.pop_front();
+			}
+		}
 	}
 
-	int FNetNode::Send(const FNetBuffer& n_Buffer,
-		const std::string& n_sHost, const unsigned short n_nPort) const
+	// 监听或取消监听可写事件，需持有队列锁
+	static int WatchWritable(FSendQueue* n_pQueue, bool n_bEnable)
 	{
-		if (!n_Buffer.Buffer || !n_Buffer.nLength) return 0;
+		if (n_pQueue->bWaitWrite == n_bEnable) return 0;
+#if defined(TINYNET_IO_URING)
+		// io_uring 模式下由所属 Reactor 提交发送
+		if (n_pQueue->Reactor)
+		{
+			if (n_bEnable) RequestFlush(n_pQueue->Reactor, n_pQueue->NetNode->Id);
+			n_pQueue->bWaitWrite = n_bEnable;
+			return 0;
+		}
+#endif
+		if (n_pQueue->nEpfd <= 0) return -1;
 
-		stSockaddrIn OtherAddr = { 0 };
-		BuildSockAddrIn(&OtherAddr, n_sHost, n_nPort);
+		struct epoll_event ev;
+		ev.data.ptr = n_pQueue->NetNode;
+		ev.events = n_pQueue->nEvents;
+		if (n_bEnable) ev.events |= EPOLLOUT;
 
-		return sendto(fd, n_Buffer.Buffer, (int)n_Buffer.nLength, 0,
-			(stSockaddr*)&OtherAddr, sizeof(stSockaddr));
+		auto nRet = epoll_ctl(n_pQueue->nEpfd, EPOLL_CTL_MOD, n_pQueue->NetNode->fd, &ev);
+		if (nRet == 0) n_pQueue->bWaitWrite = n_bEnable;
+		return nRet;
 	}
 
-	const bool FNetNode::IsValid() const
+	// 监听或取消监听可读事件，暂停读取时取消，在所属 Reactor 线程调用
+	static int WatchReadable(FSendQueue* n_pQueue, bool n_bEnable)
 	{
-		return fd > 0;
+		std::unique_lock<std::mutex> lock(n_pQueue->Mutex);
+		if (n_pQueue->nEpfd <= 0) return -1;
+
+		if (n_bEnable) n_pQueue->nEvents |= EPOLLIN;
+		else n_pQueue->nEvents &= ~EPOLLIN;
+
+		// 修改后内核重新检查就绪状态，ET 模式下恢复时仍有未读数据也会通知
+		struct epoll_event ev;
+		ev.data.ptr = n_pQueue->NetNode;
+		ev.events = n_pQueue->nEvents;
+		if (n_pQueue->bWaitWrite) ev.events |= EPOLLOUT;
+
+		return epoll_ctl(n_pQueue->nEpfd, EPOLL_CTL_MOD, n_pQueue->NetNode->fd, &ev);
 	}
 
-	const std::string FNetNode::ToString()
+	// 通知可写状态的改变，不可持有队列锁；回调中发送导致的改变在本次调用中继续通知
+	static void NotifyWritable(FSendQueue* n_pQueue)
 	{
-		char szBuff[64] = { 0 };
+		std::unique_lock<std::mutex> lock(n_pQueue->Mutex);
+		if (n_pQueue->bNotifying) return;
 
-#if defined(_WIN32) || defined(_WIN64)
-		int nLen = sprintf_s(szBuff, sizeof(szBuff), "%s %s:%d ",
-#else
-		int nLen = sprintf(szBuff, "%s %s:%d ",
-#endif
-			kNetTypeString[(int)eNetType].data(),
-			Ip().data(),
-			Port()
-		);
+		n_pQueue->bNotifying = true;
+		while (n_pQueue->WritableChanged())
+		{
+			n_pQueue->bNotifiedUnwritable = n_pQueue->bUnwritable;
+			bool bWritable = !n_pQueue->bUnwritable;
 
-		return std::string(szBuff, nLen);
+			lock.unlock();
+			if (n_pQueue->fnWritable) n_pQueue->fnWritable(n_pQueue->NetNode, bWritable);
+			lock.lock();
+		}
+		n_pQueue->bNotifying = false;
 	}
 
-	bool FNetNode::operator==(const FNetNode& n_NetNode)
+	// 跳过 iovec 中已发送的数据
+	static void AdvanceIoVec(struct iovec*& n_pIov, int& n_nIov, size_t n_nBytes)
 	{
-		return memcmp(Addr, n_NetNode.Addr, 8) == 0;
+		while (n_nIov > 0 && n_nBytes >= n_pIov->iov_len)
+		{
+			n_nBytes -= n_pIov->iov_len;
+			n_pIov++;
+			n_nIov--;
+		}
+
+		if (n_nIov > 0 && n_nBytes > 0)
+		{
+			n_pIov->iov_base = (char*)n_pIov->iov_base + n_nBytes;
+			n_pIov->iov_len -= n_nBytes;
+		}
 	}
 
-	void FNetNode::Clear()
+	// 阻塞 Socket 发送完整的 iovec，处理部分发送
+	static int SendStreamV(const FNetNode* n_pNetNode, struct iovec* n_pIov, int n_nIov, const size_t n_nTotal)
 	{
-		fd = 0;
-		memset(Addr, 0, sizeof(stSockaddrIn));
-	}
+		size_t nSent = 0;
 
-	int FNetNode::Hello()
-	{
-		FNetBuffer NetBuffer;
-		NetBuffer.Alloc(0);
-		NetBuffer.SetEventId(kHelloId);
+		struct msghdr Msg;
+		memset(&Msg, 0, sizeof(Msg));
 
-		return Send(NetBuffer);
-	}
+		while (nSent < n_nTotal && n_nIov > 0)
+		{
+			Msg.msg_iov = n_pIov;
+			Msg.msg_iovlen = std::min(n_nIov, IOV_MAX);
 
-	int FNetNode::Heart(unsigned int n_nNo, unsigned int n_nFailCnt)
-	{
-		FHeart Heart = { 0 };
-		Heart.Sender = (unsigned int)fd;
-		Heart.No = htonl(n_nNo);
-		Heart.Cnt = htonl(n_nFailCnt);
+			auto nResult = sendmsg(n_pNetNode->fd, &Msg, kSendFlags);
+			if (nResult == SOCKET_ERROR)
+			{
+				if (EINTR == LastError()) continue;
+				if (IsSendBlocked(LastError())) AddStat(n_pNetNode, ENetStat::Eagain);
+				return SOCKET_ERROR;
+			}
 
-		FNetBuffer NetBuffer;
-		NetBuffer.SetData((const char*)&Heart, sizeof(FHeart));
-		NetBuffer.SetEventId(kHeartId);
+			nSent += nResult;
+			if (nSent < n_nTotal) AddStat(n_pNetNode, ENetStat::PartialSends);
+			AdvanceIoVec(n_pIov, n_nIov, nResult);
+		}
 
-		return Send(NetBuffer);
+		return (int)nSent;
 	}
 
-	int FNetNode::Quit()
+	// 非阻塞发送，无法立即发送的数据进入队列，等待可写时发送
+	// 只复制未发送的部分，返回接收的数据长度，连接异常返回 -1
+	static int QueueSendV(FSendQueue* n_pQueue, struct iovec* n_pIov, int n_nIov, const size_t n_nTotal)
 	{
-		if (eNetType != ENetType::UDP) return 0;
-		// TCP 不用通知
-		FNetBuffer NetBuffer;
-		NetBuffer.Alloc(0);
-		NetBuffer.SetEventId(kQuitId);
+		ssize_t nSent = 0;
+		std::unique_lock<std::mutex> lock(n_pQueue->Mutex);
 
-		return Send(NetBuffer);
-	}
-#pragma endregion
+		// 队列中仍有数据，需按顺序发送
+		if (n_pQueue->Pending() == 0)
+		{
+			struct msghdr Msg;
+			memset(&Msg, 0, sizeof(Msg));
+			Msg.msg_iov = n_pIov;
+			Msg.msg_iovlen = std::min(n_nIov, IOV_MAX);
 
-	////////////////////////////////////////////////////////////////////////////////
-#pragma region 网络接口
-#if defined(_WIN32) || defined(_WIN64)
-	int ITinyImpl::m_nRef = 0;
-#endif
+			auto nStart = TxSendStart(n_pQueue);
+			do
+			{
+				nSent = sendmsg(n_pQueue->NetNode->fd, &Msg, kSendFlags);
+			} while (nSent == SOCKET_ERROR && errno == EINTR);
 
-	ITinyImpl::ITinyImpl()
-	{
-		Startup();
-	}
+			if (nSent == SOCKET_ERROR)
+			{
+				if (errno != EAGAIN && errno != EWOULDBLOCK)
+					return SOCKET_ERROR;
+				AddStat(n_pQueue->NetNode, ENetStat::Eagain);
+				nSent = 0;
+			}
 
-	ITinyImpl::~ITinyImpl()
-	{
-		Cleanup();
-	}
+			RecordTxSend(n_pQueue, nSent, nStart);
+			if ((size_t)nSent == n_nTotal) return (int)n_nTotal;
+			if (nSent > 0) AddStat(n_pQueue->NetNode, ENetStat::PartialSends);
+		}
 
-	void ITinyImpl::SetRecvBuffSize(const int n_nSize)
-	{
-		m_nBuffSize = n_nSize;
+		AdvanceIoVec(n_pIov, n_nIov, nSent);
+		for (int i = 0; i < n_nIov; i++)
+			n_pQueue->Append((const char*)n_pIov[i].iov_base, n_pIov[i].iov_len);
+
+		WatchWritable(n_pQueue, true);
+
+		bool bNotify = n_pQueue->WritableChanged();
+		lock.unlock();
+		if (bNotify) NotifyWritable(n_pQueue);
+
+		return (int)n_nTotal;
 	}
 
-	void ITinyImpl::SetTinyCallback(ITinyCallback* n_TinyCallback)
+	static int QueueSend(FSendQueue* n_pQueue, const char* n_szData, const int n_nSize)
 	{
-		m_TinyCallback = n_TinyCallback;
+		struct iovec IoVec;
+		IoVec.iov_base = (void*)n_szData;
+		IoVec.iov_len = n_nSize;
+
+		return QueueSendV(n_pQueue, &IoVec, 1, n_nSize);
 	}
 
-	void ITinyImpl::Startup()
+	// 共享数据包加入队列，不立即发送
+	// 返回队列原本是否为空或可写状态改变，需由所属 Reactor 调用 FlushSendQueue 发送并通知
+	static bool QueueShared(FSendQueue* n_pQueue, const std::shared_ptr<const FNetBuffer>& n_Shared)
 	{
-#if defined(_WIN32) || defined(_WIN64)
-		if (m_nRef == 0)
-		{
-			WSADATA wsaData;
-			int nResult = WSAStartup(MAKEWORD(2, 2), &wsaData);
-			if (nResult != 0) DebugLog("初始化 Socket 失败\n");
-		}
+		std::unique_lock<std::mutex> lock(n_pQueue->Mutex);
 
-		m_nRef++;
-#endif
+		auto bIdle = n_pQueue->Pending() == 0;
+		n_pQueue->Append(n_Shared);
+
+		return bIdle || n_pQueue->WritableChanged();
 	}
 
-	void ITinyImpl::Cleanup()
+	// 发送队列中的数据，在 Reactor 线程调用
+	// 未发送完则监听可写事件，连接异常返回 -1
+	static int FlushSendQueue(FSendQueue* n_pQueue)
 	{
-#if defined(_WIN32) || defined(_WIN64)
-		m_nRef--;
+		std::unique_lock<std::mutex> lock(n_pQueue->Mutex);
 
-		if (m_nRef <= 0)
+		struct iovec IoVec[kFlushIoVecSize];
+		struct msghdr Msg;
+		memset(&Msg, 0, sizeof(Msg));
+		Msg.msg_iov = IoVec;
+
+		while (n_pQueue->Pending() > 0)
 		{
-			WSACleanup();
-			m_nRef = 0;
+			// 多段数据合并为一次 sendmsg
+			size_t nOffset = n_pQueue->nOffset;
+			size_t nBytes = 0;
+			int nIov = 0;
+			for (auto it = n_pQueue->Segments.begin();
+				it != n_pQueue->Segments.end() && nIov < kFlushIoVecSize; ++it)
+			{
+				IoVec[nIov].iov_base = (void*)(it->Data() + nOffset);
+				IoVec[nIov++].iov_len = it->Size() - nOffset;
+				nBytes += it->Size() - nOffset;
+				nOffset = 0;
+			}
+			Msg.msg_iovlen = nIov;
+
+			auto nStart = TxSendStart(n_pQueue);
+			auto nResult = sendmsg(n_pQueue->NetNode->fd, &Msg, kSendFlags);
+			if (nResult == SOCKET_ERROR)
+			{
+				if (errno == EINTR) continue;
+				if (errno == EAGAIN || errno == EWOULDBLOCK)
+				{
+					AddStat(n_pQueue->NetNode, ENetStat::Eagain);
+					break;
+				}
+				return SOCKET_ERROR;
+			}
+
+			if ((size_t)nResult < nBytes) AddStat(n_pQueue->NetNode, ENetStat::PartialSends);
+			RecordTxSend(n_pQueue, nResult, nStart);
+			n_pQueue->Consume(nResult);
 		}
-#endif
+
+		WatchWritable(n_pQueue, n_pQueue->Pending() > 0);
+
+		bool bNotify = n_pQueue->WritableChanged();
+		lock.unlock();
+		if (bNotify) NotifyWritable(n_pQueue);
+
+		return 0;
 	}
+#endif
 #pragma endregion
-
 	////////////////////////////////////////////////////////////////////////////////
-#pragma region 组播
-	CMulticast::CMulticast()
-	{
-	}
+#pragma region 分散发送
+#if !defined(_WIN32) && !defined(_WIN64)
+	// 栈上 iovec 数量，超出则在堆上分配
+	constexpr int kStackIoVecSize = 16;
+
+	// 数据头写在栈上，与用户数据一同通过 sendmsg 发送，不复制用户数据
+	static int SendFrameV(const FNetNode* n_pNetNode, const void* n_pAddr,
+		const FNetIoVec* n_pIoVec, const int n_nCount)
+	{
+		size_t nSize = 0;
+		for (int i = 0; i < n_nCount; i++) nSize += n_pIoVec[i].nSize;
+
+		FHeader Header;
+		Header.nLength = htonl((unsigned int)nSize);
+		Header.nEventId = 0;
+
+		struct iovec StackIov[kStackIoVecSize];
+		std::vector<struct iovec> HeapIov;
+		struct iovec* pIov = StackIov;
+		if (n_nCount + 1 > kStackIoVecSize)
+		{
+			HeapIov.resize(n_nCount + 1);
+			pIov = HeapIov.data();
+		}
 
-	CMulticast::~CMulticast()
-	{
-		Release();
-	}
+		int nIov = 0;
+		pIov[nIov].iov_base = &Header;
+		pIov[nIov++].iov_len = sizeof(FHeader);
+		for (int i = 0; i < n_nCount; i++)
+		{
+			if (n_pIoVec[i].nSize == 0) continue;
+			pIov[nIov].iov_base = (void*)n_pIoVec[i].Data;
+			pIov[nIov++].iov_len = n_pIoVec[i].nSize;
+		}
 
-	bool CMulticast::Init(const std::string& n_sHost, const unsigned short n_nPort)
-	{
-		if (m_NetNode.IsValid()) return true;
+		auto nTotal = nSize + sizeof(FHeader);
 
-		m_NetNode.fd = socket(AF_INET, SOCK_DGRAM, 0);
-		if (m_NetNode.fd == SOCKET_ERROR)
+		if (n_pNetNode->eNetType == ENetType::TCP)
 		{
-			DebugLog("create Socket error: %d\n", LastError());
+			if (n_pNetNode->SendQueue)
+				return CountSent(n_pNetNode, QueueSendV(n_pNetNode->SendQueue, pIov, nIov, nTotal), nTotal);
+			return CountSent(n_pNetNode, SendStreamV(n_pNetNode, pIov, nIov, nTotal), nTotal);
 		}
-		else
+
+		// UDP 一次发送一个完整数据报
+		struct msghdr Msg;
+		memset(&Msg, 0, sizeof(Msg));
+		Msg.msg_name = (void*)n_pAddr;
+		Msg.msg_namelen = sizeof(stSockaddrIn);
+		Msg.msg_iov = pIov;
+		Msg.msg_iovlen = nIov;
+
+		return CountSent(n_pNetNode, (int)sendmsg(n_pNetNode->fd, &Msg, 0), nTotal);
+	}
+#else
+	// 合并到一个 FNetBuffer 发送
+	static int SendFrameV(const FNetNode* n_pNetNode, const void* n_pAddr,
+		const FNetIoVec* n_pIoVec, const int n_nCount)
+	{
+		size_t nSize = 0;
+		for (int i = 0; i < n_nCount; i++) nSize += n_pIoVec[i].nSize;
+
+		FNetBuffer NetBuffer;
+		NetBuffer.Alloc(nSize);
+
+		auto pData = (char*)NetBuffer.GetData();
+		for (int i = 0; i < n_nCount; i++)
 		{
-			BuildSockAddrIn(&m_NetNode.Addr, n_sHost, n_nPort);
+			if (n_pIoVec[i].nSize == 0) continue;
+			memcpy(pData, n_pIoVec[i].Data, n_pIoVec[i].nSize);
+			pData += n_pIoVec[i].nSize;
 		}
 
-		return m_NetNode.IsValid();
-	}
+		if (n_pNetNode->eNetType == ENetType::TCP)
+			return CountSent(n_pNetNode, SendStream(n_pNetNode, NetBuffer.Buffer, (int)NetBuffer.nLength), NetBuffer.nLength);
 
-	int CMulticast::SetTTL(unsigned char n_nTTL)
-	{
-		if (!m_NetNode.IsValid()) return -1;
-		return SetSocketTTL(m_NetNode.fd, IP_MULTICAST_TTL, n_nTTL);
+		return CountSent(n_pNetNode, sendto(n_pNetNode->fd, NetBuffer.Buffer, (int)NetBuffer.nLength, 0,
+			(const stSockaddr*)n_pAddr, sizeof(stSockaddr)), NetBuffer.nLength);
 	}
-
-	int CMulticast::SetBroadcast(bool n_bEnable)
-	{
-		if (!m_NetNode.IsValid()) return -1;
-		return SetSocketBroadcast(m_NetNode.fd, n_bEnable);
+#endif
+#pragma endregion
+	////////////////////////////////////////////////////////////////////////////////
+#pragma region 批量收发
+	// 单次批量接收、发送的最大数据报数量
+	constexpr unsigned int kMaxBatchSize = 64;
+	// GRO 合并后的最大长度
+	constexpr int kMaxGroSize = 65536;
+	// GSO 单次发送的最大长度(IPv4 UDP 最大负载)
+	constexpr size_t kMaxGsoSize = 65507;
+	// GSO 单次发送的最大分段数
+	constexpr int kMaxGsoSegments = 64;
+
+	static unsigned int RecvBatchSize(const unsigned int n_nCount)
+	{
+		return std::max(1u, std::min(n_nCount, kMaxBatchSize));
 	}
 
-	int CMulticast::Sender()
+#if !defined(_WIN32) && !defined(_WIN64)
+	// GRO 合并的分段长度，未合并返回数据长度
+	static int GroSegmentSize(struct msghdr* n_pMsg, const int n_nSize)
 	{
-		if (!m_NetNode.IsValid()) return -1;
-		m_NetNode.eNetType = ENetType::UDP;
-		return 0;
+		for (auto pCmsg = CMSG_FIRSTHDR(n_pMsg); pCmsg; pCmsg = CMSG_NXTHDR(n_pMsg, pCmsg))
+		{
+			if (pCmsg->cmsg_level != SOL_UDP || pCmsg->cmsg_type != UDP_GRO) continue;
+
+			int nSegment = 0;
+			memcpy(&nSegment, CMSG_DATA(pCmsg), sizeof(int));
+			if (nSegment > 0) return nSegment;
+		}
+
+		return n_nSize;
 	}
 
-	int CMulticast::Receiver(const std::string& n_sLocalIP)
+	// recvmmsg 批量接收，每个数据报使用缓存中独立的一段及 sockaddr
+	// Socket 启用 UDP_GRO 时，一段中可能是多个合并的数据报，由 ForEach 按分段长度拆分
+	struct FRecvBatch
 	{
-		int nResult = -1;
-		if (!m_NetNode.IsValid()) return nResult;
+		struct mmsghdr	Msgs[kMaxBatchSize];
+		struct iovec	IoVecs[kMaxBatchSize];
+		stSockaddrIn	Addrs[kMaxBatchSize];
+		// 接收 UDP_GRO 分段长度及接收时间戳
+		char			Controls[kMaxBatchSize][CMSG_SPACE(sizeof(int)) + kStampControlSize];
+		unsigned int	nCount = 0;
 
-		do
+		// n_szBuff 长度需不小于 n_nBuffSize * n_nCount
+		FRecvBatch(char* n_szBuff, const int n_nBuffSize, const unsigned int n_nCount)
 		{
-			m_NetNode.eNetType = ENetType::UDP_MULTICAST;
+			nCount = RecvBatchSize(n_nCount);
+			memset(Msgs, 0, sizeof(struct mmsghdr) * nCount);
 
-			m_sLocalIp = n_sLocalIP;
-			if (m_sLocalIp.empty()) m_sLocalIp = GetLocalIPAddress();
+			for (unsigned int i = 0; i < nCount; i++)
+			{
+				IoVecs[i].iov_base = n_szBuff + (size_t)n_nBuffSize * i;
+				IoVecs[i].iov_len = n_nBuffSize;
 
-			stSockaddrIn Addr = { 0 };
-			BuildSockAddrIn(&Addr, m_sLocalIp, m_NetNode.Port());
+				Msgs[i].msg_hdr.msg_iov = &IoVecs[i];
+				Msgs[i].msg_hdr.msg_iovlen = 1;
+				Msgs[i].msg_hdr.msg_name = &Addrs[i];
+			}
+		}
 
-			nResult = bind(m_NetNode.fd, (stSockaddr*)&Addr, sizeof(stSockaddr));
-			if (nResult == -1)
+		// 返回接收的数据报数量，失败返回 -1
+		int Recv(const size_t n_nFd, const int n_nFlags)
+		{
+			for (unsigned int i = 0; i < nCount; i++)
 			{
-				DebugLog("multicast bind Socket error: %d\n", LastError());
-				break;
+				Msgs[i].msg_hdr.msg_namelen = sizeof(stSockaddrIn);
+				Msgs[i].msg_hdr.msg_control = Controls[i];
+				Msgs[i].msg_hdr.msg_controllen = sizeof(Controls[i]);
 			}
 
-			stIpMreq IpMreq = { 0 };
-			memcpy(&IpMreq.imr_multiaddr,
-				&toSockaddrIn(m_NetNode.Addr)->sin_addr,
-				sizeof(struct in_addr));
-			inet_pton(AF_INET, m_sLocalIp.c_str(), &IpMreq.imr_interface.s_addr);
+			int nResult = 0;
+			do
+			{
+				nResult = recvmmsg(n_nFd, Msgs, nCount, n_nFlags, nullptr);
+			} while (nResult == SOCKET_ERROR && errno == EINTR);
 
-			if (SetSocketAddMemberShip(m_NetNode.fd, (ValType)&IpMreq) < 0)
-				break;
+			return nResult;
+		}
 
-			std::thread(&CMulticast::MulticastThread, this).detach();
+		const char* Data(const int n_nIndex) const { return (const char*)IoVecs[n_nIndex].iov_base; }
+		const int Size(const int n_nIndex) const { return (int)Msgs[n_nIndex].msg_len; }
 
-		} while (false);
+		// GRO 合并的分段长度，未合并返回数据长度
+		const int SegmentSize(const int n_nIndex)
+		{
+			return GroSegmentSize(&Msgs[n_nIndex].msg_hdr, Size(n_nIndex));
+		}
 
-		return nResult;
-	}
+		// 依次回调接收的数据报，回调参数为 (序号, 数据, 长度)
+		// 接收缓存不足而被截断的数据报不回调，返回其数量
+		template <typename FCallback>
+		int ForEach(const int n_nCount, FCallback n_fnCallback)
+		{
+			int nDrops = 0;
+			for (int i = 0; i < n_nCount; i++)
+			{
+				if (Msgs[i].msg_hdr.msg_flags & MSG_TRUNC)
+				{
+					nDrops++;
+					continue;
+				}
 
-	int CMulticast::Release()
+				auto szData = Data(i);
+				auto nSize = Size(i);
+				auto nSegment = SegmentSize(i);
+				t_RecvStamp.nKernel = KernelStamp(&Msgs[i].msg_hdr);
+
+				for (int nOffset = 0; nOffset < nSize; nOffset += nSegment)
+					n_fnCallback(i, szData + nOffset, std::min(nSegment, nSize - nOffset));
+			}
+
+			return nDrops;
+		}
+	};
+
+	// 一条 GSO 消息可包含的数据报数量，数据报长度需相同，最后一个可以较短
+	static int GsoGroupSize(const FNetIoVec* n_pMessages, const int n_nCount, const size_t n_nHeader)
 	{
-		if (!m_NetNode.IsValid()) return -1;
+		auto nSegment = n_pMessages[0].nSize + n_nHeader;
+		if (nSegment == 0) return 1;
 
-		if (m_NetNode.eNetType == ENetType::UDP_MULTICAST)
+		size_t nTotal = nSegment;
+		int i = 1;
+		for (; i < n_nCount && i < kMaxGsoSegments; i++)
 		{
-			stIpMreq IpMreq = { 0 };
-			memcpy(&IpMreq.imr_multiaddr,
-				&toSockaddrIn(m_NetNode.Addr)->sin_addr,
-				sizeof(struct in_addr));
-			inet_pton(AF_INET, m_sLocalIp.c_str(), &IpMreq.imr_interface.s_addr);
+			auto nSize = n_pMessages[i].nSize + n_nHeader;
+			if (nSize > nSegment || nTotal + nSize > kMaxGsoSize) break;
 
-			SetSocketDropMemberShip(m_NetNode.fd, (ValType)&IpMreq);
+			nTotal += nSize;
+			// 较短的数据报只能是最后一个
+			if (nSize < nSegment) return i + 1;
 		}
 
-		CloseSocket(m_NetNode.fd);
-		m_NetNode.Clear();
-
-		return 0;
+		return i;
 	}
 
-	int CMulticast::Send(const char* n_szData, const int n_nSize)
+	// sendmmsg 批量发送数据报，n_bFrame 为 true 时每个数据报前加数据头
+	// n_bGso 为 true 时长度相同的连续数据报合并为一条 UDP_SEGMENT 消息，由内核拆分
+	// 返回发送的数据报数量，失败返回 -1
+	static int SendDatagrams(const size_t n_nFd, const void* n_pAddr,
+		const FNetIoVec* n_pMessages, const int n_nCount, const bool n_bFrame, bool n_bGso = false)
 	{
-		if (m_NetNode.eNetType != ENetType::UDP) return 0;
-		return sendto(m_NetNode.fd, n_szData, n_nSize, 0,
-				(stSockaddr*)m_NetNode.Addr, sizeof(stSockaddr));
-	}
+		struct mmsghdr	Msgs[kMaxBatchSize];
+		struct iovec	IoVecs[kMaxBatchSize * 2];
+		FHeader			Headers[kMaxBatchSize];
+		char			Controls[kMaxBatchSize][CMSG_SPACE(sizeof(uint16_t))];
+		// 每条消息包含的数据报数量
+		int				Groups[kMaxBatchSize];
 
-	int CMulticast::Send(const std::string n_sData)
-	{
-		if (m_NetNode.eNetType != ENetType::UDP) return 0;
-		return Send(n_sData.data(), (int)n_sData.size());
-	}
+		auto nHeader = n_bFrame ? sizeof(FHeader) : 0;
 
-	void CMulticast::MulticastThread() const
-	{
-		int nResult = 0;
+		int nSent = 0;
+		while (nSent < n_nCount)
+		{
+			// 单次最多 kMaxBatchSize 个数据报，GSO 时合并为更少的消息
+			int nBatch = std::min(n_nCount - nSent, (int)kMaxBatchSize);
+			memset(Msgs, 0, sizeof(struct mmsghdr) * nBatch);
 
-		char* szBuff = (char*)malloc(m_nBuffSize);
-		if (!szBuff) return;
+			int nMsg = 0;
+			for (int i = 0; i < nBatch; nMsg++)
+			{
+				int nGroup = n_bGso ? GsoGroupSize(&n_pMessages[nSent + i], nBatch - i, nHeader) : 1;
+				auto pIov = &IoVecs[i * 2];
+				int nIov = 0;
 
-		stSockaddrIn	Addr = { 0 };
-		SockaddrLen		nLen = sizeof(stSockaddrIn);
+				for (int k = 0; k < nGroup; k++, i++)
+				{
+					auto& Message = n_pMessages[nSent + i];
+					if (n_bFrame)
+					{
+						Headers[i].nLength = htonl((unsigned int)Message.nSize);
+						Headers[i].nEventId = 0;
+						pIov[nIov].iov_base = &Headers[i];
+						pIov[nIov++].iov_len = sizeof(FHeader);
+					}
+					pIov[nIov].iov_base = (void*)Message.Data;
+					pIov[nIov++].iov_len = Message.nSize;
+				}
 
-		while (true)
+				auto& Msg = Msgs[nMsg].msg_hdr;
+				Msg.msg_name = (void*)n_pAddr;
+				Msg.msg_namelen = sizeof(stSockaddrIn);
+				Msg.msg_iov = pIov;
+				Msg.msg_iovlen = nIov;
+				Groups[nMsg] = nGroup;
+
+				if (nGroup > 1)
+				{
+					Msg.msg_control = Controls[nMsg];
+					Msg.msg_controllen = sizeof(Controls[nMsg]);
+
+					auto pCmsg = CMSG_FIRSTHDR(&Msg);
+					pCmsg->cmsg_level = SOL_UDP;
+					pCmsg->cmsg_type = UDP_SEGMENT;
+					pCmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+
+					uint16_t nSegment = (uint16_t)(pIov[0].iov_len + (n_bFrame ? pIov[1].iov_len : 0));
+					memcpy(CMSG_DATA(pCmsg), &nSegment, sizeof(uint16_t));
+				}
+			}
+
+			auto nResult = sendmmsg(n_nFd, Msgs, nMsg, 0);
+			if (nResult == SOCKET_ERROR)
+			{
+				if (errno == EINTR) continue;
+				// 内核或网卡不支持 GSO，逐个发送
+				if (n_bGso && (errno == EINVAL || errno == EIO || errno == ENOPROTOOPT || errno == EOPNOTSUPP))
+				{
+					n_bGso = false;
+					continue;
+				}
+				return nSent > 0 ? nSent : SOCKET_ERROR;
+			}
+
+			for (int i = 0; i < nResult; i++) nSent += Groups[i];
+		}
+
+		return nSent;
+	}
+#else
+	static int SendDatagrams(const size_t n_nFd, const void* n_pAddr,
+		const FNetIoVec* n_pMessages, const int n_nCount, const bool n_bFrame, bool n_bGso = false)
+	{
+		int nSent = 0;
+		for (; nSent < n_nCount; nSent++)
 		{
-			memset(szBuff, 0, m_nBuffSize);
-			nResult = recvfrom(m_NetNode.fd,
-				szBuff, m_nBuffSize, 0, (stSockaddr*)&Addr, &nLen);
-			if (nResult <= 0) break;
+			auto& Message = n_pMessages[nSent];
 
-			if (fnRecvCallback) fnRecvCallback(szBuff, nResult);
-			if (m_TinyCallback) m_TinyCallback->OnReceiveCallback(nullptr, szBuff, nResult);
+			int nResult = 0;
+			if (n_bFrame)
+			{
+				FNetBuffer NetBuffer(Message.Data, Message.nSize);
+				nResult = sendto(n_nFd, NetBuffer.Buffer, (int)NetBuffer.nLength, 0,
+					(const stSockaddr*)n_pAddr, sizeof(stSockaddr));
+			}
+			else
+			{
+				nResult = sendto(n_nFd, Message.Data, (int)Message.nSize, 0,
+					(const stSockaddr*)n_pAddr, sizeof(stSockaddr));
+			}
+
+			if (nResult == SOCKET_ERROR) return nSent > 0 ? nSent : SOCKET_ERROR;
 		}
 
-		memset(szBuff, 0, m_nBuffSize);
+		return nSent;
 	}
+#endif
 #pragma endregion
-
 	////////////////////////////////////////////////////////////////////////////////
-#pragma region Socket基类
+#pragma region io_uring
+#if defined(TINYNET_IO_URING)
+	// 提交队列长度，完成队列为其8倍
+	constexpr unsigned int kRingEntries = 256;
+	// 每个 io_uring 接收缓存的总长度
+	constexpr size_t kRingBufferBytes = 1024 * 1024 * 4;
+	// 接收缓存组Id
+	constexpr unsigned short kRingBufferGroup = 0;
+	// 每个连接单次提交的最大发送段数
+	constexpr unsigned int kRingSendChain = 16;
+
+	// 请求类型，保存在 user_data 低位，高位为节点地址
+	enum class ERingOp : unsigned long long
+	{
+		// 唤醒事件
+		Wake = 0,
+		// 多次触发的 accept
+		Accept,
+		// 多次触发的 recv(TCP)、recvmsg(UDP)
+		Recv,
+		Send,
+		// 取消连接未完成的请求
+		Cancel,
+	};
+	constexpr unsigned long long kRingOpMask = 0x7;
 
-	ITinyNet::ITinyNet()
+	static unsigned long long RingData(const void* n_pData, const ERingOp n_eOp)
 	{
+		return (unsigned long long)(uintptr_t)n_pData | (unsigned long long)n_eOp;
 	}
 
-	ITinyNet::~ITinyNet()
+	static ERingOp RingOp(const unsigned long long n_nData)
 	{
+		return (ERingOp)(n_nData & kRingOpMask);
 	}
 
-	bool ITinyNet::Start()
+	static void* RingPtr(const unsigned long long n_nData)
 	{
-		return true;
+		return (void*)(uintptr_t)(n_nData & ~kRingOpMask);
 	}
 
-	void ITinyNet::Stop()
+	// 单个接收缓存长度，UDP 缓存前部为 recvmsg 结果头、sockaddr 及控制信息
+	static unsigned int RingBufferSize(const ENetType n_eType, const int n_nBuffSize)
 	{
+		if (n_eType != ENetType::UDP) return n_nBuffSize;
+		return sizeof(struct io_uring_recvmsg_out) + sizeof(stSockaddrIn) +
+			CMSG_SPACE(sizeof(int)) + n_nBuffSize;
 	}
 
-	void ITinyNet::EnableHeart(unsigned int n_nPeriod, unsigned int n_nTimeoutCnt)
+	// 创建 io_uring 及接收缓存环，内核不支持返回 nullptr
+	static CUring* CreateUring(const unsigned int n_nBuffSize)
 	{
-	}
+		auto nCount = kRingBufferBytes / n_nBuffSize;
+		nCount = std::max<size_t>(16, std::min<size_t>(nCount, 4096));
 
-	void ITinyNet::SetTimeout(int n_nMilliSeconds)
-	{
-		m_nTimeout = n_nMilliSeconds;
+		auto pRing = new CUring;
+		if (!pRing->Init(kRingEntries) ||
+			!pRing->SetupBufRing(kRingBufferGroup, (unsigned int)nCount, n_nBuffSize))
+		{
+			delete pRing;
+			return nullptr;
+		}
+
+		return pRing;
 	}
 
-	void ITinyNet::SetTTL(int n_nTTL)
+	// 提交多次触发的事件监听
+	static bool PrepPoll(CUring* n_pRing, const int n_nFd,
+		const unsigned int n_nEvents, const unsigned long long n_nData)
 	{
-		if (n_nTTL > 255) return;
-		m_nTTL = n_nTTL;
+		auto pSqe = n_pRing->GetSqe();
+		if (!pSqe) return false;
+
+		pSqe->opcode = IORING_OP_POLL_ADD;
+		pSqe->fd = n_nFd;
+		pSqe->poll32_events = n_nEvents;
+		pSqe->len = IORING_POLL_ADD_MULTI;
+		pSqe->user_data = n_nData;
+
+		return true;
 	}
 
-	int ITinyNet::KeepAlive(const size_t n_nFd) const
+	// 多次触发 recvmsg 的消息模板，只使用 msg_namelen 及 msg_controllen
+	static void InitRingMsg(struct msghdr* n_pMsg)
 	{
-		if (!IsValid()) return -1;
-		if (eNetType != ENetType::TCP) return 0;
-		return SetSocketKeepAlive(n_nFd, 1);
+		memset(n_pMsg, 0, sizeof(struct msghdr));
+		n_pMsg->msg_namelen = sizeof(stSockaddrIn);
+		n_pMsg->msg_controllen = CMSG_SPACE(sizeof(int));
 	}
 
-	bool ITinyNet::OnEventMessage(FNetNode* n_pNetNode, const char* n_szData, const int n_nSize)
-	{
-		return false;
+	// 提交多次触发的接收，数据写入内核选择的接收缓存
+	// n_pMsg 不为空时为 recvmsg(UDP)，需在请求结束前保持有效
+	static bool PrepRecv(CUring* n_pRing, const size_t n_nFd,
+		struct msghdr* n_pMsg, const unsigned long long n_nData)
+	{
+		auto pSqe = n_pRing->GetSqe();
+		if (!pSqe) return false;
+
+		pSqe->opcode = n_pMsg ? IORING_OP_RECVMSG : IORING_OP_RECV;
+		pSqe->fd = (int)n_nFd;
+		pSqe->ioprio = IORING_RECV_MULTISHOT;
+		pSqe->flags = IOSQE_BUFFER_SELECT;
+		pSqe->buf_group = kRingBufferGroup;
+		pSqe->user_data = n_nData;
+		if (n_pMsg)
+		{
+			pSqe->addr = (unsigned long long)(uintptr_t)n_pMsg;
+			pSqe->len = 1;
+		}
+
+		return true;
 	}
 
-	void ITinyNet::ReceiveTcpMessage(FNetNode* n_pNetNode, 
-		std::string& n_sLast, const char* n_szData, const int n_nSize)
+	// 依次回调 recvmsg 接收缓存中的数据报，回调参数为 (sockaddr, 数据, 长度)
+	// 缓存格式为 io_uring_recvmsg_out + sockaddr + 控制信息 + 数据，GRO 合并的数据报按分段长度拆分
+	// 被截断的数据报不回调，返回丢弃的数量
+	template <typename FCallback>
+	static int ForEachRingDatagram(const char* n_szBuff, const int n_nSize,
+		const struct msghdr* n_pMsg, FCallback n_fnCallback)
 	{
-		if (eNetType != ENetType::TCP) return;
-		if (n_nSize == 0) return;
+		auto pOut = (const struct io_uring_recvmsg_out*)n_szBuff;
+		auto nHeader = sizeof(struct io_uring_recvmsg_out) + n_pMsg->msg_namelen + n_pMsg->msg_controllen;
+		if ((size_t)n_nSize < nHeader) return 1;
+		if ((pOut->flags & MSG_TRUNC) || pOut->payloadlen > n_nSize - nHeader) return 1;
 
-		FNetBuffer NetBuffer;
-		if (!n_sLast.empty())
-		{
-			if (!NetBuffer.PointTo(n_sLast)) 
-			{
-				n_sLast.append(n_szData, 1);
-				ReceiveTcpMessage(n_pNetNode, n_sLast, n_szData + 1, n_nSize - 1);
-				return;
-			}
+		auto szName = n_szBuff + sizeof(struct io_uring_recvmsg_out);
+		auto szData = n_szBuff + nHeader;
+		auto nSize = (int)std::min<size_t>(pOut->payloadlen, n_nSize - nHeader);
 
-			// 数据包原长度
-			auto nSize = NetBuffer.GetDataPacketSize() + sizeof(FHeader);
-			if (nSize > kMaxTCPBufferSize)
-			{
-				// 长度头异常，丢弃
-				std::string().swap(n_sLast);
-				//ReceiveTcpMessage(n_pNetNode, n_sLast, n_szData, n_nSize);
-				return;
-			}
-			else if (nSize > NetBuffer.nLength + n_nSize)
-			{
-				// 加上新的数据仍不足一个完整数据包
-				n_sLast.append(n_szData, n_nSize);
-				return;
-			}
+		struct msghdr Msg;
+		memset(&Msg, 0, sizeof(Msg));
+		Msg.msg_control = (void*)(szName + n_pMsg->msg_namelen);
+		Msg.msg_controllen = pOut->controllen;
 
-			// 完整数据包仍需长度
-			auto nLack = nSize - NetBuffer.nLength;
-			// 补足完整数据包
-			n_sLast.append(n_szData, nLack);
+		auto nSegment = GroSegmentSize(&Msg, nSize);
+		for (int nOffset = 0; nOffset < nSize; nOffset += nSegment)
+			n_fnCallback(szName, szData + nOffset, std::min(nSegment, nSize - nOffset));
 
-			if (!OnEventMessage(n_pNetNode, n_sLast.data(), (int)nSize))
+		return 0;
+	}
+#endif
+#pragma endregion
+	////////////////////////////////////////////////////////////////////////////////
+#pragma region 定时器
+	// 共享的定时器线程，客户端心跳及用户定时器在该线程执行
+	struct FTimerThread
+	{
+		std::mutex				Mutex;
+		std::condition_variable	Cond;
+		// 回调执行完成
+		std::condition_variable	Done;
+		CTimerWheel				Wheel;
+		// 正在执行的定时器，执行回调时不持有锁
+		CTimerWheel::Id			nRunning = 0;
+		std::thread::id			Worker;
+		bool					bStarted = false;
+
+		CTimerWheel::Id Schedule(const unsigned int n_nDelay,
+			const unsigned int n_nPeriod, CTimerWheel::Callback n_fnCallback)
+		{
+			std::unique_lock<std::mutex> lock(Mutex);
+			if (!bStarted)
 			{
-				// 更新Buffer长度
-				NetBuffer.PointTo(n_sLast);
-				OnRecvCallback(n_pNetNode, NetBuffer.GetData(), (int)NetBuffer.DataSize());
+				bStarted = true;
+				std::thread(&FTimerThread::Run, this).detach();
 			}
 
-			n_sLast.clear();
-
-			// 处理剩余数据
-			ReceiveTcpMessage(n_pNetNode, n_sLast, n_szData + nLack, n_nSize - (int)nLack);
+			auto nId = Wheel.Schedule(n_nDelay, n_nPeriod, [this, n_fnCallback]() {
+				nRunning = Wheel.Running();
+				Mutex.unlock();
+				n_fnCallback();
+				Mutex.lock();
+				nRunning = 0;
+				Done.notify_all();
+			});
+
+			Cond.notify_one();
+			return nId;
 		}
-		else
-		{
-			if (!NetBuffer.PointTo(n_szData, n_nSize))
-			{
-				n_sLast.append(n_szData, n_nSize);
-				return;
-			}
 
-			// 数据包原长度
-			auto nSize = NetBuffer.GetDataPacketSize() + sizeof(FHeader);
-			if (nSize < NetBuffer.nLength)
-			{
-				// 数据不足一个完整数据包
-				n_sLast.append(n_szData, n_nSize);
-				return;
-			}
+		bool Cancel(const CTimerWheel::Id n_nId)
+		{
+			std::unique_lock<std::mutex> lock(Mutex);
+			auto bResult = Wheel.Cancel(n_nId);
 
-			if (!OnEventMessage(n_pNetNode, n_szData, nSize))
-			{
-				OnRecvCallback(n_pNetNode, NetBuffer.GetData(), (int)NetBuffer.DataSize());
-			}
+			// 等待正在执行的回调完成，在回调中取消时不等待
+			if (std::this_thread::get_id() != Worker)
+				Done.wait(lock, [&]() { return nRunning != n_nId; });
 
-			// 处理剩余数据 此时 nLack <= 0
-			ReceiveTcpMessage(n_pNetNode, n_sLast, n_szData + nSize, n_nSize - nSize);
+			return bResult;
 		}
-	}
 
-	void ITinyNet::ReceiveUdpMessage(FNetNode* n_pNetNode, const char* n_szData, const int n_nSize)
-	{
-		if (eNetType != ENetType::UDP) return;
-		if (!OnEventMessage(n_pNetNode, n_szData, n_nSize))
+		void Run()
 		{
-			FNetBuffer NetBuffer;
-			if (!NetBuffer.PointTo(n_szData, n_nSize)) return;
-			OnRecvCallback(n_pNetNode, NetBuffer.GetData(), NetBuffer.DataSize());
-		}
-	}
+			std::unique_lock<std::mutex> lock(Mutex);
+			Worker = std::this_thread::get_id();
 
-	void ITinyNet::OnEventCallback(FNetNode* n_pNetNode,
-		const ENetEvent n_eNetEvent, const std::string& n_sData)
-	{
-		if (fnEventCallback) fnEventCallback(n_pNetNode, n_eNetEvent, n_sData);
-		if (m_TinyCallback) m_TinyCallback->OnEventCallback(n_pNetNode, n_eNetEvent, n_sData);
-	}
+			while (true)
+			{
+				Wheel.Advance();
 
-	void ITinyNet::OnRecvCallback(FNetNode* n_pNetNode, const char* n_szData, int n_nSize)
+				auto nTimeout = Wheel.NextTimeout();
+				if (nTimeout < 0) Cond.wait(lock);
+				else if (nTimeout > 0) Cond.wait_for(lock, std::chrono::milliseconds(nTimeout));
+			}
+		}
+	};
+
+	// 不析构，线程常驻
+	static FTimerThread& TimerThread()
 	{
-		if (fnRecvCallback) fnRecvCallback(n_pNetNode, n_szData, n_nSize);
-		if (m_TinyCallback) m_TinyCallback->OnReceiveCallback(n_pNetNode, n_szData, n_nSize);
+		static FTimerThread* Timer = new FTimerThread;
+		return *Timer;
 	}
-
 #pragma endregion
 
 	////////////////////////////////////////////////////////////////////////////////
-#pragma region 服务端
-#if defined(_WIN32) || defined(_WIN64)
-	struct FNetHandle
+#pragma region 事件消息
+	struct FHeart
 	{
-		WSAOVERLAPPED	Overlapped = { 0 };
-		WSABUF			DataBuf = { 0 };
-		FNetNode* NetNode = nullptr;
-		char* Buffer = nullptr;
+		// 发送者，系统维护
+		unsigned int Sender = 0;
+		// 序号，若心跳返回，则序号会递增
+		unsigned int No = 0;
+		// 失败次数，更新序号时需重置
+		unsigned int Cnt = 0;
 	};
+#pragma endregion
 
-	struct FIOCPNetNode : public FNetNode
+	////////////////////////////////////////////////////////////////////////////////
+#pragma region 节点
+	void FNetNode::Init(const ENetType n_eType,
+		const std::string& n_sHost, const unsigned short n_nPort)
 	{
-		FNetHandle* Handle;
-	};
-#else
-	static int EPOLL_SIZE = 4096;
-#endif
+		eNetType = n_eType;
+		memset(Addr, 0, sizeof(stSockaddrIn));
+		BuildSockAddrIn(&Addr, n_sHost, n_nPort);
+	}
 
-	CTinyServer::CTinyServer()
+	void FNetNode::Init(const ENetType n_eType, const stSockaddrIn* n_Addr)
 	{
+		eNetType = n_eType;
+		if (n_Addr) memcpy(Addr, n_Addr, sizeof(stSockaddrIn));
+		else memset(Addr, 0, sizeof(stSockaddrIn));
 	}
 
-	CTinyServer::~CTinyServer()
+	const unsigned short FNetNode::Port()
 	{
-		Stop();
+		return SockaddrToPort(Addr);
 	}
 
-	bool CTinyServer::Start()
+	const std::string FNetNode::Ip()
 	{
-		if (IsValid()) return false;
-
-		return InitSock();
+		return SockaddrToIp(Addr);
 	}
 
-#if defined(_WIN32) || defined(_WIN64)
-	void CTinyServer::Stop()
+	int FNetNode::Send(const char* n_szData, const int n_nSize) const
 	{
-		if (!m_hIocp) return;
-		ITinyNet::Stop();
-
-		// 退出所有工作线程
-		auto nNum = GetCpuNum() * 2;
-		for (unsigned int i = 0; i < nNum; i++)
-			PostQueuedCompletionStatus(m_hIocp, 0, 0, 0);
+		int nResult = 0;
 
-		for (unsigned int i = 0; i < nNum; i++)
-			m_threads[i].join();
+		if (!IsValid() || !n_szData || n_nSize <= 0) return nResult;
 
-		delete[] m_threads;
-		m_threads = nullptr;
+		FNetIoVec IoVec;
+		IoVec.Data = n_szData;
+		IoVec.nSize = n_nSize;
 
-		m_bRun = false;
-		// 关闭Socket
-		CloseSocket(fd);
-		// 释放所有为客户端分配的内存
-		FreeSocketNodes();
-		// 关闭完成端口
-		CloseHandle(m_hIocp);
-		m_hIocp = nullptr;
+		return Send(&IoVec, 1);
+	}
 
-		OnEventCallback(this, ENetEvent::Quit, "");
+	int FNetNode::Send(const std::string& n_sData) const
+	{
+		return Send(n_sData.c_str(), (int)n_sData.size());
 	}
-#else
-	void CTinyServer::Stop()
+
+	int FNetNode::Send(const FNetBuffer& n_Buffer) const
 	{
-		if (!IsValid()) return;
-		ITinyNet::Stop();
+		int nResult = 0;
 
-		m_bRun = false;
-		FreeSocketNodes();
+		if (!IsValid() || !n_Buffer.Buffer || !n_Buffer.nLength)
+			return nResult;
 
-		CloseSocket(fd);
-		close(m_nEpfd);
-		m_nEpfd = 0;
+		if (eNetType == ENetType::TCP)
+		{
+#if !defined(_WIN32) && !defined(_WIN64)
+			if (SendQueue)
+				return CountSent(this, QueueSend(SendQueue, n_Buffer.Buffer, (int)n_Buffer.nLength), n_Buffer.nLength);
+#endif
+			nResult = SendStream(this, n_Buffer.Buffer, (int)n_Buffer.nLength);
+		}
+		else if (eNetType == ENetType::UDP)
+		{
+			nResult = sendto(fd, n_Buffer.Buffer, (int)n_Buffer.nLength, 0,
+				(stSockaddr*)Addr, sizeof(stSockaddr));
+		}
 
-		OnEventCallback(this, ENetEvent::Quit, "");
+		return CountSent(this, nResult, n_Buffer.nLength);
 	}
-#endif
 
-	const std::list<FNetNode*>& CTinyServer::GetClients()
+	int FNetNode::Send(const FNetIoVec* n_pIoVec, const int n_nCount) const
 	{
-		return m_lstNodes;
+		if (!IsValid() || !n_pIoVec || n_nCount <= 0) return 0;
+		if (eNetType != ENetType::TCP && eNetType != ENetType::UDP) return 0;
+
+		return SendFrameV(this, Addr, n_pIoVec, n_nCount);
 	}
 
-#if defined(_WIN32) || defined(_WIN64)
-	bool CTinyServer::InitSock()
+	int FNetNode::SendBatch(const FNetIoVec* n_pMessages, const int n_nCount) const
 	{
-		int nSockType = NetType2SockType(eNetType);
-		if (nSockType == 0) return false;
+		if (!IsValid() || !n_pMessages || n_nCount <= 0) return 0;
 
-		do
+		if (eNetType == ENetType::UDP)
 		{
-			m_bRun = false;
+			auto nSent = SendDatagrams(fd, Addr, n_pMessages, n_nCount, true, bUdpGso);
 
-			fd = WSASocketW(AF_INET, nSockType, 0, NULL, 0, WSA_FLAG_OVERLAPPED);
-			if (fd == SOCKET_ERROR)
-			{
-				DebugLog("创建 Socket 失败\n");
-				break;
-			}
+			size_t nBytes = 0;
+			for (int i = 0; i < nSent; i++) nBytes += n_pMessages[i].nSize + sizeof(FHeader);
+			return CountSent(this, nSent, nBytes, nSent);
+		}
 
-			SetSocketTTL(fd, IP_TTL, (unsigned char)m_nTTL);
-			SetSocketSendTimeout(fd, m_nTimeout);
-			SetSocketRecvTimeout(fd, m_nTimeout);
-			SetSocketReuseAddr(fd, 1);
+		if (eNetType != ENetType::TCP) return 0;
 
-			auto nResult = bind(fd, (stSockaddr*)Addr, sizeof(stSockaddr));
-			if (nResult == SOCKET_ERROR)
-			{
-				DebugLog("绑定 Socket 失败\n");
-				break;
-			}
+		// TCP 为字节流，依次发送
+		for (int i = 0; i < n_nCount; i++)
+		{
+			if (SendFrameV(this, Addr, &n_pMessages[i], 1) == SOCKET_ERROR)
+				return i > 0 ? i : SOCKET_ERROR;
+		}
 
-			if (eNetType == ENetType::TCP)
-			{
-				nResult = listen(fd, SOMAXCONN);
-				if (nResult == SOCKET_ERROR)
-				{
-					DebugLog("监听 Socket 失败\n");
-					break;
-				}
-			}
+		return n_nCount;
+	}
 
-			if (!CreateWorkerThread()) break;
+	int FNetNode::Send(const char* n_szData, const int n_nSize,
+		const std::string& n_sHost, const unsigned short n_nPort) const
+	{
+		if (!IsValid() || !n_szData || n_nSize <= 0 || eNetType == ENetType::TCP) return 0;
 
-			m_hIocp = CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 0);
-			if (!m_hIocp)
-			{
-				DebugLog("创建完成端口失败\n");
-				break;
-			}
+		stSockaddrIn OtherAddr = { 0 };
+		BuildSockAddrIn(&OtherAddr, n_sHost, n_nPort);
 
-			if (eNetType == ENetType::TCP)
-			{
-				std::thread(&CTinyServer::Accept, this).detach();
-			}
-			else if (eNetType == ENetType::UDP)
-			{
-				auto UdpHandle = (FIOCPNetNode*)AllocSocketNode(fd, nullptr);
-				CreateIoCompletionPort(
-					(HANDLE)fd, m_hIocp, (ULONG_PTR)UdpHandle, 0
-				);
-				PostRecv(UdpHandle);
-			}
+		FNetIoVec IoVec;
+		IoVec.Data = n_szData;
+		IoVec.nSize = n_nSize;
 
-			OnEventCallback(this, ENetEvent::Ready, "");
+		return SendFrameV(this, &OtherAddr, &IoVec, 1);
+	}
 
-			m_bRun = true;
+	int FNetNode::Send(const std::string& n_sData,
+		const std::string& n_sHost, const unsigned short n_nPort) const
+	{
+		return Send(n_sData.c_str(), (int)n_sData.size(), n_sHost, n_nPort);
+	}
 
-		} while (false);
+	int FNetNode::Send(const FNetBuffer& n_Buffer,
+		const std::string& n_sHost, const unsigned short n_nPort) const
+	{
+		if (!n_Buffer.Buffer || !n_Buffer.nLength) return 0;
 
-		if (!m_bRun) CloseSocket(fd);
+		stSockaddrIn OtherAddr = { 0 };
+		BuildSockAddrIn(&OtherAddr, n_sHost, n_nPort);
 
-		return m_bRun;
+		return CountSent(this, sendto(fd, n_Buffer.Buffer, (int)n_Buffer.nLength, 0,
+			(stSockaddr*)&OtherAddr, sizeof(stSockaddr)), n_Buffer.nLength);
+	}
+
+	bool FNetNode::SetWriteWatermark(const size_t n_nHigh, const size_t n_nLow)
+	{
+#if !defined(_WIN32) && !defined(_WIN64)
+		if (!SendQueue) return false;
+
+		bool bNotify = false;
+		{
+			std::unique_lock<std::mutex> lock(SendQueue->Mutex);
+			SendQueue->nHighWater = n_nHigh;
+			SendQueue->nLowWater = std::min(n_nLow, n_nHigh);
+			SendQueue->UpdateWritable();
+			bNotify = SendQueue->WritableChanged();
+		}
+
+		if (bNotify) NotifyWritable(SendQueue);
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	const bool FNetNode::IsWritable() const
+	{
+#if !defined(_WIN32) && !defined(_WIN64)
+		if (!SendQueue) return true;
+
+		std::unique_lock<std::mutex> lock(SendQueue->Mutex);
+		return !SendQueue->bUnwritable;
+#else
+		return true;
+#endif
+	}
+
+	const size_t FNetNode::GetSendPending() const
+	{
+#if !defined(_WIN32) && !defined(_WIN64)
+		if (!SendQueue) return 0;
+
+		std::unique_lock<std::mutex> lock(SendQueue->Mutex);
+		return SendQueue->Pending();
+#else
+		return 0;
+#endif
+	}
+
+	const bool FNetNode::IsValid() const
+	{
+		return fd > 0;
+	}
+
+	const std::string FNetNode::ToString()
+	{
+		char szBuff[64] = { 0 };
+
+#if defined(_WIN32) || defined(_WIN64)
+		int nLen = sprintf_s(szBuff, sizeof(szBuff), "%s %s:%d ",
+#else
+		int nLen = sprintf(szBuff, "%s %s:%d ",
+#endif
+			kNetTypeString[(int)eNetType].data(),
+			Ip().data(),
+			Port()
+		);
+
+		return std::string(szBuff, nLen);
+	}
+
+	bool FNetNode::operator==(const FNetNode& n_NetNode)
+	{
+		return memcmp(Addr, n_NetNode.Addr, 8) == 0;
+	}
+
+	void FNetNode::Clear()
+	{
+		fd = 0;
+		memset(Addr, 0, sizeof(stSockaddrIn));
+	}
+
+	int FNetNode::Hello()
+	{
+		FNetBuffer NetBuffer;
+		NetBuffer.Alloc(0);
+		NetBuffer.SetEventId(kHelloId);
+
+		return Send(NetBuffer);
+	}
+
+	int FNetNode::Heart(unsigned int n_nNo, unsigned int n_nFailCnt)
+	{
+		FHeart Heart;
+		Heart.Sender = (unsigned int)fd;
+		Heart.No = htonl(n_nNo);
+		Heart.Cnt = htonl(n_nFailCnt);
+
+		FNetBuffer NetBuffer;
+		NetBuffer.SetData((const char*)&Heart, sizeof(FHeart));
+		NetBuffer.SetEventId(kHeartId);
+
+		return Send(NetBuffer);
+	}
+
+	int FNetNode::Quit()
+	{
+		if (eNetType != ENetType::UDP) return 0;
+		// TCP 不用通知
+		FNetBuffer NetBuffer;
+		NetBuffer.Alloc(0);
+		NetBuffer.SetEventId(kQuitId);
+
+		return Send(NetBuffer);
+	}
+#pragma endregion
+
+	////////////////////////////////////////////////////////////////////////////////
+#pragma region 网络接口
+#if defined(_WIN32) || defined(_WIN64)
+	int ITinyImpl::m_nRef = 0;
+#endif
+
+	ITinyImpl::ITinyImpl()
+	{
+		Startup();
+	}
+
+	ITinyImpl::~ITinyImpl()
+	{
+		Cleanup();
+	}
+
+	void ITinyImpl::SetRecvBuffSize(const int n_nSize)
+	{
+		m_nBuffSize = n_nSize;
+	}
+
+	void ITinyImpl::SetRecvBatch(const unsigned int n_nCount)
+	{
+		m_nRecvBatch = RecvBatchSize(n_nCount);
+	}
+
+	void ITinyImpl::SetUdpOffload(const bool n_bEnable)
+	{
+		m_bUdpOffload = n_bEnable;
+	}
+
+	const int ITinyImpl::DatagramBuffSize() const
+	{
+#if !defined(_WIN32) && !defined(_WIN64)
+		// GRO 合并的数据需完整接收
+		if (m_bUdpOffload) return std::max(m_nBuffSize, kMaxGroSize);
+#endif
+		return m_nBuffSize;
+	}
+
+	void ITinyImpl::SetTinyCallback(ITinyCallback* n_TinyCallback)
+	{
+		m_TinyCallback = n_TinyCallback;
+	}
+
+	FNetStats ITinyImpl::GetStats() const
+	{
+		return m_Counters.Snapshot();
+	}
+
+	void ITinyImpl::ResetStats()
+	{
+		m_Counters.Reset();
+	}
+
+	void ITinyImpl::Startup()
+	{
+#if defined(_WIN32) || defined(_WIN64)
+		if (m_nRef == 0)
+		{
+			WSADATA wsaData;
+			int nResult = WSAStartup(MAKEWORD(2, 2), &wsaData);
+			if (nResult != 0) DebugLog("初始化 Socket 失败\n");
+		}
+
+		m_nRef++;
+#endif
+	}
+
+	void ITinyImpl::Cleanup()
+	{
+#if defined(_WIN32) || defined(_WIN64)
+		m_nRef--;
+
+		if (m_nRef <= 0)
+		{
+			WSACleanup();
+			m_nRef = 0;
+		}
+#endif
+	}
+#pragma endregion
+
+	////////////////////////////////////////////////////////////////////////////////
+#pragma region 组播
+	CMulticast::CMulticast()
+	{
+		m_NetNode.Counters = &m_Counters;
+	}
+
+	CMulticast::~CMulticast()
+	{
+		Release();
+	}
+
+	bool CMulticast::Init(const std::string& n_sHost, const unsigned short n_nPort)
+	{
+		if (m_NetNode.IsValid()) return true;
+
+		m_NetNode.fd = socket(AF_INET, SOCK_DGRAM, 0);
+		if (m_NetNode.fd == SOCKET_ERROR)
+		{
+			DebugLog("create Socket error: %d\n", LastError());
+		}
+		else
+		{
+			BuildSockAddrIn(&m_NetNode.Addr, n_sHost, n_nPort);
+		}
+
+		return m_NetNode.IsValid();
+	}
+
+	int CMulticast::SetTTL(unsigned char n_nTTL)
+	{
+		if (!m_NetNode.IsValid()) return -1;
+		return SetSocketTTL(m_NetNode.fd, IP_MULTICAST_TTL, n_nTTL);
+	}
+
+	int CMulticast::SetBroadcast(bool n_bEnable)
+	{
+		if (!m_NetNode.IsValid()) return -1;
+		return SetSocketBroadcast(m_NetNode.fd, n_bEnable);
+	}
+
+	int CMulticast::Sender()
+	{
+		if (!m_NetNode.IsValid()) return -1;
+		m_NetNode.eNetType = ENetType::UDP;
+		return 0;
+	}
+
+	int CMulticast::Receiver(const std::string& n_sLocalIP)
+	{
+		int nResult = -1;
+		if (!m_NetNode.IsValid()) return nResult;
+
+		do
+		{
+			m_NetNode.eNetType = ENetType::UDP_MULTICAST;
+
+			m_sLocalIp = n_sLocalIP;
+			if (m_sLocalIp.empty()) m_sLocalIp = GetLocalIPAddress();
+
+			stSockaddrIn Addr = { 0 };
+			BuildSockAddrIn(&Addr, m_sLocalIp, m_NetNode.Port());
+
+			nResult = bind(m_NetNode.fd, (stSockaddr*)&Addr, sizeof(stSockaddr));
+			if (nResult == -1)
+			{
+				DebugLog("multicast bind Socket error: %d\n", LastError());
+				break;
+			}
+
+			stIpMreq IpMreq = { 0 };
+			memcpy(&IpMreq.imr_multiaddr,
+				&toSockaddrIn(m_NetNode.Addr)->sin_addr,
+				sizeof(struct in_addr));
+			inet_pton(AF_INET, m_sLocalIp.c_str(), &IpMreq.imr_interface.s_addr);
+
+			if (SetSocketAddMemberShip(m_NetNode.fd, (ValType)&IpMreq) < 0)
+				break;
+
+#if !defined(_WIN32) && !defined(_WIN64)
+			if (m_bUdpOffload) SetSocketUdpGro(m_NetNode.fd);
+#endif
+
+			m_bRun = true;
+			m_thread = std::thread(&CMulticast::MulticastThread, this);
+
+		} while (false);
+
+		return nResult;
+	}
+
+	int CMulticast::Release()
+	{
+		if (!m_NetNode.IsValid()) return -1;
+
+		if (m_NetNode.eNetType == ENetType::UDP_MULTICAST)
+		{
+			stIpMreq IpMreq = { 0 };
+			memcpy(&IpMreq.imr_multiaddr,
+				&toSockaddrIn(m_NetNode.Addr)->sin_addr,
+				sizeof(struct in_addr));
+			inet_pton(AF_INET, m_sLocalIp.c_str(), &IpMreq.imr_interface.s_addr);
+
+			SetSocketDropMemberShip(m_NetNode.fd, (ValType)&IpMreq);
+		}
+
+		// 唤醒阻塞在接收中的线程并等待其退出：Windows 下关闭 Socket 结束 recvfrom，
+		// Linux 下 shutdown 唤醒 recvmmsg，等待退出后再关闭
+		m_bRun = false;
+#if defined(_WIN32) || defined(_WIN64)
+		CloseSocket(m_NetNode.fd);
+#else
+		shutdown(m_NetNode.fd, SHUT_RDWR);
+#endif
+		if (m_thread.joinable())
+		{
+			if (m_thread.get_id() == std::this_thread::get_id()) m_thread.detach();
+			else m_thread.join();
+		}
+
+#if !defined(_WIN32) && !defined(_WIN64)
+		CloseSocket(m_NetNode.fd);
+#endif
+		m_NetNode.Clear();
+
+		return 0;
+	}
+
+	int CMulticast::Send(const char* n_szData, const int n_nSize)
+	{
+		if (m_NetNode.eNetType != ENetType::UDP) return 0;
+		return CountSent(&m_NetNode, sendto(m_NetNode.fd, n_szData, n_nSize, 0,
+				(stSockaddr*)m_NetNode.Addr, sizeof(stSockaddr)), n_nSize > 0 ? n_nSize : 0);
+	}
+
+	int CMulticast::Send(const std::string n_sData)
+	{
+		if (m_NetNode.eNetType != ENetType::UDP) return 0;
+		return Send(n_sData.data(), (int)n_sData.size());
+	}
+
+	int CMulticast::SendBatch(const FNetIoVec* n_pMessages, const int n_nCount)
+	{
+		if (m_NetNode.eNetType != ENetType::UDP || !n_pMessages || n_nCount <= 0) return 0;
+		auto nSent = SendDatagrams(m_NetNode.fd, m_NetNode.Addr, n_pMessages, n_nCount, false, m_bUdpOffload);
+
+		size_t nBytes = 0;
+		for (int i = 0; i < nSent; i++) nBytes += n_pMessages[i].nSize;
+		return CountSent(&m_NetNode, nSent, nBytes, nSent);
+	}
+
+#if defined(_WIN32) || defined(_WIN64)
+	void CMulticast::MulticastThread() const
+	{
+		int nResult = 0;
+
+		size_t nBuffCapacity = 0;
+		char* szBuff = CBufferPool::Alloc(m_nBuffSize, nBuffCapacity);
+		if (!szBuff) return;
+
+		stSockaddrIn	Addr = { 0 };
+		SockaddrLen		nLen = sizeof(stSockaddrIn);
+
+		while (true)
+		{
+			memset(szBuff, 0, m_nBuffSize);
+			nResult = recvfrom(m_NetNode.fd,
+				szBuff, m_nBuffSize, 0, (stSockaddr*)&Addr, &nLen);
+			if (nResult <= 0 || !m_bRun) break;
+
+			if (fnRecvCallback) fnRecvCallback(szBuff, nResult);
+			if (m_TinyCallback) m_TinyCallback->OnReceiveCallback(nullptr, szBuff, nResult);
+		}
+
+		CBufferPool::Free(szBuff, nBuffCapacity);
+	}
+#else
+	void CMulticast::MulticastThread() const
+	{
+		size_t nBuffCapacity = 0;
+		auto nBuffSize = DatagramBuffSize();
+		char* szBuff = CBufferPool::Alloc((size_t)nBuffSize * RecvBatchSize(m_nRecvBatch), nBuffCapacity);
+		if (!szBuff) return;
+
+		FRecvBatch Batch(szBuff, nBuffSize, m_nRecvBatch);
+
+		while (true)
+		{
+			// 阻塞至少接收一个数据报，并取出已到达的其他数据报
+			auto nCount = Batch.Recv(m_NetNode.fd, MSG_WAITFORONE);
+			// shutdown 后返回长度为 0 的数据报，不再返回错误
+			if (nCount <= 0 || !m_bRun) break;
+
+			auto nDrops = Batch.ForEach(nCount, [this](int, const char* n_szData, int n_nSize) {
+				// 回调中调用了 Release
+				if (!m_bRun) return;
+
+				AddStat(&m_NetNode, ENetStat::BytesRecv, n_nSize);
+				AddStat(&m_NetNode, ENetStat::FramesRecv);
+				if (fnRecvCallback) fnRecvCallback(n_szData, n_nSize);
+				if (m_TinyCallback) m_TinyCallback->OnReceiveCallback(nullptr, n_szData, n_nSize);
+			});
+			if (nDrops > 0) AddStat(&m_NetNode, ENetStat::Drops, nDrops);
+		}
+
+		CBufferPool::Free(szBuff, nBuffCapacity);
+	}
+#endif
+#pragma endregion
+
+	////////////////////////////////////////////////////////////////////////////////
+#pragma region Socket基类
+
+	// 节点只在本次回调中有效，回调不交给回调线程
+	static thread_local bool t_bDirectCallback = false;
+
+	// 回调线程中的连接键，连接Id 或节点地址
+	static unsigned long long CallbackKey(const FNetNode* n_pNetNode)
+	{
+		return n_pNetNode->Id ? n_pNetNode->Id : (unsigned long long)(size_t)n_pNetNode;
+	}
+
+	ITinyNet::ITinyNet()
+	{
+		Counters = &m_Counters;
+	}
+
+	ITinyNet::~ITinyNet()
+	{
+		if (m_pExecutor) delete m_pExecutor;
+		if (m_pTrace) delete m_pTrace;
+	}
+
+	bool ITinyNet::Start()
+	{
+		return true;
+	}
+
+	void ITinyNet::Stop()
+	{
+	}
+
+	void ITinyNet::EnableHeart(unsigned int n_nPeriod, unsigned int n_nTimeoutCnt)
+	{
+	}
+
+	void ITinyNet::SetTimeout(int n_nMilliSeconds)
+	{
+		m_nTimeout = n_nMilliSeconds;
+	}
+
+	void ITinyNet::SetTTL(int n_nTTL)
+	{
+		if (n_nTTL > 255) return;
+		m_nTTL = n_nTTL;
+	}
+
+	void ITinyNet::SetIoEngine(const EIoEngine n_eEngine)
+	{
+		m_eIoEngine = n_eEngine;
+	}
+
+	const EIoEngine ITinyNet::GetIoEngine() const
+	{
+		return m_bUring ? EIoEngine::IoUring : EIoEngine::Default;
+	}
+
+	void ITinyNet::EnableLatencyTrace(const bool n_bEnable)
+	{
+		if (m_bRun) return;
+
+		if (n_bEnable && !m_pTrace) m_pTrace = new CLatencyTrace();
+		else if (!n_bEnable && m_pTrace)
+		{
+			delete m_pTrace;
+			m_pTrace = nullptr;
+		}
+	}
+
+	FLatencySummary ITinyNet::GetLatency(const ELatencyStage n_eStage) const
+	{
+		if (!m_pTrace || n_eStage >= ELatencyStage::Count) return FLatencySummary();
+		return m_pTrace->Summary(n_eStage);
+	}
+
+	void ITinyNet::ResetLatency()
+	{
+		if (m_pTrace) m_pTrace->Reset();
+	}
+
+	void ITinyNet::SetCallbackWorkers(const unsigned int n_nWorkers, const unsigned int n_nMaxPending)
+	{
+		if (m_bRun) return;
+
+		m_nCallbackWorkers = n_nWorkers;
+		m_nMaxPending = n_nMaxPending;
+	}
+
+	void ITinyNet::SetWriteWatermark(const size_t n_nHigh, const size_t n_nLow)
+	{
+		m_nHighWater = n_nHigh;
+		m_nLowWater = std::min(n_nLow, n_nHigh);
+	}
+
+	bool ITinyNet::PauseRead(FNetNode* n_pNetNode)
+	{
+		if (!n_pNetNode || n_pNetNode->Id == 0) return false;
+		return PostReadPause(n_pNetNode->Id, kPauseUser, true);
+	}
+
+	bool ITinyNet::ResumeRead(FNetNode* n_pNetNode)
+	{
+		if (!n_pNetNode || n_pNetNode->Id == 0) return false;
+		return PostReadPause(n_pNetNode->Id, kPauseUser, false);
+	}
+
+	bool ITinyNet::Post(const unsigned long long n_nId, std::function<void()> n_fnTask)
+	{
+		if (!m_bRun || n_nId == 0 || !n_fnTask) return false;
+
+		// 回调线程以连接Id 为键
+		if (m_pExecutor) return m_pExecutor->Post(n_nId, std::move(n_fnTask)) > 0;
+		return PostToNode(n_nId, std::move(n_fnTask));
+	}
+
+#if !defined(_WIN32) && !defined(_WIN64)
+	FSendQueue* ITinyNet::CreateSendQueue(FNetNode* n_pNetNode)
+	{
+		auto pQueue = new FSendQueue;
+		pQueue->NetNode = n_pNetNode;
+		pQueue->nHighWater = m_nHighWater;
+		pQueue->nLowWater = m_nLowWater;
+		pQueue->fnWritable = [this](FNetNode* n_pNode, const bool n_bWritable) {
+			OnEventCallback(n_pNode, n_bWritable ? ENetEvent::Writable : ENetEvent::Unwritable, "");
+		};
+
+		return pQueue;
+	}
+#endif
+
+	unsigned long long ITinyNet::AddTimer(const unsigned int n_nDelay,
+		const unsigned int n_nPeriod, std::function<void()> n_fnCallback)
+	{
+		return TimerThread().Schedule(n_nDelay, n_nPeriod, std::move(n_fnCallback));
+	}
+
+	bool ITinyNet::CancelTimer(const unsigned long long n_nId)
+	{
+		if (n_nId == 0) return false;
+		return TimerThread().Cancel(n_nId);
+	}
+
+	int ITinyNet::KeepAlive(const size_t n_nFd) const
+	{
+		if (!IsValid()) return -1;
+		if (eNetType != ENetType::TCP) return 0;
+		return SetSocketKeepAlive(n_nFd, 1);
+	}
+
+	bool ITinyNet::OnEventMessage(FNetNode* n_pNetNode, const char* n_szData, const int n_nSize)
+	{
+		return false;
+	}
+
+	// 从数据头获取数据包总长度(含数据头)
+	static size_t FrameSize(const char* n_szHeader)
+	{
+		auto Header = (const FHeader*)n_szHeader;
+		return (size_t)ntohl(Header->nLength) + sizeof(FHeader);
+	}
+
+	void ITinyNet::ReceiveTcpMessage(FNetNode* n_pNetNode, 
+		std::string& n_sLast, const char* n_szData, const int n_nSize)
+	{
+		if (eNetType != ENetType::TCP) return;
+		if (n_nSize <= 0) return;
+
+		AddStat(n_pNetNode, ENetStat::BytesRecv, n_nSize);
+		if (m_pTrace) t_RecvStamp.nDequeue = TraceNow();
+
+		const char* pData = n_szData;
+		size_t nRemain = (size_t)n_nSize;
+
+		while (nRemain > 0)
+		{
+			if (!n_sLast.empty())
+			{
+				// 补足数据头
+				if (n_sLast.size() < sizeof(FHeader))
+				{
+					auto nLack = std::min(sizeof(FHeader) - n_sLast.size(), nRemain);
+					n_sLast.append(pData, nLack);
+					pData += nLack;
+					nRemain -= nLack;
+
+					if (n_sLast.size() < sizeof(FHeader)) break;
+
+					auto nSize = FrameSize(n_sLast.data());
+					if (nSize > kMaxTCPBufferSize)
+					{
+						// 长度头异常，丢弃
+						AddStat(n_pNetNode, ENetStat::Oversize);
+						std::string().swap(n_sLast);
+						break;
+					}
+
+					// 数据头完整后一次分配整个数据包
+					n_sLast.reserve(nSize);
+				}
+
+				// 补足数据包
+				auto nSize = FrameSize(n_sLast.data());
+				auto nLack = std::min(nSize - n_sLast.size(), nRemain);
+				n_sLast.append(pData, nLack);
+				pData += nLack;
+				nRemain -= nLack;
+
+				if (n_sLast.size() < nSize) break;
+
+				// 交给回调线程时直接转移缓存
+				DispatchFrame(n_pNetNode, n_sLast.data(), (int)nSize, &n_sLast);
+
+				// 释放大数据包占用的缓存
+				if (n_sLast.capacity() > kKeepCacheSize) std::string().swap(n_sLast);
+				else n_sLast.clear();
+
+				continue;
+			}
+
+			// 数据头不完整，缓存等待后续数据
+			if (nRemain < sizeof(FHeader))
+			{
+				n_sLast.assign(pData, nRemain);
+				break;
+			}
+
+			// 数据包原长度
+			auto nSize = FrameSize(pData);
+			if (nSize > kMaxTCPBufferSize)
+			{
+				// 长度头异常，丢弃
+				AddStat(n_pNetNode, ENetStat::Oversize);
+				break;
+			}
+			else if (nSize > nRemain)
+			{
+				// 数据不足一个完整数据包，仅缓存跨越读取边界的数据包
+				n_sLast.reserve(nSize);
+				n_sLast.assign(pData, nRemain);
+				break;
+			}
+
+			// 完整数据包直接从接收缓存回调
+			DispatchFrame(n_pNetNode, pData, (int)nSize);
+
+			pData += nSize;
+			nRemain -= nSize;
+		}
+
+		// 内核时间戳只属于本次读取
+		t_RecvStamp.nKernel = 0;
+	}
+
+	void ITinyNet::DispatchFrame(FNetNode* n_pNetNode, const char* n_szData, const int n_nSize,
+		std::string* n_pFrame)
+	{
+		AddStat(n_pNetNode, ENetStat::FramesRecv);
+
+		auto pTrace = m_pTrace;
+		long long nStart = pTrace ? TraceDispatch(pTrace) : 0;
+
+		if (!OnEventMessage(n_pNetNode, n_szData, n_nSize))
+		{
+			// 交给回调线程时由其记录回调耗时
+			if (m_pExecutor)
+			{
+				std::string sFrame;
+				if (n_pFrame) sFrame.swap(*n_pFrame);
+				else sFrame.assign(n_szData, n_nSize);
+
+				DeferRecv(n_pNetNode, std::move(sFrame), sizeof(FHeader), n_nSize - (int)sizeof(FHeader), false);
+				return;
+			}
+
+			OnRecvCallback(n_pNetNode, n_szData + sizeof(FHeader), n_nSize - (int)sizeof(FHeader));
+		}
+
+		if (pTrace) pTrace->Record(ELatencyStage::Callback, TraceNow() - nStart);
+	}
+
+	void ITinyNet::ReceiveUdpMessage(FNetNode* n_pNetNode, const char* n_szData, const int n_nSize,
+		const bool n_bDirect)
+	{
+		if (eNetType != ENetType::UDP) return;
+
+		AddStat(n_pNetNode, ENetStat::BytesRecv, n_nSize);
+		if (n_nSize < (int)sizeof(FHeader))
+		{
+			AddStat(n_pNetNode, ENetStat::Drops);
+			t_RecvStamp.nKernel = 0;
+			return;
+		}
+
+		AddStat(n_pNetNode, ENetStat::FramesRecv);
+
+		auto pTrace = m_pTrace;
+		long long nStart = 0;
+		if (pTrace)
+		{
+			t_RecvStamp.nDequeue = TraceNow();
+			nStart = TraceDispatch(pTrace);
+		}
+		t_RecvStamp.nKernel = 0;
+
+		// 事件消息处理中的事件回调同样在本线程执行
+		t_bDirectCallback = n_bDirect;
+		bool bDeferred = false;
+		if (!OnEventMessage(n_pNetNode, n_szData, n_nSize))
+		{
+			FNetBuffer NetBuffer;
+			if (NetBuffer.PointTo(n_szData, n_nSize))
+			{
+				// 交给回调线程时由其记录回调耗时
+				bDeferred = m_pExecutor && !n_bDirect && DeferRecv(n_pNetNode, std::string(n_szData, n_nSize),
+					(size_t)(NetBuffer.GetData() - n_szData), (int)NetBuffer.DataSize(), true);
+				if (!bDeferred) OnRecvCallback(n_pNetNode, NetBuffer.GetData(), NetBuffer.DataSize());
+			}
+		}
+		t_bDirectCallback = false;
+
+		if (pTrace && !bDeferred) pTrace->Record(ELatencyStage::Callback, TraceNow() - nStart);
+	}
+
+	void ITinyNet::OnEventCallback(FNetNode* n_pNetNode,
+		const ENetEvent n_eNetEvent, const std::string& n_sData)
+	{
+		auto fnCallback = [this, n_pNetNode, n_eNetEvent, n_sData]() {
+			if (fnEventCallback) fnEventCallback(n_pNetNode, n_eNetEvent, n_sData);
+			if (m_TinyCallback) m_TinyCallback->OnEventCallback(n_pNetNode, n_eNetEvent, n_sData);
+		};
+
+		// 与该连接的数据回调按顺序执行
+		if (m_pExecutor && !t_bDirectCallback &&
+			m_pExecutor->Post(CallbackKey(n_pNetNode), std::function<void()>(fnCallback)) > 0) return;
+
+		fnCallback();
+	}
+
+	void ITinyNet::OnRecvCallback(FNetNode* n_pNetNode, const char* n_szData, int n_nSize)
+	{
+		if (fnRecvCallback) fnRecvCallback(n_pNetNode, n_szData, n_nSize);
+		if (m_TinyCallback) m_TinyCallback->OnReceiveCallback(n_pNetNode, n_szData, n_nSize);
+	}
+
+	void ITinyNet::StartCallbacks()
+	{
+		if (m_nCallbackWorkers == 0) return;
+
+		if (!m_pExecutor) m_pExecutor = new CSerialExecutor();
+		m_pExecutor->Start(m_nCallbackWorkers, m_nMaxPending,
+			std::bind(&ITinyNet::OnCallbackDrained, this, std::placeholders::_1));
+	}
+
+	void ITinyNet::StopCallbacks()
+	{
+		if (m_pExecutor) m_pExecutor->Stop();
+	}
+
+	bool ITinyNet::DeferRecv(FNetNode* n_pNetNode, std::string&& n_sFrame, const size_t n_nOffset,
+		const int n_nSize, const bool n_bDropFull)
+	{
+		if (!m_pExecutor) return false;
+
+		// C++11 的 lambda 不能转移捕获，以函数对象持有数据包
+		struct FRecvTask
+		{
+			ITinyNet*		pTinyNet;
+			FNetNode*		pNetNode;
+			std::string		sFrame;
+			size_t			nOffset;
+			int				nSize;
+
+			void operator()()
+			{
+				auto pTrace = pTinyNet->m_pTrace;
+				long long nStart = pTrace ? TraceNow() : 0;
+
+				pTinyNet->OnRecvCallback(pNetNode, sFrame.data() + nOffset, nSize);
+
+				if (pTrace) pTrace->Record(ELatencyStage::Callback, TraceNow() - nStart);
+			}
+		};
+
+		FRecvTask Task = { this, n_pNetNode, std::move(n_sFrame), n_nOffset, n_nSize };
+		std::function<void()> fnTask(std::move(Task));
+
+		auto nPending = m_pExecutor->Post(CallbackKey(n_pNetNode), std::move(fnTask),
+			n_bDropFull ? m_nMaxPending : 0);
+
+		// 已停止，在当前线程回调
+		if (nPending == 0) fnTask();
+		else if (nPending < 0) AddStat(n_pNetNode, ENetStat::Drops);
+		else if (!n_bDropFull && m_nMaxPending > 0 && (unsigned int)nPending >= m_nMaxPending)
+			OnCallbackBacklog(n_pNetNode);
+
+		return true;
+	}
+
+	void ITinyNet::RetireNode(FNetNode* n_pNetNode, std::function<void()> n_fnRelease)
+	{
+		if (m_pExecutor && m_pExecutor->Post(CallbackKey(n_pNetNode), std::move(n_fnRelease)) > 0) return;
+		n_fnRelease();
+	}
+
+#pragma endregion
+
+	////////////////////////////////////////////////////////////////////////////////
+#pragma region 服务端
+#if defined(_WIN32) || defined(_WIN64)
+	struct FNetHandle
+	{
+		WSAOVERLAPPED	Overlapped = { 0 };
+		WSABUF			DataBuf = { 0 };
+		FNetNode* NetNode = nullptr;
+		char* Buffer = nullptr;
+	};
+
+	struct FIOCPNetNode : public FNetNode
+	{
+		FNetHandle* Handle;
+	};
+#else
+	static int EPOLL_SIZE = 4096;
+
+	// 按最近活动时间排序的双向循环链表
+	struct FActiveLink
+	{
+		FActiveLink*		pPrev = this;
+		FActiveLink*		pNext = this;
+		// 最近收到数据的时间(毫秒)
+		unsigned long long	nLastActive = 0;
+
+		const bool Empty() const { return pNext == this; }
+
+		void Unlink()
+		{
+			pPrev->pNext = pNext;
+			pNext->pPrev = pPrev;
+			pPrev = pNext = this;
+		}
+
+		void PushBack(FActiveLink* n_pLink)
+		{
+			n_pLink->pPrev = pPrev;
+			n_pLink->pNext = this;
+			pPrev->pNext = n_pLink;
+			pPrev = n_pLink;
+		}
+	};
+
+	struct FReactor
+	{
+		int				nEpfd = 0;
+		// 用于唤醒 epoll_wait
+		int				nWakeFd = 0;
+		std::thread		Thread;
+		// 监听的 Socket 节点, 第一个 Reactor 为服务端自身,
+		// SO_REUSEPORT 模式下每个 Reactor 各有一个
+		FNetNode*		Listener = nullptr;
+		// 所属连接数
+		std::atomic<unsigned int> nConnections;
+
+		// 读取次数达到上限、待下一轮继续读取的连接
+		std::vector<FNetNode*> Pending;
+		// 本轮正在处理的 Pending 连接
+		std::vector<FNetNode*> Ready;
+
+		// 投递到该 Reactor 线程执行的任务
+		std::mutex		Mutex;
+		std::vector<std::function<void()>> Tasks;
+
+		// 定时器，属于 Reactor 线程，由事件等待的超时驱动
+		CTimerWheel*	Timers = nullptr;
+		// 本轮事件循环的时间(毫秒)
+		unsigned long long nNow = 0;
+		// 启用空闲超时时，按最近活动时间排序的连接，表头最早
+		FActiveLink		Active;
+		// UDP 会话，以 SockaddrToInteger 索引；客户端连接池中为所有连接
+		CHashMap<FNetNode*> Peers;
+		// 在 Reactor 线程的回调中调用 Stop 时，由线程退出时释放的连接
+		std::vector<FNetNode*>* Orphans = nullptr;
+		// 服务端在 Reactor 线程的回调中调用 Stop 时为所有 Reactor，由该线程退出时释放
+		FReactor*		Detached = nullptr;
+
+#if defined(TINYNET_IO_URING)
+		// io_uring 模式下替代 epoll
+		CUring*			Ring = nullptr;
+		// 请求提交发送队列的连接Id，受 Mutex 保护
+		std::vector<unsigned long long> Flushes;
+		// 已关闭、等待请求结束后释放的连接
+		std::vector<FNetNode*> Closing;
+		// UDP 多次触发 recvmsg 的消息模板
+		struct msghdr	RecvMsg;
+#endif
+
+		FReactor() : nConnections(0) {}
+	};
+
+	struct FEpollNetNode : public FNetNode, public FActiveLink
+	{
+		// 所属 Reactor，该连接的收发及回调都在其线程执行
+		FReactor*		Reactor = nullptr;
+		// 暂停读取的原因(kPause*)，为0 时正常读取
+		unsigned char	nReadPause = 0;
+#if defined(TINYNET_IO_URING)
+		// 未结束的 io_uring 请求数，为0 时才能释放
+		unsigned int	nRingOps = 0;
+		// 已关闭，等待请求结束
+		bool			bClosed = false;
+		// 多次触发的接收未结束
+		bool			bRecvArmed = false;
+#endif
+	};
+
+	// 更新暂停读取的原因，返回读取状态(暂停或恢复)是否改变，在所属 Reactor 线程调用
+	static bool UpdateReadPause(FNetNode* n_pNetNode, const unsigned char n_nReason, const bool n_bPause)
+	{
+		auto pNetNode = (FEpollNetNode*)n_pNetNode;
+		bool bPaused = pNetNode->nReadPause != 0;
+
+		if (n_bPause) pNetNode->nReadPause |= n_nReason;
+		else pNetNode->nReadPause &= ~n_nReason;
+
+		return bPaused != (pNetNode->nReadPause != 0);
+	}
+
+	static bool IsReadPaused(const FNetNode* n_pNetNode)
+	{
+		return ((const FEpollNetNode*)n_pNetNode)->nReadPause != 0;
+	}
+
+	static void WakeReactor(FReactor* n_pReactor)
+	{
+		uint64_t nValue = 1;
+		if (write(n_pReactor->nWakeFd, &nValue, sizeof(nValue)) == -1)
+			DebugError("wake reactor error");
+	}
+
+	// 投递任务到 Reactor 线程
+	static void PostToReactor(FReactor* n_pReactor, std::function<void()> n_fnTask)
+	{
+		{
+			std::unique_lock<std::mutex> lock(n_pReactor->Mutex);
+			n_pReactor->Tasks.push_back(std::move(n_fnTask));
+		}
+
+		WakeReactor(n_pReactor);
+	}
+
+	// 执行投递的任务，在 Reactor 线程调用
+	static void RunReactorTasks(FReactor* n_pReactor)
+	{
+		uint64_t nValue = 0;
+		while (read(n_pReactor->nWakeFd, &nValue, sizeof(nValue)) > 0);
+
+		std::vector<std::function<void()>> Tasks;
+		{
+			std::unique_lock<std::mutex> lock(n_pReactor->Mutex);
+			Tasks.swap(n_pReactor->Tasks);
+		}
+
+		for (auto& fnTask : Tasks) fnTask();
+	}
+
+	// 收到数据，更新连接的活动时间并移到链表尾部
+	static void TouchNode(FReactor* n_pReactor, FNetNode* n_pNetNode)
+	{
+		auto pNetNode = (FEpollNetNode*)n_pNetNode;
+		pNetNode->nLastActive = n_pReactor->nNow;
+		pNetNode->Unlink();
+		n_pReactor->Active.PushBack(pNetNode);
+	}
+
+	// 关闭 Socket 并释放节点
+	static void ReleaseNode(FNetNode* n_pNetNode)
+	{
+		CloseSocket(n_pNetNode->fd);
+		delete n_pNetNode->SendQueue;
+		delete (FEpollNetNode*)n_pNetNode;
+	}
+
+#if defined(TINYNET_IO_URING)
+	static void RequestFlush(FReactor* n_pReactor, unsigned long long n_nId)
+	{
+		{
+			std::unique_lock<std::mutex> lock(n_pReactor->Mutex);
+			n_pReactor->Flushes.push_back(n_nId);
+		}
+
+		WakeReactor(n_pReactor);
+	}
+#endif
+#endif
+
+	CTinyServer::CTinyServer()
+	{
+	}
+
+	CTinyServer::~CTinyServer()
+	{
+		Stop();
+	}
+
+	bool CTinyServer::Start()
+	{
+		if (IsValid()) return false;
+
+		StartCallbacks();
+		if (InitSock()) return true;
+
+		StopCallbacks();
+		return false;
+	}
+
+#if defined(_WIN32) || defined(_WIN64)
+	void CTinyServer::Stop()
+	{
+		if (!m_hIocp) return;
+		ITinyNet::Stop();
+
+		// 退出所有工作线程
+		auto nNum = GetCpuNum() * 2;
+		for (unsigned int i = 0; i < nNum; i++)
+			PostQueuedCompletionStatus(m_hIocp, 0, 0, 0);
+
+		for (unsigned int i = 0; i < nNum; i++)
+			m_threads[i].join();
+
+		delete[] m_threads;
+		m_threads = nullptr;
+
+		m_bRun = false;
+		// 执行完已投递的回调后释放连接
+		StopCallbacks();
+		// 关闭Socket
+		CloseSocket(fd);
+		// 释放所有为客户端分配的内存
+		FreeSocketNodes();
+		// 关闭完成端口
+		CloseHandle(m_hIocp);
+		m_hIocp = nullptr;
+
+		OnEventCallback(this, ENetEvent::Quit, "");
+	}
+#else
+	void CTinyServer::Stop()
+	{
+		if (!IsValid()) return;
+		ITinyNet::Stop();
+
+		m_bRun = false;
+		// 执行完已投递的回调，再退出所有 Reactor 线程，最后释放连接
+		StopCallbacks();
+		FreeReactors();
+		FreeSocketNodes();
+
+		CloseSocket(fd);
+
+		OnEventCallback(this, ENetEvent::Quit, "");
+	}
+#endif
+
+	std::vector<FNetNode*> CTinyServer::GetClients()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		return m_Nodes.Values();
+	}
+
+	FNetNode* CTinyServer::GetClient(const unsigned long long n_nId)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		auto ppNetNode = m_Nodes.Find(n_nId);
+		return ppNetNode ? *ppNetNode : nullptr;
+	}
+
+	const size_t CTinyServer::GetClientCount()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		return m_Nodes.Size();
+	}
+
+	int CTinyServer::Broadcast(const std::string& n_sData,
+		const std::function<bool(FNetNode*)>& n_fnFilter)
+	{
+		return Broadcast(n_sData.c_str(), (int)n_sData.size(), n_fnFilter);
+	}
+
+	std::vector<unsigned long long> CTinyServer::FilterClients(const std::function<bool(FNetNode*)>& n_fnFilter)
+	{
+		std::vector<std::pair<unsigned long long, FNetNode*>> vecNodes;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+
+			vecNodes.reserve(m_Nodes.Size());
+			for (auto Node : m_Nodes) vecNodes.emplace_back(Node->Id, Node);
+		}
+
+		std::vector<unsigned long long> vecIds;
+		vecIds.reserve(vecNodes.size());
+		for (auto& Node : vecNodes)
+		{
+			if (n_fnFilter(Node.second)) vecIds.push_back(Node.first);
+		}
+
+		return vecIds;
+	}
+
+#if defined(_WIN32) || defined(_WIN64)
+	int CTinyServer::Broadcast(const char* n_szData, const int n_nSize,
+		const std::function<bool(FNetNode*)>& n_fnFilter)
+	{
+		if (!IsValid() || eNetType != ENetType::TCP || !n_szData || n_nSize <= 0) return 0;
+
+		// 只编码一次
+		FNetBuffer NetBuffer(n_szData, n_nSize);
+
+		std::vector<unsigned long long> vecIds;
+		if (n_fnFilter) vecIds = FilterClients(n_fnFilter);
+
+		int nCount = 0;
+		auto fnSend = [&](FNetNode* n_pNetNode) {
+			// 单个连接发送失败不影响其他连接，由工作线程检测断开
+			CountSent(n_pNetNode, SendStream(n_pNetNode, NetBuffer.Buffer, (int)NetBuffer.nLength), NetBuffer.nLength);
+			nCount++;
+		};
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		if (!n_fnFilter)
+		{
+			for (auto Node : m_Nodes) fnSend(Node);
+		}
+		else
+		{
+			// 筛选期间已断开的连接不再发送
+			for (auto nId : vecIds)
+			{
+				auto ppNetNode = m_Nodes.Find(nId);
+				if (ppNetNode) fnSend(*ppNetNode);
+			}
+		}
+
+		return nCount;
+	}
+#else
+	int CTinyServer::Broadcast(const char* n_szData, const int n_nSize,
+		const std::function<bool(FNetNode*)>& n_fnFilter)
+	{
+		if (!IsValid() || eNetType != ENetType::TCP || !n_szData || n_nSize <= 0) return 0;
+		if (!m_pReactors) return 0;
+
+		// 只编码一次，所有连接的发送队列引用同一份数据
+		std::shared_ptr<const FNetBuffer> Frame =
+			std::make_shared<FNetBuffer>(n_szData, (size_t)n_nSize);
+		if (!Frame->Buffer) return 0;
+
+		std::vector<unsigned long long> vecIds;
+		if (n_fnFilter) vecIds = FilterClients(n_fnFilter);
+
+		// 按所属 Reactor 分组需要发送的连接
+		std::vector<std::vector<unsigned long long>> vecFlush(m_nReactorCnt);
+
+		int nCount = 0;
+		auto fnQueue = [&](FNetNode* n_pNetNode) {
+			auto pNetNode = (FEpollNetNode*)n_pNetNode;
+			if (!pNetNode->SendQueue || !pNetNode->Reactor) return;
+
+			// 队列原本有数据时已在等待可写，无需通知
+			if (QueueShared(pNetNode->SendQueue, Frame))
+				vecFlush[pNetNode->Reactor - m_pReactors].push_back(pNetNode->Id);
+			CountSent(pNetNode, 0, Frame->nLength);
+			nCount++;
+		};
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+
+			if (!n_fnFilter)
+			{
+				for (auto Node : m_Nodes) fnQueue(Node);
+			}
+			else
+			{
+				// 筛选期间已断开的连接不再发送
+				for (auto nId : vecIds)
+				{
+					auto ppNetNode = m_Nodes.Find(nId);
+					if (ppNetNode) fnQueue(*ppNetNode);
+				}
+			}
+		}
+
+		// 每个 Reactor 只唤醒一次
+		for (unsigned int i = 0; i < m_nReactorCnt; i++)
+		{
+			if (vecFlush[i].empty()) continue;
+
+			PostToReactor(&m_pReactors[i], std::bind(
+				&CTinyServer::FlushSocketNodes, this, std::move(vecFlush[i])));
+		}
+
+		return nCount;
+	}
+#endif
+
+#if defined(_WIN32) || defined(_WIN64)
+	bool CTinyServer::InitSock()
+	{
+		int nSockType = NetType2SockType(eNetType);
+		if (nSockType == 0) return false;
+
+		do
+		{
+			m_bRun = false;
+
+			fd = WSASocketW(AF_INET, nSockType, 0, NULL, 0, WSA_FLAG_OVERLAPPED);
+			if (fd == SOCKET_ERROR)
+			{
+				DebugLog("创建 Socket 失败\n");
+				break;
+			}
+
+			SetSocketTTL(fd, IP_TTL, (unsigned char)m_nTTL);
+			SetSocketSendTimeout(fd, m_nTimeout);
+			SetSocketRecvTimeout(fd, m_nTimeout);
+			SetSocketReuseAddr(fd, 1);
+
+			auto nResult = bind(fd, (stSockaddr*)Addr, sizeof(stSockaddr));
+			if (nResult == SOCKET_ERROR)
+			{
+				DebugLog("绑定 Socket 失败\n");
+				break;
+			}
+
+			if (eNetType == ENetType::TCP)
+			{
+				nResult = listen(fd, SOMAXCONN);
+				if (nResult == SOCKET_ERROR)
+				{
+					DebugLog("监听 Socket 失败\n");
+					break;
+				}
+			}
+
+			if (!CreateWorkerThread()) break;
+
+			m_hIocp = CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 0);
+			if (!m_hIocp)
+			{
+				DebugLog("创建完成端口失败\n");
+				break;
+			}
+
+			if (eNetType == ENetType::TCP)
+			{
+				std::thread(&CTinyServer::Accept, this).detach();
+			}
+			else if (eNetType == ENetType::UDP)
+			{
+				auto UdpHandle = (FIOCPNetNode*)AllocSocketNode(fd, nullptr);
+				CreateIoCompletionPort(
+					(HANDLE)fd, m_hIocp, (ULONG_PTR)UdpHandle, 0
+				);
+				PostRecv(UdpHandle);
+			}
+
+			OnEventCallback(this, ENetEvent::Ready, "");
+
+			m_bRun = true;
+
+		} while (false);
+
+		if (!m_bRun) CloseSocket(fd);
+
+		return m_bRun;
 	}
 
 	void CTinyServer::Accept()
 	{
-		int				nResult = 0;
+		int				nResult = 0;
+
+		SOCKET			ClientSocket = -1;
+		stSockaddrIn	ClientAddr = { 0 };
+		SockaddrLen		AddrLen = sizeof(stSockaddrIn);
+
+		while (true)
+		{
+			ClientSocket = WSAAccept(
+				fd, (stSockaddr*)&ClientAddr, &AddrLen, NULL, NULL
+			);
+
+			if (ClientSocket == SOCKET_ERROR)
+			{
+				if (m_bRun) DebugLog("Accept 错误: %d\n", LastError());
+				break;
+			}
+
+			auto TcpHandle = (FIOCPNetNode*)AllocSocketNode(ClientSocket, &ClientAddr);
+			if (!TcpHandle) continue;
+
+			KeepAlive(ClientSocket);
+			OnEventCallback(TcpHandle, ENetEvent::Accept, "");
+
+			CreateIoCompletionPort(
+				(HANDLE)ClientSocket, m_hIocp, (ULONG_PTR)TcpHandle, 0
+			);
+
+			nResult = PostRecv(TcpHandle);
+
+			if (nResult == SOCKET_ERROR && LastError() != WSA_IO_PENDING)
+			{
+				DebugLog("IO Pending 错误 : %d", LastError());
+				break;
+			}
+		}
+	}
+
+	bool CTinyServer::CreateWorkerThread()
+	{
+		auto nNum = GetCpuNum() * 2;
+		m_threads = new std::thread[nNum];
+
+		for (unsigned int i = 0; i < nNum; i++)
+		{
+			m_threads[i] = std::thread(&CTinyServer::WorkerThread, this);
+		}
+
+		return true;
+	}
+
+	void CTinyServer::WorkerThread()
+	{
+		BOOL	bResult = FALSE;
+		int		nResult = 0;
+		DWORD	nRecvBytes = 0;
+
+		FIOCPNetNode* 	pCompletionKey = nullptr;
+		FNetHandle* 	pSocketInfo = nullptr;
+
+		while (true)
+		{
+			bResult = GetQueuedCompletionStatus(m_hIocp,
+				&nRecvBytes,
+				(PULONG_PTR)&pCompletionKey,		// completion key
+				(LPOVERLAPPED*)&pSocketInfo,		// overlapped I/O
+				INFINITE
+			);
+
+			if (!pCompletionKey || !pSocketInfo) break;
+
+			pSocketInfo->DataBuf.len = nRecvBytes;
+
+			if (!bResult || nRecvBytes == 0)
+			{
+				if (eNetType == ENetType::TCP) FreeSocketNode(&pSocketInfo->NetNode);
+				continue;
+			}
+			else
+			{
+				ReceiveTcpMessage(pSocketInfo->NetNode, 
+					pSocketInfo->NetNode->sCache, pSocketInfo->Buffer, nRecvBytes);
+				ReceiveUdpMessage(pSocketInfo->NetNode, pSocketInfo->Buffer, nRecvBytes);
+
+				memset(&(pSocketInfo->Overlapped), 0, sizeof(OVERLAPPED));
+				pSocketInfo->DataBuf.len = m_nBuffSize;
+				pSocketInfo->DataBuf.buf = pSocketInfo->Buffer;
+				memset(pSocketInfo->Buffer, 0, m_nBuffSize);
+
+				nResult = PostRecv(pSocketInfo->NetNode);
+
+				if (nResult == SOCKET_ERROR && LastError() != WSA_IO_PENDING)
+				{
+					DebugLog("WSARecv 错误 : %d", LastError());
+				}
+			}
+		}
+	}
+
+	int CTinyServer::PostRecv(FNetNode* n_pNetNode)
+	{
+		int	nResult = 0;
+		if (!n_pNetNode) return nResult;
+
+		auto pNetNode = (FIOCPNetNode*)n_pNetNode;
+		if (!pNetNode->Handle) return nResult;
+
+		DWORD	dwFlags = 0;
+		DWORD	nRecvBytes = 0;
+
+		if (eNetType == ENetType::TCP)
+		{
+			nResult = WSARecv(
+				pNetNode->fd,
+				&pNetNode->Handle->DataBuf,
+				1,
+				(LPDWORD)&nRecvBytes,
+				&dwFlags,
+				&(pNetNode->Handle->Overlapped),
+				nullptr
+			);
+		}
+		else if (eNetType == ENetType::UDP)
+		{
+			SockaddrLen nLen = sizeof(stSockaddrIn);
+			nResult = WSARecvFrom(
+				pNetNode->fd,
+				&pNetNode->Handle->DataBuf,
+				1,
+				(LPDWORD)&nRecvBytes,
+				&dwFlags,
+				(stSockaddr*)pNetNode->Addr,
+				&nLen,
+				&(pNetNode->Handle->Overlapped),
+				nullptr
+			);
+		}
+
+		return nResult;
+	}
+
+	void* CTinyServer::AllocSocketNode(size_t n_fd, const stSockaddrIn* n_Addr)
+	{
+		auto NetNode = new FIOCPNetNode;
+		if (!NetNode) return nullptr;
+		NetNode->Counters = Counters;
+
+		NetNode->Handle = (FNetHandle*)malloc(sizeof(FNetHandle));
+		if (!NetNode->Handle)
+		{
+			delete NetNode;
+			return nullptr;
+		}
+
+		NetNode->Handle->NetNode = NetNode;
+
+		NetNode->fd = n_fd;
+		NetNode->Init(eNetType, n_Addr);
+		NetNode->UserData = nullptr;
+		memset(&(NetNode->Handle->Overlapped), 0, sizeof(OVERLAPPED));
+
+		// 分配接收数据缓存
+		NetNode->Handle->Buffer = (char*)malloc(m_nBuffSize);
+		if (NetNode->Handle->Buffer) memset(NetNode->Handle->Buffer, 0, m_nBuffSize);
+		NetNode->Handle->DataBuf.len = m_nBuffSize;
+		NetNode->Handle->DataBuf.buf = NetNode->Handle->Buffer;
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		NetNode->Id = m_Nodes.Insert(NetNode);
+
+		return NetNode;
+	}
+
+	void CTinyServer::FreeSocketNode(FNetNode** n_pNetNode)
+	{
+		if (!n_pNetNode || !*n_pNetNode) return;
+
+		auto pNetNode = (FIOCPNetNode*)(*n_pNetNode);
+		if (!pNetNode->Handle) return;
+
+		// 抛出退出事件
+		OnEventCallback(*n_pNetNode, ENetEvent::Quit, "");
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_Nodes.Erase((*n_pNetNode)->Id);
+		}
+
+		// 启用回调线程时在该连接的回调执行后释放
+		RetireNode(pNetNode, [pNetNode]() {
+			CloseSocket(pNetNode->fd);
+			free(pNetNode->Handle->Buffer);
+			free(pNetNode->Handle);
+			delete pNetNode;
+		});
+		*n_pNetNode = nullptr;
+	}
+
+	void CTinyServer::FreeSocketNodes()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		for (auto Node : m_Nodes)
+		{
+			auto pNetNode = (FIOCPNetNode*)Node;
+
+			CloseSocket(pNetNode->fd);
+			free(pNetNode->Handle->Buffer);
+			free(pNetNode->Handle);
+			delete pNetNode;
+		}
+
+		m_Nodes.Clear();
+	}
+#else
+
+	bool CTinyServer::BindSocket(size_t& n_nFd)
+	{
+		n_nFd = socket(AF_INET, NetType2SockType(eNetType), 0);
+		if (n_nFd == (size_t)-1)
+		{
+			n_nFd = 0;
+			DebugError("create Socket error");
+			return false;
+		}
+
+		SetSocketTTL(n_nFd, IP_TTL, (unsigned char)m_nTTL);
+		SetSocketSendTimeout(n_nFd, m_nTimeout);
+		SetSocketRecvTimeout(n_nFd, m_nTimeout);
+		SetSocketReuseAddr(n_nFd, 1);
+		if (m_bReusePort && SetSocketReusePort(n_nFd, 1) == -1) return false;
+		if (m_bUdpOffload && eNetType == ENetType::UDP) SetSocketUdpGro(n_nFd);
+		if (m_pTrace && eNetType == ENetType::UDP) SetSocketTimestamping(n_nFd, false);
+
+		auto nResult = bind(n_nFd, (stSockaddr*)Addr, sizeof(stSockaddr));
+		if (nResult == -1)
+		{
+			DebugError("bind Socket error");
+			return false;
+		}
+
+		if (eNetType == ENetType::TCP)
+		{
+			nResult = listen(n_nFd, SOMAXCONN);
+			if (nResult == -1)
+			{
+				DebugError("listen Socket error");
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	bool CTinyServer::InitSock()
+	{
+		int nSockType = NetType2SockType(eNetType);
+		if (nSockType == 0) return false;
+
+		do
+		{
+			m_bRun = false;
+
+			if (!BindSocket(fd)) break;
+			bUdpGso = m_bUdpOffload && eNetType == ENetType::UDP;
+
+			// 非 SO_REUSEPORT 模式下 UDP 只有一个 Socket，只需一个 Reactor
+			m_nReactorCnt = m_nReactorNum > 0 ? m_nReactorNum : GetCpuNum();
+			if (m_nReactorCnt == 0 || (eNetType != ENetType::TCP && !m_bReusePort))
+				m_nReactorCnt = 1;
+
+			m_pReactors = new FReactor[m_nReactorCnt];
+
+			m_bUring = false;
+#if defined(TINYNET_IO_URING)
+			m_bUring = m_eIoEngine == EIoEngine::IoUring;
+#endif
+
+			unsigned int i = 0;
+			for (; i < m_nReactorCnt; i++)
+			{
+				auto pReactor = &m_pReactors[i];
+
+				pReactor->nWakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+				if (pReactor->nWakeFd == -1)
+				{
+					DebugError("create eventfd error");
+					break;
+				}
+
+#if defined(TINYNET_IO_URING)
+				// 内核不支持时使用 epoll
+				if (m_bUring && !CreateRing(pReactor))
+				{
+					if (i > 0) break;
+					m_bUring = false;
+					DebugLog("io_uring not available, use epoll\n");
+				}
+#endif
+
+				if (!m_bUring)
+				{
+					pReactor->nEpfd = epoll_create1(EPOLL_CLOEXEC);
+					if (pReactor->nEpfd == -1)
+					{
+						DebugError("create EPoll error");
+						break;
+					}
+
+					// 唤醒事件，data.ptr 为空
+					struct epoll_event ev;
+					ev.data.ptr = nullptr;
+					ev.events = EPOLLIN;
+					if (epoll_ctl(pReactor->nEpfd, EPOLL_CTL_ADD, pReactor->nWakeFd, &ev) == -1)
+					{
+						DebugError("Add EPoll eventl error");
+						break;
+					}
+				}
+
+				// 第一个 Reactor 使用服务端 Socket 监听，
+				// SO_REUSEPORT 模式下其余 Reactor 各自绑定同一地址
+				if (i == 0) pReactor->Listener = this;
+				else if (m_bReusePort)
+				{
+					auto pListener = new FEpollNetNode;
+					pListener->Init(eNetType, (const stSockaddrIn*)Addr);
+					pListener->Reactor = pReactor;
+					pListener->bUdpGso = m_bUdpOffload;
+					pListener->Counters = Counters;
+					pReactor->Listener = pListener;
+
+					if (!BindSocket(pListener->fd)) break;
+				}
+
+				/** 添加Epoll事件, io_uring 模式下由 Reactor 线程提交. */
+				if (!m_bUring && pReactor->Listener &&
+					AddSocketIntoPoll(pReactor->Listener, pReactor) == -1)
+				{
+					DebugError("Add EPoll eventl error");
+					break;
+				}
+			}
+			if (i < m_nReactorCnt) break;
+
+			// 按接收数据的CPU选择 Socket, 需在所有 Socket 绑定后设置
+			if (m_bReusePort && m_bCpuSteering && m_nReactorCnt > 1)
+				SetSocketReusePortCpu(fd, m_nReactorCnt);
+
+			m_bRun = true;
+
+			for (i = 0; i < m_nReactorCnt; i++)
+			{
+				m_pReactors[i].Thread = std::thread(
+					&CTinyServer::WorkerThread, this, &m_pReactors[i]);
+
+				if (m_bReusePort && m_bCpuSteering)
+					SetThreadAffinity(m_pReactors[i].Thread, i);
+			}
+
+			OnEventCallback(this, ENetEvent::Ready, "");
+
+		} while (false);
+
+		if (!m_bRun)
+		{
+			FreeReactors();
+			CloseSocket(fd);
+		}
+
+		return m_bRun;
+	}
+
+	void CTinyServer::WorkerThread(FReactor* n_pReactor)
+	{
+		if (!n_pReactor) return;
+
+		// 在回调中调用 Stop 时，Reactor 及所有连接交给该线程，退出时释放；定时器由线程持有
+		CTimerWheel Timers;
+		n_pReactor->Timers = &Timers;
+		n_pReactor->nNow = CTimerWheel::Now();
+		std::vector<FNetNode*> Orphans;
+		n_pReactor->Orphans = &Orphans;
+
+		// 定期关闭空闲连接，检查间隔为超时的 1/4
+		if (m_nIdleTimeout > 0)
+		{
+			auto nPeriod = std::min(std::max(m_nIdleTimeout / 4, 10u), 1000u);
+			Timers.Schedule(nPeriod, nPeriod, std::bind(&CTinyServer::ReapIdleNodes, this, n_pReactor));
+		}
+#if defined(TINYNET_IO_URING)
+		if (m_bUring)
+		{
+			RingWorkerThread(n_pReactor);
+			ReleaseOrphans(n_pReactor);
+			return;
+		}
+#endif
+
+		struct epoll_event	Event[EPOLL_SIZE];
+
+		// UDP 批量接收，每个数据报占用一段缓存
+		size_t nBuffSize = m_nBuffSize;
+		if (eNetType == ENetType::UDP) nBuffSize = (size_t)DatagramBuffSize() * RecvBatchSize(m_nRecvBatch);
+
+		size_t nBuffCapacity = 0;
+		char* szBuff = CBufferPool::Alloc(nBuffSize, nBuffCapacity);
+		if (!szBuff)
+		{
+			ReleaseOrphans(n_pReactor);
+			return;
+		}
+		memset(szBuff, 0, nBuffSize);
+
+		while (m_bRun)
+		{
+			// 仍有未读完的连接时不等待，否则等待到下一个定时器到期
+			int nTimeout = n_pReactor->Pending.empty() ? Timers.NextTimeout() : 0;
+
+			// nCount表示就绪事件的数目
+			int nCount = epoll_wait(n_pReactor->nEpfd, Event, EPOLL_SIZE, nTimeout);
+			if (nCount < 0)
+			{
+				if (errno == EINTR) continue;
+				if (m_bRun) DebugError("epoll_wait error");
+				break;
+			}
+			if (m_nIdleTimeout > 0) n_pReactor->nNow = CTimerWheel::Now();
+
+			// 上一轮读取达到上限的连接，在本轮事件处理后继续读取
+			n_pReactor->Ready.swap(n_pReactor->Pending);
+
+			for (int i = 0; i < nCount && m_bRun; ++i)
+			{
+				auto pNetNode = (FNetNode*)Event[i].data.ptr;
+
+				// 唤醒事件, 执行投递的任务
+				if (!pNetNode)
+				{
+					RunReactorTasks(n_pReactor);
+					continue;
+				}
+
+				// 错误队列中的发送时间戳
+				if ((Event[i].events & EPOLLERR) && m_pTrace) DrainTxStamps(pNetNode, m_pTrace);
+
+				// 可写, 发送队列中的数据
+				if ((Event[i].events & EPOLLOUT) && pNetNode->SendQueue)
+				{
+					if (FlushSendQueue(pNetNode->SendQueue) == SOCKET_ERROR)
+					{
+						FreeSocketNode(&pNetNode);
+						continue;
+					}
+					// 可写事件回调中调用了 Stop
+					if (!m_bRun) break;
+				}
+
+				if (!(Event[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP))) continue;
+				// 暂停读取，对端已关闭时仍读取剩余数据，避免 LT 模式下重复通知
+				if (pNetNode != n_pReactor->Listener && eNetType == ENetType::TCP &&
+					IsReadPaused(pNetNode) && !(Event[i].events & EPOLLHUP)) continue;
+
+				ReadSocket(n_pReactor, pNetNode, szBuff);
+			}
+
+			// 已释放的连接在 Ready 中置空，暂停读取的连接在恢复时重新通知
+			for (size_t i = 0; i < n_pReactor->Ready.size() && m_bRun; i++)
+			{
+				auto pNetNode = n_pReactor->Ready[i];
+				if (!pNetNode) continue;
+				if (pNetNode != n_pReactor->Listener && eNetType == ENetType::TCP && IsReadPaused(pNetNode)) continue;
+
+				ReadSocket(n_pReactor, pNetNode, szBuff);
+			}
+			n_pReactor->Ready.clear();
+
+			if (m_bRun && !Timers.Empty()) Timers.Advance();
+		}
+
+		CBufferPool::Free(szBuff, nBuffCapacity);
+		ReleaseOrphans(n_pReactor);
+	}
+
+	void CTinyServer::ReleaseOrphans(FReactor* n_pReactor)
+	{
+		auto pReactors = n_pReactor->Detached;
+		if (!pReactors) return;
+
+		for (auto pNetNode : *n_pReactor->Orphans) ReleaseNode(pNetNode);
+#if defined(TINYNET_IO_URING)
+		// RingWorkerThread 退出前已结束所有请求
+		for (auto pNetNode : n_pReactor->Closing) ReleaseNode(pNetNode);
+		n_pReactor->Closing.clear();
+		delete n_pReactor->Ring;
+		n_pReactor->Ring = nullptr;
+#endif
+		ReleaseReactor(n_pReactor);
+		delete[] pReactors;
+	}
+
+	void CTinyServer::ReadSocket(FReactor* n_pReactor, FNetNode* n_pNetNode, char* n_szBuff)
+	{
+		// 新用户连接
+		if (n_pNetNode == n_pReactor->Listener && eNetType == ENetType::TCP)
+		{
+			AcceptSocket(n_pReactor);
+			return;
+		}
+
+		if (eNetType == ENetType::UDP)
+		{
+			ReadDatagrams(n_pReactor, n_pNetNode, n_szBuff);
+			return;
+		}
+
+		int				nResult = 0;
+		if (m_nIdleTimeout > 0) TouchNode(n_pReactor, n_pNetNode);
+
+		// ET 模式需读取到 EAGAIN，单次事件最多读取 m_nReadBudget 次，
+		// 超出后加入 Pending，下一轮继续读取，避免单个连接占用 Reactor
+		for (unsigned int n = 0; m_bRun; n++)
+		{
+			if (n >= m_nReadBudget)
+			{
+				if (m_bEt) n_pReactor->Pending.push_back(n_pNetNode);
+				break;
+			}
+
+			// 客户端唤醒, 处理用户发来的消息
+			nResult = m_pTrace ? (int)RecvStamped(n_pNetNode->fd, n_szBuff, m_nBuffSize, 0) :
+				recv(n_pNetNode->fd, n_szBuff, m_nBuffSize, 0);
+
+			if (nResult <= 0)
+			{
+				if (nResult < 0 && errno == EINTR) continue;
+				if (nResult < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+
+				FreeSocketNode(&n_pNetNode);
+				if (m_bRun) DebugTrace("socket quit\n");
+				break;
+			}
+
+			ReceiveTcpMessage(n_pNetNode, n_pNetNode->sCache, n_szBuff, nResult);
+			// 回调中调用了 Stop
+			if (!m_bRun) break;
+
+			// LT 模式未读完会再次通知；暂停读取后恢复时重新通知
+			if (!m_bEt || IsReadPaused(n_pNetNode)) break;
+			// 未读满缓存，说明内核缓存已读空
+			if (nResult < m_nBuffSize) break;
+		}
+	}
+
+	void CTinyServer::ReadDatagrams(FReactor* n_pReactor, FNetNode* n_pNetNode, char* n_szBuff)
+	{
+		FRecvBatch Batch(n_szBuff, DatagramBuffSize(), m_nRecvBatch);
+
+		// 每次 recvmmsg 计为一次读取
+		for (unsigned int n = 0; m_bRun; n++)
+		{
+			if (n >= m_nReadBudget)
+			{
+				if (m_bEt) n_pReactor->Pending.push_back(n_pNetNode);
+				break;
+			}
+
+			auto nCount = Batch.Recv(n_pNetNode->fd, MSG_DONTWAIT);
+			if (nCount <= 0)
+			{
+				if (nCount < 0 && errno != EAGAIN && errno != EWOULDBLOCK && m_bRun)
+					DebugLog("recvmmsg error: %d\n", errno);
+				break;
+			}
+
+			auto nDrops = Batch.ForEach(nCount, [&](int i, const char* n_szData, int n_nSize) {
+				if (!m_bRun) return;
+				DispatchDatagram(n_pReactor, n_pNetNode, (const char*)&Batch.Addrs[i], n_szData, n_nSize);
+			});
+			if (nDrops > 0) AddStat(n_pNetNode, ENetStat::Drops, nDrops);
+
+			if (!m_bEt) break;
+			// 未取满，说明接收队列已读空
+			if ((unsigned int)nCount < Batch.nCount) break;
+		}
+	}
+
+	void CTinyServer::SetEt(const bool et)
+	{
+		m_bEt = et;
+	}
+
+	void CTinyServer::SetReactorNum(const unsigned int n_nNum, const EBalance n_eBalance)
+	{
+		m_nReactorNum = n_nNum;
+		m_eBalance = n_eBalance;
+	}
+
+	void CTinyServer::SetReadBudget(const unsigned int n_nReads)
+	{
+		m_nReadBudget = n_nReads > 0 ? n_nReads : 1;
+	}
+
+	void CTinyServer::SetReusePort(const bool n_bEnable, const bool n_bCpuSteering)
+	{
+		m_bReusePort = n_bEnable;
+		m_bCpuSteering = n_bEnable && n_bCpuSteering;
+	}
+
+	void CTinyServer::SetIdleTimeout(const unsigned int n_nMilliSeconds)
+	{
+		m_nIdleTimeout = n_nMilliSeconds;
+	}
+
+	int CTinyServer::SetNonblock(int n_nFd)
+	{
+		/** 设置为非阻塞. */
+		int nFlag = fcntl(n_nFd, F_GETFL, 0);
+		nFlag |= O_NONBLOCK;
+
+		return fcntl(n_nFd, F_SETFL, nFlag);
+	}
+
+	int CTinyServer::AddSocketIntoPoll(FNetNode* n_pNetNode, FReactor* n_pReactor)
+	{
+		if (!n_pNetNode->IsValid() || !n_pReactor) return -1;
+
+#if defined(TINYNET_IO_URING)
+		// 提交多次触发的接收，发送队列由 Reactor 提交
+		if (m_bUring)
+		{
+			if (SetNonblock(n_pNetNode->fd) == -1) return -1;
+			if (ArmRecv(n_pReactor, n_pNetNode) == -1) return -1;
+
+			auto pQueue = n_pNetNode->SendQueue;
+			if (pQueue)
+			{
+				{
+					std::unique_lock<std::mutex> lock(pQueue->Mutex);
+					pQueue->Reactor = n_pReactor;
+					pQueue->NetNode = n_pNetNode;
+				}
+
+				// 加入 Reactor 前未能立即发送的数据
+				SubmitSendQueue(n_pReactor, n_pNetNode);
+			}
+
+			return 0;
+		}
+#endif
+
+		struct epoll_event ev;
+		ev.data.ptr = n_pNetNode;
+		ev.events = EPOLLIN;
+		if (m_bEt) ev.events = EPOLLIN | EPOLLET;
+
+		auto pQueue = n_pNetNode->SendQueue;
+		if (pQueue)
+		{
+			std::unique_lock<std::mutex> lock(pQueue->Mutex);
+			pQueue->nEpfd = n_pReactor->nEpfd;
+			pQueue->NetNode = n_pNetNode;
+			pQueue->nEvents = ev.events;
+			pQueue->bWaitWrite = pQueue->Pending() > 0;
+			if (pQueue->bWaitWrite) ev.events |= EPOLLOUT;
+		}
+
+		int nRet = epoll_ctl(n_pReactor->nEpfd, EPOLL_CTL_ADD, n_pNetNode->fd, &ev);
+		if (nRet == -1) return nRet;
+
+		return SetNonblock(n_pNetNode->fd);
+	}
+
+	int CTinyServer::DelSocketFromPoll(FNetNode* n_pNetNode)
+	{
+		auto pNetNode = (FEpollNetNode*)n_pNetNode;
+		if (!pNetNode->Reactor) return -1;
+		return epoll_ctl(pNetNode->Reactor->nEpfd, EPOLL_CTL_DEL, pNetNode->fd, NULL);
+	}
+
+	FReactor* CTinyServer::SelectReactor()
+	{
+		if (m_nReactorCnt <= 1) return m_pReactors;
+
+		// 只在监听的 Reactor 线程调用，轮询序号无需加锁
+		if (m_eBalance == EBalance::RoundRobin)
+			return &m_pReactors[m_nNextReactor++ % m_nReactorCnt];
+
+		auto pReactor = m_pReactors;
+		for (unsigned int i = 1; i < m_nReactorCnt; i++)
+		{
+			if (m_pReactors[i].nConnections < pReactor->nConnections)
+				pReactor = &m_pReactors[i];
+		}
+
+		return pReactor;
+	}
+
+	void CTinyServer::AcceptSocket(FReactor* n_pReactor)
+	{
+		stSockaddrIn		RemoteAddr = { 0 };
+		SockaddrLen			nLen = sizeof(stSockaddrIn);
+
+		// 批量接收，直到全连接队列为空
+		for (unsigned int n = 0; m_bRun; n++)
+		{
+			if (n >= m_nReadBudget)
+			{
+				if (m_bEt) n_pReactor->Pending.push_back(n_pReactor->Listener);
+				break;
+			}
+
+			nLen = sizeof(stSockaddrIn);
+			int nFd = accept4(n_pReactor->Listener->fd, (stSockaddr*)&RemoteAddr, &nLen,
+				SOCK_NONBLOCK | SOCK_CLOEXEC);
+			if (nFd == -1)
+			{
+				if (errno == EINTR || errno == ECONNABORTED) continue;
+				if (errno != EAGAIN && errno != EWOULDBLOCK) DebugError("accept error");
+				break;
+			}
+
+			CreateSocketNode(n_pReactor, nFd, &RemoteAddr);
+		}
+	}
+
+	void CTinyServer::CreateSocketNode(FReactor* n_pReactor, int n_nFd, const stSockaddrIn* n_pAddr)
+	{
+		auto RemoteNetNode = new FEpollNetNode;
+		KeepAlive(n_nFd);
+
+		RemoteNetNode->fd = n_nFd;
+		RemoteNetNode->Init(ENetType::TCP, n_pAddr);
+		RemoteNetNode->Counters = Counters;
+		RemoteNetNode->SendQueue = CreateSendQueue(RemoteNetNode);
+		if (m_pTrace)
+		{
+			// 调度发送时间戳通过错误队列返回，只在 epoll 模式下读取
+			SetSocketTimestamping(n_nFd, !m_bUring);
+			RemoteNetNode->SendQueue->bTxStamp = !m_bUring;
+		}
+		// SO_REUSEPORT 模式下连接留在接收它的 Reactor
+		RemoteNetNode->Reactor = m_bReusePort ? n_pReactor : SelectReactor();
+		RemoteNetNode->Reactor->nConnections++;
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			RemoteNetNode->Id = m_Nodes.Insert(RemoteNetNode);
+		}
+
+		// 交给所属的 Reactor 线程添加到内核事件列表
+		if (RemoteNetNode->Reactor == n_pReactor)
+			AttachSocketNode(RemoteNetNode);
+		else
+		{
+			PostToReactor(RemoteNetNode->Reactor,
+				std::bind(&CTinyServer::AttachSocketNode, this, RemoteNetNode));
+		}
+	}
+
+	void CTinyServer::AttachSocketNode(FNetNode* n_pNetNode)
+	{
+		auto pNetNode = (FEpollNetNode*)n_pNetNode;
+
+		// 把这个新的客户端添加到内核事件列表
+		if (AddSocketIntoPoll(pNetNode, pNetNode->Reactor) == -1)
+		{
+			DebugError("Add EPoll eventl error");
+			FreeSocketNode(&n_pNetNode);
+			return;
+		}
+
+		// 从加入 Reactor 开始计算空闲时间
+		if (m_nIdleTimeout > 0) TouchNode(pNetNode->Reactor, pNetNode);
+
+		OnEventCallback(pNetNode, ENetEvent::Accept, "");
+	}
+
+	void CTinyServer::FlushSocketNodes(const std::vector<unsigned long long>& n_vecIds)
+	{
+		std::vector<FNetNode*> vecNodes;
+		vecNodes.reserve(n_vecIds.size());
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			for (auto nId : n_vecIds)
+			{
+				auto ppNetNode = m_Nodes.Find(nId);
+				if (ppNetNode) vecNodes.push_back(*ppNetNode);
+			}
+		}
+
+		// 连接只在所属 Reactor 线程释放，解锁后仍然有效
+		for (auto pNetNode : vecNodes)
+		{
+#if defined(TINYNET_IO_URING)
+			if (m_bUring)
+			{
+				SubmitSendQueue(((FEpollNetNode*)pNetNode)->Reactor, pNetNode);
+				// 广播加入队列后可写状态的改变
+				NotifyWritable(pNetNode->SendQueue);
+				continue;
+			}
+#endif
+			if (FlushSendQueue(pNetNode->SendQueue) == SOCKET_ERROR)
+				FreeSocketNode(&pNetNode);
+		}
+	}
+
+	void CTinyServer::FreeSocketNode(FNetNode** n_pNetNode)
+	{
+		if (!n_pNetNode || !*n_pNetNode) return;
+
+		auto pNetNode = (FEpollNetNode*)(*n_pNetNode);
+		*n_pNetNode = nullptr;
+#if defined(TINYNET_IO_URING)
+		// 已关闭，等待请求结束
+		if (pNetNode->bClosed) return;
+#endif
+		// 抛出退出事件
+		OnEventCallback(pNetNode, ENetEvent::Quit, "");
+		// 回调中调用 Stop 时连接仍在 m_Nodes 中，由 Stop 释放
+		if (!m_bRun) return;
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_Nodes.Erase(pNetNode->Id);
+		}
+		pNetNode->Unlink();
+
+#if defined(TINYNET_IO_URING)
+		if (m_bUring)
+		{
+			auto pReactor = pNetNode->Reactor;
+			pReactor->nConnections--;
+
+			if (pNetNode->nRingOps == 0)
+			{
+				ReleaseSocketNode(pNetNode);
+				return;
+			}
+
+			// 取消该连接未结束的请求，最后一个请求结束后释放
+			pNetNode->bClosed = true;
+			pReactor->Closing.push_back(pNetNode);
+
+			auto pSqe = pReactor->Ring->GetSqe();
+			if (pSqe)
+			{
+				pSqe->opcode = IORING_OP_ASYNC_CANCEL;
+				pSqe->fd = (int)pNetNode->fd;
+				pSqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+				pSqe->user_data = RingData(nullptr, ERingOp::Cancel);
+			}
+			return;
+		}
+#endif
+
+		DelSocketFromPoll(pNetNode);
+		if (pNetNode->Reactor)
+		{
+			pNetNode->Reactor->nConnections--;
+
+			// 在所属 Reactor 线程释放，从待读取列表中移除
+			for (auto& Node : pNetNode->Reactor->Pending)
+				if (Node == pNetNode) Node = nullptr;
+			for (auto& Node : pNetNode->Reactor->Ready)
+				if (Node == pNetNode) Node = nullptr;
+		}
+
+		ReleaseSocketNode(pNetNode);
+	}
+
+	void CTinyServer::ReleaseSocketNode(FNetNode* n_pNetNode)
+	{
+		RetireNode(n_pNetNode, std::bind(ReleaseNode, n_pNetNode));
+	}
+
+	void CTinyServer::FreeSocketNodes()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		// Reactor 已释放，关闭 Socket 会自动从 epoll 中移除
+		for (auto Node : m_Nodes) ReleaseNode(Node);
+
+		m_Nodes.Clear();
+	}
+
+	void CTinyServer::FreeReactors()
+	{
+		if (!m_pReactors) return;
+
+		for (unsigned int i = 0; i < m_nReactorCnt; i++)
+		{
+			if (m_pReactors[i].nWakeFd > 0) WakeReactor(&m_pReactors[i]);
+		}
+
+		// 当前线程所属的 Reactor
+		FReactor* pSelf = nullptr;
+		for (unsigned int i = 0; i < m_nReactorCnt; i++)
+		{
+			auto& Thread = m_pReactors[i].Thread;
+			if (!Thread.joinable()) continue;
+
+			// 在 Reactor 线程的回调中调用 Stop
+			if (Thread.get_id() == std::this_thread::get_id())
+			{
+				Thread.detach();
+				pSelf = &m_pReactors[i];
+			}
+			else Thread.join();
+		}
+
+		for (unsigned int i = 0; i < m_nReactorCnt; i++)
+		{
+			auto pReactor = &m_pReactors[i];
+			// 当前线程的 Reactor 仍在使用，由其退出时释放
+			if (pReactor == pSelf) continue;
+
+#if defined(TINYNET_IO_URING)
+			// 线程退出时已取消所有请求
+			for (auto pNetNode : pReactor->Closing) ReleaseNode(pNetNode);
+			delete pReactor->Ring;
+#endif
+			ReleaseReactor(pReactor);
+		}
+
+		if (pSelf)
+		{
+			// 当前线程正在回调的连接仍在使用，所有连接由其退出时释放
+			std::unique_lock<std::mutex> lock(m_mutex);
+			for (auto pNetNode : m_Nodes) pSelf->Orphans->push_back(pNetNode);
+			m_Nodes.Clear();
+			pSelf->Detached = m_pReactors;
+		}
+		else delete[] m_pReactors;
+		m_pReactors = nullptr;
+		m_nReactorCnt = 0;
+	}
+
+	void CTinyServer::ReleaseReactor(FReactor* n_pReactor)
+	{
+		if (n_pReactor->nWakeFd > 0) close(n_pReactor->nWakeFd);
+		if (n_pReactor->nEpfd > 0) close(n_pReactor->nEpfd);
+
+		// UDP 会话与监听节点共用 Socket，只释放节点
+		n_pReactor->Peers.ForEach([](CHashMap<FNetNode*>::Key, FNetNode* n_pNetNode) {
+			delete (FEpollNetNode*)n_pNetNode;
+		});
+		n_pReactor->Peers.Clear();
+
+		// 释放 SO_REUSEPORT 模式下 Reactor 独有的监听 Socket
+		if (n_pReactor->Listener && n_pReactor->Listener != this)
+		{
+			auto pListener = (FEpollNetNode*)n_pReactor->Listener;
+			CloseSocket(pListener->fd);
+			delete pListener;
+		}
+	}
+
+	void CTinyServer::ReapIdleNodes(FReactor* n_pReactor)
+	{
+		auto nNow = CTimerWheel::Now();
+		n_pReactor->nNow = nNow;
+
+		// 表头为最久未收到数据的连接，遇到未超时的即停止
+		auto& Active = n_pReactor->Active;
+		while (m_bRun && !Active.Empty())
+		{
+			auto pEpollNode = static_cast<FEpollNetNode*>(Active.pNext);
+			if (nNow - pEpollNode->nLastActive < m_nIdleTimeout) break;
+
+			// TCP 连接释放时抛出退出事件
+			FNetNode* pNetNode = pEpollNode;
+			if (eNetType == ENetType::UDP) OnEventCallback(pNetNode, ENetEvent::Quit, "");
+			// 在回调中调用 Stop 时连接已释放
+			if (!m_bRun) break;
+
+			if (eNetType == ENetType::UDP) FreePeerNode(n_pReactor, pNetNode);
+			else FreeSocketNode(&pNetNode);
+			DebugTrace("idle socket closed\n");
+		}
+	}
+
+	void CTinyServer::DispatchDatagram(FReactor* n_pReactor, FNetNode* n_pListener,
+		const char* n_szAddr, const char* n_szData, const int n_nSize)
+	{
+		auto nKey = SockaddrToInteger((char*)n_szAddr);
+		unsigned int nEventId = 0;
+		if (n_nSize >= (int)sizeof(FHeader))
+			nEventId = ntohl(((const FHeader*)n_szData)->nEventId);
+
+		FNetNode* pPeer = nullptr;
+		auto ppPeer = n_pReactor->Peers.Find(nKey);
+		if (ppPeer) pPeer = *ppPeer;
+		else if (nEventId == kHelloId)
+		{
+			// 与监听节点共用 Socket
+			auto pPeerNode = new FEpollNetNode;
+			pPeerNode->fd = n_pListener->fd;
+			pPeerNode->Init(ENetType::UDP, (const stSockaddrIn*)n_szAddr);
+			pPeerNode->bUdpGso = n_pListener->bUdpGso;
+			pPeerNode->Reactor = n_pReactor;
+			pPeerNode->Counters = Counters;
+
+			n_pReactor->Peers.Insert(nKey, pPeerNode);
+			n_pReactor->nConnections++;
+			pPeer = pPeerNode;
+		}
+
+		if (!pPeer)
+		{
+			// 回复地址为数据报的发送方
+			memcpy(n_pListener->Addr, n_szAddr, sizeof(stSockaddrIn));
+			ReceiveUdpMessage(n_pListener, n_szData, n_nSize, true);
+			return;
+		}
+
+		if (m_nIdleTimeout > 0) TouchNode(n_pReactor, pPeer);
+		ReceiveUdpMessage(pPeer, n_szData, n_nSize);
+
+		// 已触发 Quit 事件
+		if (nEventId == kQuitId && m_bRun) FreePeerNode(n_pReactor, pPeer);
+	}
+
+	void CTinyServer::FreePeerNode(FReactor* n_pReactor, FNetNode* n_pNetNode)
+	{
+		auto pNetNode = (FEpollNetNode*)n_pNetNode;
+
+		n_pReactor->Peers.Erase(SockaddrToInteger(pNetNode->Addr));
+		n_pReactor->nConnections--;
+		pNetNode->Unlink();
+
+		// Socket 属于监听节点，不关闭
+		RetireNode(pNetNode, [pNetNode]() { delete pNetNode; });
+	}
+
+	void CTinyServer::SetReadPause(FNetNode* n_pNetNode, const unsigned char n_nReason, const bool n_bPause)
+	{
+		if (!UpdateReadPause(n_pNetNode, n_nReason, n_bPause)) return;
+
+		auto pNetNode = (FEpollNetNode*)n_pNetNode;
+#if defined(TINYNET_IO_URING)
+		// 取消多次触发的接收，已接收的数据仍然回调，恢复时重新提交
+		if (m_bUring)
+		{
+			if (pNetNode->bClosed) return;
+			if (n_bPause) CancelRecv(pNetNode->Reactor, pNetNode);
+			else if (!pNetNode->bRecvArmed) ArmRecv(pNetNode->Reactor, pNetNode);
+			return;
+		}
+#endif
+		if (pNetNode->SendQueue) WatchReadable(pNetNode->SendQueue, !n_bPause);
+	}
+
+	void CTinyServer::OnCallbackBacklog(FNetNode* n_pNetNode)
+	{
+		// UDP 不暂停读取
+		if (eNetType != ENetType::TCP || n_pNetNode == this) return;
+		SetReadPause(n_pNetNode, kPauseBacklog, true);
+	}
+
+	void CTinyServer::OnCallbackDrained(const unsigned long long n_nKey)
+	{
+		PostReadPause(n_nKey, kPauseBacklog, false);
+	}
+
+	bool CTinyServer::PostReadPause(const unsigned long long n_nId, const unsigned char n_nReason,
+		const bool n_bPause)
+	{
+		// UDP 不暂停读取
+		if (eNetType != ENetType::TCP) return false;
+
+		// 连接只在所属 Reactor 线程释放，在其中重新查找
+		return PostToNode(n_nId, [this, n_nId, n_nReason, n_bPause]() {
+			FNetNode* pNetNode = nullptr;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				auto ppNetNode = m_Nodes.Find(n_nId);
+				if (ppNetNode) pNetNode = *ppNetNode;
+			}
+
+			if (pNetNode) SetReadPause(pNetNode, n_nReason, n_bPause);
+		});
+	}
+
+	bool CTinyServer::PostToNode(const unsigned long long n_nId, std::function<void()> n_fnTask)
+	{
+		if (!m_bRun) return false;
+
+		// 停止时先停止回调线程再释放 Reactor，此处 Reactor 仍然有效
+		FReactor* pReactor = nullptr;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			auto ppNetNode = m_Nodes.Find(n_nId);
+			if (!ppNetNode) return false;
+			pReactor = ((FEpollNetNode*)*ppNetNode)->Reactor;
+		}
+
+		PostToReactor(pReactor, std::move(n_fnTask));
+		return true;
+	}
+
+#if defined(TINYNET_IO_URING)
+	bool CTinyServer::CreateRing(FReactor* n_pReactor)
+	{
+		auto nBuffSize = eNetType == ENetType::UDP ? DatagramBuffSize() : m_nBuffSize;
+
+		n_pReactor->Ring = CreateUring(RingBufferSize(eNetType, nBuffSize));
+		if (!n_pReactor->Ring) return false;
+
+		InitRingMsg(&n_pReactor->RecvMsg);
+		return true;
+	}
+
+	void CTinyServer::RingWorkerThread(FReactor* n_pReactor)
+	{
+		// 在回调中调用 Stop 时 Reactor 已释放，退出时只使用 io_uring
+		auto pRing = n_pReactor->Ring;
+		auto pTimers = n_pReactor->Timers;
+		if (!pRing->Enable())
+		{
+			DebugError("enable io_uring error");
+			return;
+		}
+
+		// 唤醒事件
+		PrepPoll(pRing, n_pReactor->nWakeFd, POLLIN, RingData(nullptr, ERingOp::Wake));
+
+		if (n_pReactor->Listener && AddSocketIntoPoll(n_pReactor->Listener, n_pReactor) == -1)
+			DebugError("Add io_uring event error");
+
+		while (m_bRun)
+		{
+			// 提交请求，并等待至少一个完成事件或下一个定时器到期
+			if (pRing->Submit(1, pTimers->NextTimeout()) < 0 &&
+				errno != EINTR && errno != EAGAIN && errno != EBUSY && errno != ETIME)
+			{
+				if (m_bRun) DebugError("io_uring_enter error");
+				break;
+			}
+			if (m_nIdleTimeout > 0) n_pReactor->nNow = CTimerWheel::Now();
+
+			pRing->ForEachCqe([&](const struct io_uring_cqe* n_pCqe) {
+				if (m_bRun) OnRingEvent(n_pReactor, n_pCqe);
+			});
+
+			if (m_bRun && !pTimers->Empty()) pTimers->Advance();
+		}
+
+		// 取消未结束的请求，等待其结束
+		pRing->Exit();
+	}
+
+	int CTinyServer::ArmRecv(FReactor* n_pReactor, FNetNode* n_pNetNode)
+	{
+		auto pRing = n_pReactor->Ring;
+
+		// 新用户连接
+		if (n_pNetNode == n_pReactor->Listener && eNetType == ENetType::TCP)
+		{
+			auto pSqe = pRing->GetSqe();
+			if (!pSqe) return -1;
+
+			pSqe->opcode = IORING_OP_ACCEPT;
+			pSqe->fd = (int)n_pNetNode->fd;
+			pSqe->ioprio = IORING_ACCEPT_MULTISHOT;
+			pSqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+			pSqe->user_data = RingData(n_pNetNode, ERingOp::Accept);
+			return 0;
+		}
+
+		auto pMsg = eNetType == ENetType::UDP ? &n_pReactor->RecvMsg : nullptr;
+		if (!PrepRecv(pRing, n_pNetNode->fd, pMsg, RingData(n_pNetNode, ERingOp::Recv)))
+			return -1;
+
+		// 监听的 Socket 不会单独释放，只统计连接的请求
+		if (n_pNetNode != n_pReactor->Listener)
+		{
+			((FEpollNetNode*)n_pNetNode)->nRingOps++;
+			((FEpollNetNode*)n_pNetNode)->bRecvArmed = true;
+		}
+
+		return 0;
+	}
+
+	void CTinyServer::CancelRecv(FReactor* n_pReactor, FNetNode* n_pNetNode)
+	{
+		auto pSqe = n_pReactor->Ring->GetSqe();
+		if (!pSqe) return;
+
+		// 按 user_data 匹配，不影响正在进行的发送
+		pSqe->opcode = IORING_OP_ASYNC_CANCEL;
+		pSqe->fd = -1;
+		pSqe->addr = RingData(n_pNetNode, ERingOp::Recv);
+		pSqe->user_data = RingData(nullptr, ERingOp::Cancel);
+	}
+
+	bool CTinyServer::FinishClosing(FReactor* n_pReactor, FNetNode* n_pNetNode)
+	{
+		auto pNetNode = (FEpollNetNode*)n_pNetNode;
+		if (!pNetNode->bClosed) return false;
+		if (pNetNode->nRingOps > 0) return true;
+
+		auto& Closing = n_pReactor->Closing;
+		Closing.erase(std::remove(Closing.begin(), Closing.end(), n_pNetNode), Closing.end());
+		ReleaseSocketNode(pNetNode);
+
+		return true;
+	}
+
+	void CTinyServer::SubmitSendQueue(FReactor* n_pReactor, FNetNode* n_pNetNode)
+	{
+		auto pNetNode = (FEpollNetNode*)n_pNetNode;
+		auto pQueue = pNetNode->SendQueue;
+		if (!pQueue || pNetNode->bClosed) return;
+
+		auto pRing = n_pReactor->Ring;
+		std::unique_lock<std::mutex> lock(pQueue->Mutex);
+
+		// 上次提交的发送全部结束后再提交，保证顺序
+		if (pQueue->nInflight > 0) return;
+
+		// 链接的 SQE 需在同一次提交中
+		auto nCount = (unsigned int)std::min<size_t>(pQueue->Segments.size(), kRingSendChain);
+		if (pRing->SqSpace() < nCount) pRing->Submit();
+		nCount = std::min(nCount, pRing->SqSpace());
+		if (nCount == 0)
+		{
+			// 提交队列仍满，保持 bWaitWrite，唤醒后重新提交
+			if (pQueue->Pending() > 0) RequestFlush(n_pReactor, pNetNode->Id);
+			else pQueue->bWaitWrite = false;
+			return;
+		}
+
+		size_t nOffset = pQueue->nOffset;
+		for (unsigned int i = 0; i < nCount; i++)
+		{
+			auto& Segment = pQueue->Segments[i];
+
+			auto pSqe = pRing->GetSqe();
+			pSqe->opcode = IORING_OP_SEND;
+			pSqe->fd = (int)pNetNode->fd;
+			pSqe->addr = (unsigned long long)(uintptr_t)(Segment.Data() + nOffset);
+			pSqe->len = (unsigned int)(Segment.Size() - nOffset);
+			// 由内核处理部分发送，未能完整发送时后续链接的发送被取消
+			pSqe->msg_flags = kSendFlags | MSG_WAITALL;
+			if (i + 1 < nCount) pSqe->flags = IOSQE_IO_LINK;
+			pSqe->user_data = RingData(pNetNode, ERingOp::Send);
+
+			nOffset = 0;
+		}
+
+		pQueue->nInflight = nCount;
+		pQueue->bWaitWrite = pQueue->Pending() > 0;
+		pNetNode->nRingOps += nCount;
+	}
+
+	void CTinyServer::OnRingEvent(FReactor* n_pReactor, const struct io_uring_cqe* n_pCqe)
+	{
+		auto pRing = n_pReactor->Ring;
+		auto nResult = n_pCqe->res;
+		// 多次触发的请求仍然有效
+		bool bMore = (n_pCqe->flags & IORING_CQE_F_MORE) != 0;
+
+		switch (RingOp(n_pCqe->user_data))
+		{
+		case ERingOp::Wake:
+		{
+			RunReactorTasks(n_pReactor);
+			if (!m_bRun) return;
+
+			std::vector<unsigned long long> vecIds;
+			{
+				std::unique_lock<std::mutex> lock(n_pReactor->Mutex);
+				vecIds.swap(n_pReactor->Flushes);
+			}
+			if (!vecIds.empty()) FlushSocketNodes(vecIds);
+			if (!m_bRun) return;
+
+			if (!bMore) PrepPoll(pRing, n_pReactor->nWakeFd, POLLIN, RingData(nullptr, ERingOp::Wake));
+		}
+		break;
+		case ERingOp::Accept:
+		{
+			if (nResult >= 0)
+			{
+				// 多次触发的 accept 不返回对端地址
+				stSockaddrIn RemoteAddr = { 0 };
+				SockaddrLen nLen = sizeof(stSockaddrIn);
+				getpeername(nResult, (stSockaddr*)&RemoteAddr, &nLen);
+
+				CreateSocketNode(n_pReactor, nResult, &RemoteAddr);
+				if (!m_bRun) return;
+			}
+			else if (nResult != -ECANCELED) DebugLog("accept error: %d\n", -nResult);
+
+			if (!bMore) ArmRecv(n_pReactor, n_pReactor->Listener);
+		}
+		break;
+		case ERingOp::Recv:
+		{
+			auto pNetNode = (FNetNode*)RingPtr(n_pCqe->user_data);
+			bool bListener = pNetNode == n_pReactor->Listener;
+
+			if (nResult > 0 && (n_pCqe->flags & IORING_CQE_F_BUFFER))
+			{
+				auto nBid = (unsigned short)(n_pCqe->flags >> IORING_CQE_BUFFER_SHIFT);
+				auto szBuff = pRing->GetBuffer(nBid);
+
+				if (eNetType == ENetType::UDP)
+				{
+					auto nDrops = ForEachRingDatagram(szBuff, nResult, &n_pReactor->RecvMsg,
+						[&](const char* n_szAddr, const char* n_szData, int n_nSize) {
+						if (!m_bRun) return;
+						DispatchDatagram(n_pReactor, pNetNode, n_szAddr, n_szData, n_nSize);
+					});
+					if (nDrops > 0) AddStat(pNetNode, ENetStat::Drops, nDrops);
+				}
+				else if (!((FEpollNetNode*)pNetNode)->bClosed)
+				{
+					if (m_nIdleTimeout > 0) TouchNode(n_pReactor, pNetNode);
+					ReceiveTcpMessage(pNetNode, pNetNode->sCache, szBuff, nResult);
+				}
+
+				if (!m_bRun) return;
+				pRing->RecycleBuffer(nBid);
+			}
+
+			if (bListener)
+			{
+				if (!bMore && nResult != -ECANCELED) ArmRecv(n_pReactor, pNetNode);
+				break;
+			}
+
+			auto pEpollNode = (FEpollNetNode*)pNetNode;
+			if (!bMore)
+			{
+				pEpollNode->nRingOps--;
+				pEpollNode->bRecvArmed = false;
+			}
+			if (FinishClosing(n_pReactor, pEpollNode)) break;
+
+			// 接收缓存用尽时多次触发的接收结束，重新提交；暂停读取时取消的接收在恢复时提交
+			if (nResult > 0 || nResult == -ENOBUFS || nResult == -ECANCELED)
+			{
+				if (!bMore && !IsReadPaused(pNetNode)) ArmRecv(n_pReactor, pNetNode);
+				break;
+			}
+
+			FreeSocketNode(&pNetNode);
+			if (m_bRun) DebugTrace("socket quit\n");
+		}
+		break;
+		case ERingOp::Send:
+		{
+			auto pNetNode = (FEpollNetNode*)RingPtr(n_pCqe->user_data);
+			pNetNode->nRingOps--;
+			if (FinishClosing(n_pReactor, pNetNode)) break;
+
+			auto pQueue = pNetNode->SendQueue;
+			bool bSubmit = false;
+			bool bNotify = false;
+			{
+				std::unique_lock<std::mutex> lock(pQueue->Mutex);
+				pQueue->nInflight--;
+				if (nResult > 0) pQueue->Consume(nResult);
+				// 某一段未能完整发送时其后链接的发送均被取消，每次提交只计一次
+				else if (nResult == -ECANCELED && pQueue->nInflight == 0)
+					AddStat(pNetNode, ENetStat::PartialSends);
+
+				// 本次提交的发送全部结束，继续发送新加入的数据
+				if (pQueue->nInflight == 0)
+				{
+					bSubmit = pQueue->Pending() > 0;
+					pQueue->bWaitWrite = bSubmit;
+				}
+				bNotify = pQueue->WritableChanged();
+			}
+
+			// 部分发送导致的取消，剩余数据重新提交
+			if (nResult < 0 && nResult != -ECANCELED)
+			{
+				FNetNode* pNode = pNetNode;
+				FreeSocketNode(&pNode);
+				break;
+			}
+
+			if (bSubmit) SubmitSendQueue(n_pReactor, pNetNode);
+			if (bNotify) NotifyWritable(pQueue);
+		}
+		break;
+		default:
+			break;
+		}
+	}
+#endif
+#endif
+
+	bool CTinyServer::OnEventMessage(FNetNode* n_pNetNode, const char* n_szData, const int n_nSize)
+	{
+		bool bResult = true;
+
+		FNetBuffer NetBuffer;
+		if (!NetBuffer.PointTo(n_szData, n_nSize)) return false;
+		auto nEventId = NetBuffer.GetEventId();
+
+		switch (nEventId)
+		{
+		case kHelloId:
+		{
+			OnEventCallback(n_pNetNode, ENetEvent::Hello, "");
+
+			// 返回客户端对应的远端 sockaddr
+			NetBuffer.SetData(n_pNetNode->Addr, SOCKADDR_SIZE);
+			NetBuffer.SetEventId(kHelloId);
+
+			n_pNetNode->Send(NetBuffer);
+		}
+		break;
+		case kHeartId:
+		{
+			auto pHeart = (FHeart*)NetBuffer.GetData();
+
+			char szBuff[sizeof(unsigned int) * 2] = { 0 };
+			auto nNo = ntohl(pHeart->No);
+			auto nCnt = ntohl(pHeart->Cnt);
+			memcpy(szBuff, &nNo, sizeof(unsigned int));
+			memcpy(szBuff + sizeof(unsigned int), &nCnt, sizeof(unsigned int));
+
+			OnEventCallback(n_pNetNode, ENetEvent::Heart,
+				// 心跳序号及失败次数
+				std::string(szBuff, sizeof(unsigned int) * 2)
+			);
+
+			// 客户端发的心跳包需回消息，否则通过事件处理后续逻辑
+			if (pHeart->Sender != (unsigned int)fd)
+			{
+				pHeart->No = htonl(nNo + 1);
+				n_pNetNode->Send(NetBuffer);
+			}
+		}
+		break;
+		case kQuitId:
+		{
+			OnEventCallback(n_pNetNode, ENetEvent::Quit, "");
+		}
+		break;
+		default:
+			bResult = false;
+			break;
+		}
+
+		return bResult;
+	}
+
+#pragma endregion
+
+
+	////////////////////////////////////////////////////////////////////////////////
+#pragma region 客户端
+	CTinyClient::CTinyClient()
+	{
+	}
+
+	CTinyClient::~CTinyClient()
+	{
+		Stop();
+	}
+
+	bool CTinyClient::Start()
+	{
+		if (IsValid()) return false;
+
+		StartCallbacks();
+		if (InitSock()) return true;
+
+		StopCallbacks();
+		return false;
+	}
+
+	void CTinyClient::Stop()
+	{
+		// 等待正在执行的心跳完成
+		CancelTimer(m_nHeartTimer);
+		m_nHeartTimer = 0;
+
+		// 等待重连时 Socket 已关闭，仍需结束工作线程
+		if (!IsValid() && !m_thread.joinable()) return;
+
+		ITinyNet::Stop();
+
+		QuitEvent();
+		m_cvReconnect.notify_all();
+		m_cvBacklog.notify_all();
+		Join();
+
+		// 执行完已投递的回调
+		StopCallbacks();
+	}
+
+	void CTinyClient::EnableHeart(unsigned int n_nPeriod, unsigned int n_nTimeoutCnt)
+	{
+		m_nHeartNo = 0;
+		m_nHeartPeriod = n_nPeriod;
+		m_nHeartTimeoutCnt = n_nTimeoutCnt;
+	}
+
+	const unsigned short CTinyClient::RemotePort()
+	{
+		return SockaddrToPort(m_szRemoteAddr);
+	}
 
-		SOCKET			ClientSocket = -1;
-		stSockaddrIn	ClientAddr = { 0 };
-		SockaddrLen		AddrLen = sizeof(stSockaddrIn);
+	const std::string CTinyClient::RemoteIp()
+	{
+		return SockaddrToIp(m_szRemoteAddr);
+	}
 
-		while (true)
+	int CTinyClient::SendHeart()
+	{
+		return Heart(m_nHeartNo, 0);
+	}
+
+	void CTinyClient::SetReconnect(const unsigned int n_nMinDelay,
+		const unsigned int n_nMaxDelay, const unsigned int n_nMaxTimes)
+	{
+		m_nReconnectMin = n_nMinDelay;
+		m_nReconnectMax = std::max(n_nMinDelay, n_nMaxDelay);
+		m_nReconnectTimes = n_nMaxTimes;
+	}
+
+	bool CTinyClient::InitSock()
+	{
+		m_bRun = false;
+		m_nReconnectCnt = 0;
+		m_nReconnectDelay = 0;
+
+		size_t nFd = 0;
+		if (!ConnectSock(nFd)) return false;
+		fd = nFd;
+
+		Join();
+		InitEngine();
+
+		m_thread = std::thread(&CTinyClient::WorkerThread, this);
+
+		m_bRun = true;
+
+		// 心跳由共享的定时器线程发送
+		if (m_nHeartPeriod > 0)
 		{
-			ClientSocket = WSAAccept(
-				fd, (stSockaddr*)&ClientAddr, &AddrLen, NULL, NULL
-			);
+			m_nHeartNo = 0;
+			m_nHeartSent = 0xFFFFFFFF;
+			m_nHeartFail = 0;
+			m_nHeartTimer = AddTimer(0, m_nHeartPeriod, std::bind(&CTinyClient::OnHeartTimer, this));
+		}
 
-			if (ClientSocket == SOCKET_ERROR)
+		return m_bRun;
+	}
+
+	bool CTinyClient::ConnectSock(size_t& n_nFd)
+	{
+		int nSockType = NetType2SockType(eNetType);
+		if (nSockType == 0) return false;
+
+		n_nFd = socket(AF_INET, nSockType, 0);
+		if (n_nFd == (size_t)SOCKET_ERROR)
+		{
+			DebugLog("create Socket error: %d\n", LastError());
+			n_nFd = 0;
+			return false;
+		}
+
+		SetSocketTTL(n_nFd, IP_TTL, (unsigned char)m_nTTL);
+		SetSocketSendTimeout(n_nFd, m_nTimeout);
+
+		// 超时内未连接成功则失败，不等待系统的 SYN 重试
+		if (ConnectSocket(n_nFd, (stSockaddr*)Addr, m_nTimeout) == SOCKET_ERROR)
+		{
+			DebugLog("connect Socket error: %d\n", LastError());
+			CloseSocket(n_nFd);
+			return false;
+		}
+
+		if (eNetType == ENetType::TCP) SetSocketKeepAlive(n_nFd, 1);
+#if !defined(_WIN32) && !defined(_WIN64)
+		if (m_pTrace) SetSocketTimestamping(n_nFd, false);
+#endif
+
+		return true;
+	}
+
+	void CTinyClient::InitEngine()
+	{
+#if !defined(_WIN32) && !defined(_WIN64)
+		if (m_bUdpOffload && eNetType == ENetType::UDP)
+		{
+			SetSocketUdpGro(fd);
+			bUdpGso = true;
+		}
+#endif
+
+		m_bUring = false;
+#if defined(TINYNET_IO_URING)
+		// 在工作线程中启用，内核不支持时使用阻塞接收
+		if (m_eIoEngine == EIoEngine::IoUring)
+		{
+			auto nBuffSize = eNetType == ENetType::UDP ? DatagramBuffSize() : m_nBuffSize;
+			m_pRing = CreateUring(RingBufferSize(eNetType, nBuffSize));
+			m_bUring = m_pRing != nullptr;
+			if (!m_bUring) DebugLog("io_uring not available, use blocking recv\n");
+		}
+#endif
+	}
+
+	bool CTinyClient::Reconnect()
+	{
+		if (m_nReconnectMin == 0) return false;
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			if (!m_bRun) return false;
+			CloseSocket(fd);
+		}
+
+		// 随机数种子区分不同的客户端，避免同时重连
+		std::minstd_rand Random((unsigned int)(CTimerWheel::Now() ^ (unsigned long long)(size_t)this));
+
+		while (m_nReconnectTimes == 0 || m_nReconnectCnt < m_nReconnectTimes)
+		{
+			auto nTimes = ++m_nReconnectCnt;
+			auto nDelay = m_nReconnectDelay > 0 ? m_nReconnectDelay : m_nReconnectMin;
+			// 下次重连的延时加倍，收到服务端的 Hello 回复后重置
+			m_nReconnectDelay = (unsigned int)std::min((unsigned long long)nDelay * 2, (unsigned long long)m_nReconnectMax);
+
+			// 实际延时在 [nDelay/2, nDelay] 内随机
+			auto nWait = nDelay / 2 + (unsigned int)(Random() % (nDelay - nDelay / 2 + 1));
 			{
-				if (m_bRun) DebugLog("Accept 错误: %d\n", LastError());
-				break;
+				std::unique_lock<std::mutex> lock(m_mutex);
+				if (m_cvReconnect.wait_for(lock, std::chrono::milliseconds(nWait), [this]() { return !m_bRun; }))
+					return false;
 			}
 
-			auto TcpHandle = (FIOCPNetNode*)AllocSocketNode(ClientSocket, &ClientAddr);
-			if (!TcpHandle) continue;
+			char szBuff[sizeof(unsigned int) * 2] = { 0 };
+			memcpy(szBuff, &nTimes, sizeof(unsigned int));
+			memcpy(szBuff + sizeof(unsigned int), &nWait, sizeof(unsigned int));
+			// 重连次数及延时
+			OnEventCallback(this, ENetEvent::Reconnect, std::string(szBuff, sizeof(unsigned int) * 2));
 
-			KeepAlive(ClientSocket);
-			OnEventCallback(TcpHandle, ENetEvent::Accept, "");
+			size_t nFd = 0;
+			if (ConnectSock(nFd))
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				// 连接期间已停止
+				if (!m_bRun)
+				{
+					CloseSocket(nFd);
+					return false;
+				}
 
-			CreateIoCompletionPort(
-				(HANDLE)ClientSocket, m_hIocp, (ULONG_PTR)TcpHandle, 0
-			);
+				fd = nFd;
+				m_nHeartNo = 0;
+				m_nHeartSent = 0xFFFFFFFF;
+				m_nHeartFail = 0;
+				sCache.clear();
 
-			nResult = PostRecv(TcpHandle);
+				InitEngine();
+				return true;
+			}
+		}
 
-			if (nResult == SOCKET_ERROR && LastError() != WSA_IO_PENDING)
+		DebugLog("reconnect failed\n");
+		m_bRun = false;
+		return false;
+	}
+
+	void CTinyClient::WorkerThread()
+	{
+		// UDP 批量接收，每个数据报占用一段缓存
+		size_t nBuffSize = m_nBuffSize;
+#if !defined(_WIN32) && !defined(_WIN64)
+		if (eNetType == ENetType::UDP) nBuffSize = (size_t)DatagramBuffSize() * RecvBatchSize(m_nRecvBatch);
+#endif
+
+		size_t nBuffCapacity = 0;
+		char* szBuff = CBufferPool::Alloc(nBuffSize, nBuffCapacity);
+		if (!szBuff) return;
+		memset(szBuff, 0, nBuffSize);
+
+		// 连接断开后按设置重连，成功后重新初始化
+		do
+		{
+			// 通知服务端初始化
+			Hello();
+
+			OnEventCallback(this, ENetEvent::Ready, "");
+
+			ReadSocket(szBuff);
+		} while (Reconnect());
+
+		CBufferPool::Free(szBuff, nBuffCapacity);
+
+		OnEventCallback(this, ENetEvent::Quit, "");
+	}
+
+	void CTinyClient::ReadSocket(char* n_szBuff)
+	{
+		int nResult = 0;
+		SockaddrLen	nLen = sizeof(stSockaddrIn);
+
+		bool bBatch = false;
+#if !defined(_WIN32) && !defined(_WIN64)
+#if defined(TINYNET_IO_URING)
+		// io_uring 接收
+		bBatch = m_pRing != nullptr;
+		if (bBatch) ReadRing();
+#endif
+		// UDP 批量接收
+		if (!bBatch && eNetType == ENetType::UDP)
+		{
+			bBatch = true;
+			ReadDatagrams(n_szBuff);
+		}
+#endif
+
+		while (!bBatch)
+		{
+			if (eNetType == ENetType::TCP) WaitCallbacks();
+			memset(n_szBuff, 0, m_nBuffSize);
+
+			if (eNetType == ENetType::TCP)
 			{
-				DebugLog("IO Pending 错误 : %d", LastError());
+#if !defined(_WIN32) && !defined(_WIN64)
+				if (m_pTrace) nResult = (int)RecvStamped(fd, n_szBuff, m_nBuffSize, 0);
+				else
+#endif
+				nResult = recv(fd, n_szBuff, m_nBuffSize, 0);
+			}
+			else if (eNetType == ENetType::UDP)
+			{
+				nResult = recvfrom(fd, n_szBuff, m_nBuffSize, 0,
+					(stSockaddr*)Addr, &nLen);
+			}
+
+			if (nResult == 0) break;
+			if (nResult == SOCKET_ERROR)
+			{
+				// 操作被中断，重新尝试或执行其他操作
+#if defined(_WIN32) || defined(_WIN64)
+				if (WSAEINTR == LastError()) continue;
+#else
+				if (EINTR == LastError()) continue;
+#endif
+				if (m_bRun) DebugTrace("socket quit\n");
 				break;
 			}
+
+			ReceiveTcpMessage(this, sCache, n_szBuff, nResult);
+			ReceiveUdpMessage(this, n_szBuff, nResult);
 		}
 	}
 
-	bool CTinyServer::CreateWorkerThread()
+#if !defined(_WIN32) && !defined(_WIN64)
+	void CTinyClient::ReadDatagrams(char* n_szBuff)
 	{
-		auto nNum = GetCpuNum() * 2;
-		m_threads = new std::thread[nNum];
+		FRecvBatch Batch(n_szBuff, DatagramBuffSize(), m_nRecvBatch);
 
-		for (unsigned int i = 0; i < nNum; i++)
+		while (true)
 		{
-			m_threads[i] = std::thread(&CTinyServer::WorkerThread, this);
+			// 阻塞至少接收一个数据报，并取出已到达的其他数据报
+			auto nCount = Batch.Recv(fd, MSG_WAITFORONE);
+			if (nCount <= 0)
+			{
+				if (m_bRun) DebugTrace("socket quit\n");
+				break;
+			}
+
+			auto nDrops = Batch.ForEach(nCount, [&](int i, const char* n_szData, int n_nSize) {
+				memcpy(Addr, &Batch.Addrs[i], sizeof(stSockaddrIn));
+				ReceiveUdpMessage(this, n_szData, n_nSize);
+			});
+			if (nDrops > 0) AddStat(this, ENetStat::Drops, nDrops);
 		}
+	}
 
-		return true;
+#if defined(TINYNET_IO_URING)
+	void CTinyClient::ReadRing()
+	{
+		auto pRing = m_pRing;
+
+		struct msghdr Msg;
+		InitRingMsg(&Msg);
+		auto pMsg = eNetType == ENetType::UDP ? &Msg : nullptr;
+
+		bool bQuit = !pRing->Enable() || !PrepRecv(pRing, fd, pMsg, RingData(nullptr, ERingOp::Recv));
+		// UDP 的 shutdown 不会结束非阻塞的接收，监听 POLLRDHUP 退出
+		if (pMsg && !bQuit) bQuit = !PrepPoll(pRing, (int)fd, POLLRDHUP, RingData(nullptr, ERingOp::Wake));
+
+		while (!bQuit)
+		{
+			// 等待期间内核继续接收，直到接收缓存用尽
+			if (!pMsg) WaitCallbacks();
+			if (pRing->Submit(1) < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) break;
+
+			pRing->ForEachCqe([&](const struct io_uring_cqe* n_pCqe) {
+				if (bQuit) return;
+
+				// Socket 已 shutdown
+				auto nResult = RingOp(n_pCqe->user_data) == ERingOp::Wake ? 0 : n_pCqe->res;
+				if (nResult > 0 && (n_pCqe->flags & IORING_CQE_F_BUFFER))
+				{
+					auto nBid = (unsigned short)(n_pCqe->flags >> IORING_CQE_BUFFER_SHIFT);
+					auto szBuff = pRing->GetBuffer(nBid);
+
+					if (pMsg)
+					{
+						auto nDrops = ForEachRingDatagram(szBuff, nResult, pMsg,
+							[&](const char* n_szAddr, const char* n_szData, int n_nSize) {
+							memcpy(Addr, n_szAddr, sizeof(stSockaddrIn));
+							ReceiveUdpMessage(this, n_szData, n_nSize);
+						});
+						if (nDrops > 0) AddStat(this, ENetStat::Drops, nDrops);
+					}
+					else ReceiveTcpMessage(this, sCache, szBuff, nResult);
+
+					pRing->RecycleBuffer(nBid);
+				}
+				// 接收缓存用尽时重新提交，其他为 Socket 关闭
+				else if (nResult != -ENOBUFS)
+				{
+					if (m_bRun) DebugTrace("socket quit\n");
+					bQuit = true;
+					return;
+				}
+
+				if (n_pCqe->flags & IORING_CQE_F_MORE) return;
+				bQuit = !IsValid() || !PrepRecv(pRing, fd, pMsg, RingData(nullptr, ERingOp::Recv));
+			});
+		}
+
+		// 取消未结束的请求后释放
+		m_pRing = nullptr;
+		pRing->Exit();
+		delete pRing;
 	}
+#endif
+#endif
 
-	void CTinyServer::WorkerThread()
+	void CTinyClient::OnHeartTimer()
 	{
-		BOOL	bResult = FALSE;
-		int		nResult = 0;
-		DWORD	nRecvBytes = 0;
+		if (!m_bRun || m_nHeartPeriod == 0) return;
 
-		FIOCPNetNode* 	pCompletionKey = nullptr;
-		FNetHandle* 	pSocketInfo = nullptr;
+		// 正在重连
+		if (!IsValid()) return;
 
-		while (true)
+		// 未接收到返回心跳，默认连接异常，退出
+		if (m_nHeartNo == m_nHeartSent)
 		{
-			bResult = GetQueuedCompletionStatus(m_hIocp,
-				&nRecvBytes,
-				(PULONG_PTR)&pCompletionKey,		// completion key
-				(LPOVERLAPPED*)&pSocketInfo,		// overlapped I/O
-				INFINITE
+			if (m_nHeartFail >= m_nHeartTimeoutCnt)
+			{
+				HeartLost();
+				return;
+			}
+			m_nHeartFail++;
+		}
+		else m_nHeartFail = 0;
+
+		// 无法发送心跳，停止
+		if (Heart(m_nHeartNo, m_nHeartFail) < 0)
+		{
+			HeartLost();
+			return;
+		}
+
+		m_nHeartSent = m_nHeartNo;
+	}
+
+	void CTinyClient::HeartLost()
+	{
+		// 在定时器线程中不调用 Stop，工作线程可能正在 Stop 中等待本次心跳完成；
+		// 断开连接，由工作线程重连，或不重连时退出并触发 Quit 事件
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (!IsValid()) return;
+		if (m_nReconnectMin == 0) m_bRun = false;
+#if defined(_WIN32) || defined(_WIN64)
+		shutdown(fd, SD_BOTH);
+#else
+		shutdown(fd, SHUT_RDWR);
+#endif
+	}
+
+	void CTinyClient::WaitCallbacks()
+	{
+		if (!m_pExecutor || m_nMaxPending == 0) return;
+
+		auto nKey = CallbackKey(this);
+		if (m_pExecutor->Pending(nKey) < m_nMaxPending) return;
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_cvBacklog.wait(lock, [this, nKey]() {
+			return !m_bRun || m_pExecutor->Pending(nKey) <= m_nMaxPending / 2;
+		});
+	}
+
+	void CTinyClient::OnCallbackDrained(const unsigned long long /*n_nKey*/)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_cvBacklog.notify_all();
+	}
+
+	void CTinyClient::Join()
+	{
+		if (!m_thread.joinable()) return;
+
+		// 在工作线程的回调中调用 Stop
+		if (m_thread.get_id() == std::this_thread::get_id()) m_thread.detach();
+		else m_thread.join();
+	}
+
+	bool CTinyClient::OnEventMessage(FNetNode* n_pNetNode, const char* n_szData, const int n_nSize)
+	{
+		bool bResult = true;
+
+		FNetBuffer NetBuffer;
+		if (!NetBuffer.PointTo(n_szData, n_nSize)) return false;
+		auto nEventId = NetBuffer.GetEventId();
+
+		switch (nEventId)
+		{
+		case kHelloId:
+		{
+			// 获取远端 sockaddr
+			memcpy(m_szRemoteAddr, NetBuffer.GetData(), SOCKADDR_SIZE);
+			// 连接可用，重置重连次数及延时
+			m_nReconnectCnt = 0;
+			m_nReconnectDelay = 0;
+
+			OnEventCallback(n_pNetNode, ENetEvent::Hello, 
+				std::string(m_szRemoteAddr, SOCKADDR_SIZE));
+		}
+		break;
+		case kHeartId:
+		{
+			auto pHeart = (FHeart*)NetBuffer.GetData();
+
+			char szBuff[sizeof(unsigned int) * 2] = { 0 };
+			auto nNo = ntohl(pHeart->No);
+			auto nCnt = ntohl(pHeart->Cnt);
+			memcpy(szBuff, &nNo, sizeof(unsigned int));
+			memcpy(szBuff + sizeof(unsigned int), &nCnt, sizeof(unsigned int));
+
+			OnEventCallback(n_pNetNode, ENetEvent::Heart,
+				// 心跳序号及失败次数
+				std::string(szBuff, sizeof(unsigned int) * 2)
 			);
 
-			if (!pCompletionKey || !pSocketInfo) break;
-
-			pSocketInfo->DataBuf.len = nRecvBytes;
-
-			if (!bResult || nRecvBytes == 0)
+			// 服务端发的心跳包需回消息
+			if (pHeart->Sender != (unsigned int)fd)
 			{
-				if (eNetType == ENetType::TCP) FreeSocketNode(&pSocketInfo->NetNode);
-				continue;
+				pHeart->No = htonl(nNo + 1);
+				n_pNetNode->Send(NetBuffer);
 			}
 			else
 			{
-				ReceiveTcpMessage(pSocketInfo->NetNode, 
-					pSocketInfo->NetNode->sCache, pSocketInfo->Buffer, nRecvBytes);
-				ReceiveUdpMessage(pSocketInfo->NetNode, pSocketInfo->Buffer, nRecvBytes);
-
-				memset(&(pSocketInfo->Overlapped), 0, sizeof(OVERLAPPED));
-				pSocketInfo->DataBuf.len = m_nBuffSize;
-				pSocketInfo->DataBuf.buf = pSocketInfo->Buffer;
-				memset(pSocketInfo->Buffer, 0, m_nBuffSize);
-
-				nResult = PostRecv(pSocketInfo->NetNode);
-
-				if (nResult == SOCKET_ERROR && LastError() != WSA_IO_PENDING)
-				{
-					DebugLog("WSARecv 错误 : %d", LastError());
-				}
+				m_nHeartNo = nNo;
 			}
 		}
-	}
-
-	int CTinyServer::PostRecv(FNetNode* n_pNetNode)
-	{
-		int	nResult = 0;
-		if (!n_pNetNode) return nResult;
-
-		auto pNetNode = (FIOCPNetNode*)n_pNetNode;
-		if (!pNetNode->Handle) return nResult;
-
-		DWORD	dwFlags = 0;
-		DWORD	nRecvBytes = 0;
-
-		if (eNetType == ENetType::TCP)
-		{
-			nResult = WSARecv(
-				pNetNode->fd,
-				&pNetNode->Handle->DataBuf,
-				1,
-				(LPDWORD)&nRecvBytes,
-				&dwFlags,
-				&(pNetNode->Handle->Overlapped),
-				nullptr
-			);
-		}
-		else if (eNetType == ENetType::UDP)
-		{
-			SockaddrLen nLen = sizeof(stSockaddrIn);
-			nResult = WSARecvFrom(
-				pNetNode->fd,
-				&pNetNode->Handle->DataBuf,
-				1,
-				(LPDWORD)&nRecvBytes,
-				&dwFlags,
-				(stSockaddr*)pNetNode->Addr,
-				&nLen,
-				&(pNetNode->Handle->Overlapped),
-				nullptr
-			);
+		break;
+		case kQuitId:
+			QuitEvent();
+			// 工作线程退出后，会触发退出事件，这里无需发送退出事件
+			break;
+		default:
+			bResult = false;
+			break;
 		}
 
-		return nResult;
+		return bResult;
 	}
 
-	void* CTinyServer::AllocSocketNode(size_t n_fd, const stSockaddrIn* n_Addr)
+	void CTinyClient::QuitEvent()
 	{
-		auto NetNode = new FIOCPNetNode;
-		if (!NetNode) return nullptr;
+		// 与重连互斥，避免关闭正在替换的 Socket
+		std::unique_lock<std::mutex> lock(m_mutex);
 
-		NetNode->Handle = (FNetHandle*)malloc(sizeof(FNetHandle));
-		if (!NetNode->Handle)
-		{
-			delete NetNode;
-			return nullptr;
-		}
+		// 通知服务端退出
+		Quit();
 
-		NetNode->Handle->NetNode = NetNode;
+		m_bRun = false;
+		m_nHeartNo = 0;
+		m_nHeartPeriod = 0;
 
-		NetNode->fd = n_fd;
-		NetNode->Init(eNetType, n_Addr);
-		NetNode->UserData = nullptr;
-		memset(&(NetNode->Handle->Overlapped), 0, sizeof(OVERLAPPED));
+#if !defined(_WIN32) && !defined(_WIN64)
+		// 唤醒阻塞在 recv 的工作线程，Linux 下仅 close 不会使其返回
+		if (IsValid()) shutdown(fd, SHUT_RDWR);
+#endif
+		// 关闭Socket
+		CloseSocket(fd);
+	}
 
-		// 分配接收数据缓存
-		NetNode->Handle->Buffer = (char*)malloc(m_nBuffSize);
-		if (NetNode->Handle->Buffer) memset(NetNode->Handle->Buffer, 0, m_nBuffSize);
-		NetNode->Handle->DataBuf.len = m_nBuffSize;
-		NetNode->Handle->DataBuf.buf = NetNode->Handle->Buffer;
+#pragma endregion
 
-		std::unique_lock<std::mutex> lock(m_mutex);
-		m_lstNodes.push_back(NetNode);
+	////////////////////////////////////////////////////////////////////////////////
+#pragma region 客户端连接池
+#if !defined(_WIN32) && !defined(_WIN64)
+	struct FPoolServer
+	{
+		char			Addr[SOCKADDR_SIZE] = { 0 };
+		// 连接数(含正在连接的)
+		std::atomic<unsigned int> nConnections;
+		// 所有连接的未完成请求数
+		std::atomic<unsigned int> nOutstanding;
+		// 连续连接失败次数
+		std::atomic<unsigned int> nFailures;
+
+		FPoolServer() : nConnections(0), nOutstanding(0), nFailures(0) {}
+	};
 
-		return NetNode;
-	}
+	struct FPoolNetNode : public FEpollNetNode
+	{
+		FPoolServer*	Server = nullptr;
+		// 在所属 Reactor 中的索引
+		unsigned long long nKey = 0;
+		// 连接是否已建立
+		bool			bConnected = false;
+		// 服务端通知退出，读取完成后关闭
+		bool			bQuit = false;
+		// 连接超时定时器
+		CTimerWheel::Id	nConnectTimer = 0;
+		// 未完成请求数
+		std::atomic<unsigned int> nOutstanding;
+		// 引用数，所属 Reactor 持有一个，Send 在解锁后发送期间持有一个
+		std::atomic<unsigned int> nRefs;
+
+		// 心跳序号
+		unsigned int	nHeartNo = 0;
+		// 最近发送的心跳序号
+		unsigned int	nHeartSent = 0xFFFFFFFF;
+		// 心跳连续失败次数
+		unsigned int	nHeartFail = 0;
+
+		FPoolNetNode() : nOutstanding(0), nRefs(1) {}
+	};
 
-	void CTinyServer::FreeSocketNode(FNetNode** n_pNetNode)
+	// 释放连接池节点的引用，最后一个引用释放时关闭 Socket 并释放节点
+	static void ReleasePoolNode(FPoolNetNode* n_pNetNode)
 	{
-		if (!n_pNetNode || !*n_pNetNode) return;
-
-		auto pNetNode = (FIOCPNetNode*)(*n_pNetNode);
-		if (!pNetNode->Handle) return;
-
-		// 抛出退出事件
-		OnEventCallback(*n_pNetNode, ENetEvent::Quit, "");
+		if (--n_pNetNode->nRefs > 0) return;
 
-		{
-			std::unique_lock<std::mutex> lock(m_mutex);
-			m_lstNodes.remove(*n_pNetNode);
-		}
+		CloseSocket(n_pNetNode->fd);
+		delete n_pNetNode->SendQueue;
+		delete n_pNetNode;
+	}
 
-		CloseSocket(pNetNode->fd);
-		free(pNetNode->Handle->Buffer);
-		free(pNetNode->Handle);
-		delete pNetNode;
-		*n_pNetNode = nullptr;
+	CTinyClientPool::CTinyClientPool()
+	{
 	}
 
-	void CTinyServer::FreeSocketNodes()
+	CTinyClientPool::~CTinyClientPool()
 	{
-		std::unique_lock<std::mutex> lock(m_mutex);
+		Stop();
+	}
 
-		auto it = m_lstNodes.begin();
-		while (it != m_lstNodes.end())
+	bool CTinyClientPool::Start()
+	{
+		if (m_bRun) return false;
+		if (eNetType != ENetType::TCP)
 		{
-			auto pNetNode = (FIOCPNetNode*)(*it);
-			m_lstNodes.erase(it++);
-
-			CloseSocket(pNetNode->fd);
-			free(pNetNode->Handle->Buffer);
-			free(pNetNode->Handle);
-			delete pNetNode;
+			DebugLog("client pool only supports TCP\n");
+			return false;
 		}
-	}
-#else
 
-	bool CTinyServer::InitSock()
-	{
-		int nSockType = NetType2SockType(eNetType);
-		if (nSockType == 0) return false;
+		StartCallbacks();
 
 		do
 		{
-			m_bRun = false;
+			auto pServer = new FPoolServer;
+			memcpy(pServer->Addr, Addr, SOCKADDR_SIZE);
+			m_vecServers.push_back(pServer);
 
-			fd = socket(AF_INET, nSockType, 0);
-			if (fd == -1)
+			for (auto& sAddr : m_vecAddrs)
 			{
-				DebugError("create Socket error");
-				break;
+				pServer = new FPoolServer;
+				memcpy(pServer->Addr, sAddr.data(), SOCKADDR_SIZE);
+				m_vecServers.push_back(pServer);
 			}
 
-			SetSocketTTL(fd, IP_TTL, (unsigned char)m_nTTL);
-			SetSocketSendTimeout(fd, m_nTimeout);
-			SetSocketRecvTimeout(fd, m_nTimeout);
-			SetSocketReuseAddr(fd, 1);
+			m_nReactorCnt = m_nReactorNum > 0 ? m_nReactorNum : GetCpuNum();
+			if (m_nReactorCnt == 0) m_nReactorCnt = 1;
 
-			auto nResult = bind(fd, (stSockaddr*)Addr, sizeof(stSockaddr));
-			if (nResult == -1)
-			{
-				DebugError("bind Socket error");
-				break;
-			}
+			m_pReactors = new FReactor[m_nReactorCnt];
+			// io_uring 只用于服务端及单连接客户端
+			m_bUring = false;
 
-			if (eNetType == ENetType::TCP)
+			unsigned int i = 0;
+			for (; i < m_nReactorCnt; i++)
 			{
-				nResult = listen(fd, SOMAXCONN);
-				if (nResult == -1)
+				auto pReactor = &m_pReactors[i];
+
+				pReactor->nWakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+				if (pReactor->nWakeFd == -1)
 				{
-					DebugError("listen Socket error");
+					DebugError("create eventfd error");
 					break;
 				}
-			}
 
-			m_nEpfd = epoll_create(1);
-			if (m_nEpfd == -1)
-			{
-				DebugError("create EPoll error");
-				break;
+				pReactor->nEpfd = epoll_create1(EPOLL_CLOEXEC);
+				if (pReactor->nEpfd == -1)
+				{
+					DebugError("create EPoll error");
+					break;
+				}
+
+				// 唤醒事件，data.ptr 为空
+				struct epoll_event ev;
+				ev.data.ptr = nullptr;
+				ev.events = EPOLLIN;
+				if (epoll_ctl(pReactor->nEpfd, EPOLL_CTL_ADD, pReactor->nWakeFd, &ev) == -1)
+				{
+					DebugError("Add EPoll eventl error");
+					break;
+				}
 			}
+			if (i < m_nReactorCnt) break;
 
-			/** 添加Epoll事件. */
-			nResult = AddSocketIntoPoll(this);
-			if (nResult == -1)
+			m_bRun = true;
+
+			for (i = 0; i < m_nReactorCnt; i++)
 			{
-				DebugError("Add EPoll eventl error");
-				break;
+				auto pReactor = &m_pReactors[i];
+				pReactor->Thread = std::thread(&CTinyClientPool::WorkerThread, this, pReactor);
 			}
 
-			std::thread(&CTinyServer::WorkerThread, this).detach();
-
 			OnEventCallback(this, ENetEvent::Ready, "");
-
-			m_bRun = true;
-
 		} while (false);
 
-		if (!m_bRun) CloseSocket(fd);
+		if (!m_bRun)
+		{
+			StopCallbacks();
+			FreeReactors();
+		}
 
 		return m_bRun;
 	}
 
-	void CTinyServer::WorkerThread()
+	void CTinyClientPool::Stop()
 	{
-		if (m_nEpfd == 0) return;
+		if (!m_pReactors) return;
+		ITinyNet::Stop();
 
-		int					nResult = 0;
-		struct epoll_event	Event[EPOLL_SIZE];
+		m_bRun = false;
+		// 执行完已投递的回调，再退出所有 Reactor 线程
+		StopCallbacks();
+		FreeReactors();
 
-		stSockaddrIn		RemoteAddr = { 0 };
-		SockaddrLen			nLen = sizeof(stSockaddrIn);
+		OnEventCallback(this, ENetEvent::Quit, "");
+	}
 
-		std::string 		sData;
+	void CTinyClientPool::EnableHeart(unsigned int n_nPeriod, unsigned int n_nTimeoutCnt)
+	{
+		m_nHeartPeriod = n_nPeriod;
+		m_nHeartTimeoutCnt = n_nTimeoutCnt;
+	}
 
-		char* szBuff = (char*)malloc(m_nBuffSize);
-		if (!szBuff) return;
-		memset(szBuff, 0, m_nBuffSize);
+	void CTinyClientPool::AddServer(const std::string& n_sHost, const unsigned short n_nPort)
+	{
+		char szAddr[SOCKADDR_SIZE] = { 0 };
+		BuildSockAddrIn(szAddr, n_sHost, n_nPort);
 
-		while (true)
+		m_vecAddrs.push_back(std::string(szAddr, SOCKADDR_SIZE));
+	}
+
+	void CTinyClientPool::SetReactorNum(const unsigned int n_nNum, const EBalance n_eBalance)
+	{
+		m_nReactorNum = n_nNum;
+		m_eBalance = n_eBalance;
+	}
+
+	int CTinyClientPool::Connect(const unsigned int n_nCount)
+	{
+		if (!m_bRun) return -1;
+
+		int nResult = 0;
+		for (unsigned int i = 0; i < n_nCount && m_bRun; i++)
 		{
-			// nCount表示就绪事件的数目
-			int nCount = epoll_wait(m_nEpfd, Event, EPOLL_SIZE, -1);
-			if (nCount < 0)
+			int nFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+			if (nFd == SOCKET_ERROR)
 			{
-				if (m_bRun) DebugError("epoll_wait error");
+				DebugLog("create Socket error: %d\n", LastError());
 				break;
 			}
 
-			for (int i = 0; i < nCount; ++i)
-			{
-				if (!(Event[i].events & EPOLLIN)) continue;
+			SetSocketTTL(nFd, IP_TTL, (unsigned char)m_nTTL);
+			SetSocketKeepAlive(nFd, 1);
+			if (m_pTrace) SetSocketTimestamping(nFd, false);
 
-				// 新用户连接
-				auto pNetNode = (FNetNode*)Event[i].data.ptr;
-				if (pNetNode->fd == fd && eNetType == ENetType::TCP)
-				{
-					int nFd = accept(fd, (stSockaddr*)&RemoteAddr, &nLen);
-					if (nFd == -1)
-					{
-						DebugError("accept error");
-						continue;
-					}
+			auto pNetNode = new FPoolNetNode;
+			pNetNode->fd = nFd;
+			pNetNode->Counters = Counters;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				pNetNode->Server = SelectServer();
+				pNetNode->Reactor = &m_pReactors[m_nNextReactor++ % m_nReactorCnt];
+				pNetNode->nKey = ++m_nNextKey;
+			}
+			pNetNode->Init(eNetType, (const stSockaddrIn*)pNetNode->Server->Addr);
 
-					auto RemoteNetNode = new FNetNode;
-					if (!RemoteNetNode) continue;
-					KeepAlive(nFd);
+			// 立即返回 EINPROGRESS，可写时连接完成
+			if (connect(nFd, (stSockaddr*)pNetNode->Addr, sizeof(stSockaddr)) == SOCKET_ERROR
+				&& errno != EINPROGRESS)
+			{
+				DebugLog("connect Socket error: %d\n", LastError());
+				pNetNode->Server->nFailures++;
+				ReleasePoolNode(pNetNode);
+				continue;
+			}
 
-					RemoteNetNode->fd = nFd;
-					RemoteNetNode->Init(ENetType::TCP, &RemoteAddr);
+			pNetNode->Server->nConnections++;
 
-					{
-						std::unique_lock<std::mutex> lock(m_mutex);
-						m_lstNodes.push_back(RemoteNetNode);
-					}
+			// 连接完成前监听 EPOLLOUT，发送的数据进入队列
+			pNetNode->SendQueue = CreateSendQueue(pNetNode);
+			pNetNode->SendQueue->nEvents = EPOLLIN;
+			pNetNode->SendQueue->bWaitWrite = true;
 
-					// 把这个新的客户端添加到内核事件列表
-					AddSocketIntoPoll(RemoteNetNode);
+			PostToReactor(pNetNode->Reactor, std::bind(&CTinyClientPool::AttachConnection, this, pNetNode));
+			nResult++;
+		}
 
-					OnEventCallback(RemoteNetNode, ENetEvent::Accept, "");
-				}
-				else
-				{
-					// 客户端唤醒, 处理用户发来的消息
-					memset(szBuff, 0, m_nBuffSize);
+		return nResult;
+	}
 
-					if (eNetType == ENetType::TCP)
-						nResult = recv(pNetNode->fd, szBuff, m_nBuffSize, 0);
-					else if (eNetType == ENetType::UDP)
-					{
-						nResult = recvfrom(pNetNode->fd, szBuff, m_nBuffSize, 0,
-							(stSockaddr*)pNetNode->Addr, &nLen);
-					}
+	int CTinyClientPool::Send(const char* n_szData, const int n_nSize)
+	{
+		FPoolNetNode* pNetNode = nullptr;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
 
-					if (nResult <= 0)
-					{
-						if (eNetType == ENetType::TCP) FreeSocketNode(&pNetNode);
-						if (m_bRun) DebugLog("socket quit");
-						continue;
-					}
+			pNetNode = (FPoolNetNode*)SelectConnection();
+			if (!pNetNode) return SOCKET_ERROR;
 
-					ReceiveTcpMessage(pNetNode, pNetNode->sCache, szBuff, nResult);
-					ReceiveUdpMessage(pNetNode, szBuff, nResult);
-				}
-			}
+			// 节点在从 m_Nodes 移除后才释放，持有锁时增加引用
+			pNetNode->nRefs++;
+			pNetNode->nOutstanding++;
+			pNetNode->Server->nOutstanding++;
 		}
-	}
 
-	void CTinyServer::SetEt(const bool et)
-	{
-		m_bEt = et;
+		// 解锁后发送，可写状态改变时可能在当前线程回调，回调中可再调用连接池的接口
+		int nResult = pNetNode->Send(n_szData, n_nSize);
+		ReleasePoolNode(pNetNode);
+
+		return nResult;
 	}
 
-	int CTinyServer::SetNonblock(int n_nFd)
+	int CTinyClientPool::Send(const std::string& n_sData)
 	{
-		/** 设置为非阻塞. */
-		int nFlag = fcntl(n_nFd, F_GETFL, 0);
-		nFlag |= O_NONBLOCK;
-
-		return fcntl(n_nFd, F_SETFL, nFlag);
+		return Send(n_sData.c_str(), (int)n_sData.size());
 	}
 
-	int CTinyServer::AddSocketIntoPoll(FNetNode* n_pNetNode)
+	std::vector<FNetNode*> CTinyClientPool::GetConnections()
 	{
-		if (!n_pNetNode->IsValid()) return -1;
-
-		struct epoll_event ev;
-		ev.data.ptr = n_pNetNode;
-		ev.events = EPOLLIN;
-		if (m_bEt) ev.events = EPOLLIN | EPOLLET;
+		std::unique_lock<std::mutex> lock(m_mutex);
+		return m_Nodes.Values();
+	}
 
-		int nRet = epoll_ctl(m_nEpfd, EPOLL_CTL_ADD, n_pNetNode->fd, &ev);
-		if (nRet == -1) return nRet;
+	FNetNode* CTinyClientPool::GetConnection(const unsigned long long n_nId)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
 
-		return SetNonblock(n_pNetNode->fd);
+		auto ppNetNode = m_Nodes.Find(n_nId);
+		return ppNetNode ? *ppNetNode : nullptr;
 	}
 
-	int CTinyServer::DelSocketFromPoll(int n_nFd)
+	const size_t CTinyClientPool::GetConnectionCount()
 	{
-		if (m_nEpfd == 0) return -1;
-		return epoll_ctl(m_nEpfd, EPOLL_CTL_DEL, n_nFd, NULL);
+		std::unique_lock<std::mutex> lock(m_mutex);
+		return m_Nodes.Size();
 	}
 
-	void CTinyServer::FreeSocketNode(FNetNode** n_pNetNode)
+	FPoolServer* CTinyClientPool::SelectServer()
 	{
-		if (!n_pNetNode || !*n_pNetNode) return;
+		if (m_eBalance != EBalance::LeastOutstanding)
+			return m_vecServers[m_nNextServer++ % m_vecServers.size()];
 
-		auto pNetNode = *n_pNetNode;
+		// 优先连续失败次数少的服务端，其次未完成请求最少，再次连接最少
+		auto pServer = m_vecServers[0];
+		for (size_t i = 1; i < m_vecServers.size(); i++)
 		{
-			std::unique_lock<std::mutex> lock(m_mutex);
-			m_lstNodes.remove(pNetNode);
+			auto pOther = m_vecServers[i];
+			unsigned int nFailures = pOther->nFailures, nMinFailures = pServer->nFailures;
+			unsigned int nOutstanding = pOther->nOutstanding, nMin = pServer->nOutstanding;
+			if (nFailures != nMinFailures)
+			{
+				if (nFailures < nMinFailures) pServer = pOther;
+				continue;
+			}
+			if (nOutstanding < nMin || (nOutstanding == nMin && pOther->nConnections < pServer->nConnections))
+				pServer = pOther;
 		}
 
-		DelSocketFromPoll(pNetNode->fd);
-		CloseSocket(pNetNode->fd);
-		delete pNetNode;
-		*n_pNetNode = nullptr;
+		return pServer;
 	}
 
-	void CTinyServer::FreeSocketNodes()
+	FNetNode* CTinyClientPool::SelectConnection()
 	{
-		std::unique_lock<std::mutex> lock(m_mutex);
+		auto nSize = m_Nodes.Size();
+		if (nSize == 0) return nullptr;
 
-		auto it = m_lstNodes.begin();
-		while (it != m_lstNodes.end())
-		{
-			auto pNetNode = *it;
-			m_lstNodes.erase(it++);
+		auto& Nodes = m_Nodes.Values();
+		if (m_eBalance != EBalance::LeastOutstanding) return Nodes[m_nNextNode++ % nSize];
 
-			DelSocketFromPoll(pNetNode->fd);
-			CloseSocket(pNetNode->fd);
-			delete pNetNode;
-		}
+		// 随机选取两个连接，比较未完成请求数(power of two choices)，避免每次遍历所有连接
+		m_nSeed ^= m_nSeed << 13;
+		m_nSeed ^= m_nSeed >> 7;
+		m_nSeed ^= m_nSeed << 17;
+
+		auto pFirst = (FPoolNetNode*)Nodes[(size_t)(m_nSeed % nSize)];
+		auto pSecond = (FPoolNetNode*)Nodes[(size_t)((m_nSeed >> 32) % nSize)];
+
+		return pSecond->nOutstanding < pFirst->nOutstanding ? pSecond : pFirst;
 	}
-#endif
 
-	bool CTinyServer::OnEventMessage(FNetNode* n_pNetNode, const char* n_szData, const int n_nSize)
+	void CTinyClientPool::WorkerThread(FReactor* n_pReactor)
 	{
-		bool bResult = true;
+		// 在回调中调用 Stop 时 Reactor 已释放，定时器及其连接由线程持有
+		CTimerWheel Timers;
+		n_pReactor->Timers = &Timers;
+		std::vector<FNetNode*> Orphans;
+		n_pReactor->Orphans = &Orphans;
 
-		FNetBuffer NetBuffer;
-		if (!NetBuffer.PointTo(n_szData, n_nSize)) return false;
-		auto nEventId = NetBuffer.GetEventId();
+		if (m_nHeartPeriod > 0)
+			Timers.Schedule(m_nHeartPeriod, m_nHeartPeriod, std::bind(&CTinyClientPool::SendHearts, this, n_pReactor));
 
-		switch (nEventId)
-		{
-		case kHelloId:
-		{
-			OnEventCallback(n_pNetNode, ENetEvent::Hello, "");
+		struct epoll_event	Event[EPOLL_SIZE];
 
-			// 返回客户端对应的远端 sockaddr
-			NetBuffer.SetData(n_pNetNode->Addr, SOCKADDR_SIZE);
-			NetBuffer.SetEventId(kHelloId);
+		size_t nBuffCapacity = 0;
+		char* szBuff = CBufferPool::Alloc(m_nBuffSize, nBuffCapacity);
+		if (!szBuff) return;
 
-			n_pNetNode->Send(NetBuffer);
-		}
-		break;
-		case kHeartId:
+		while (m_bRun)
 		{
-			auto pHeart = (FHeart*)NetBuffer.GetData();
+			int nCount = epoll_wait(n_pReactor->nEpfd, Event, EPOLL_SIZE, Timers.NextTimeout());
+			if (nCount < 0)
+			{
+				if (errno == EINTR) continue;
+				if (m_bRun) DebugError("epoll_wait error");
+				break;
+			}
 
-			char szBuff[sizeof(unsigned int) * 2] = { 0 };
-			auto nNo = ntohl(pHeart->No);
-			auto nCnt = ntohl(pHeart->Cnt);
-			memcpy(szBuff, &nNo, sizeof(unsigned int));
-			memcpy(szBuff + sizeof(unsigned int), &nCnt, sizeof(unsigned int));
+			for (int i = 0; i < nCount && m_bRun; ++i)
+			{
+				auto pNetNode = (FPoolNetNode*)Event[i].data.ptr;
 
-			OnEventCallback(n_pNetNode, ENetEvent::Heart,
-				// 心跳序号及失败次数
-				std::string(szBuff, sizeof(unsigned int) * 2)
-			);
+				// 唤醒事件, 执行投递的任务
+				if (!pNetNode)
+				{
+					RunReactorTasks(n_pReactor);
+					continue;
+				}
 
-			// 客户端发的心跳包需回消息，否则通过事件处理后续逻辑
-			if (pHeart->Sender != (unsigned int)fd)
-			{
-				pHeart->No = htonl(nNo + 1);
-				n_pNetNode->Send(NetBuffer);
+				// 连接中的 Socket 可写或出错，表示连接完成
+				if (!pNetNode->bConnected)
+				{
+					OnConnected(n_pReactor, pNetNode);
+					continue;
+				}
+
+				// 可写, 发送队列中的数据
+				if (Event[i].events & EPOLLOUT)
+				{
+					if (FlushSendQueue(pNetNode->SendQueue) == SOCKET_ERROR)
+					{
+						FreeConnection(n_pReactor, pNetNode);
+						continue;
+					}
+				}
+
+				// 暂停读取，对端已关闭时仍读取剩余数据，避免重复通知
+				if (IsReadPaused(pNetNode) && !(Event[i].events & EPOLLHUP)) continue;
+				if (Event[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP))
+					ReadConnection(n_pReactor, pNetNode, szBuff);
 			}
+
+			if (m_bRun && !Timers.Empty()) Timers.Advance();
 		}
-		break;
-		case kQuitId:
+
+		CBufferPool::Free(szBuff, nBuffCapacity);
+
+		for (auto pNetNode : Orphans) ReleasePoolNode((FPoolNetNode*)pNetNode);
+	}
+
+	void CTinyClientPool::AttachConnection(FNetNode* n_pNetNode)
+	{
+		auto pNetNode = (FPoolNetNode*)n_pNetNode;
+		auto pReactor = pNetNode->Reactor;
+
+		// 已停止，Stop 中执行剩余的任务
+		if (!m_bRun)
 		{
-			OnEventCallback(n_pNetNode, ENetEvent::Quit, "");
+			ReleasePoolNode(pNetNode);
+			return;
 		}
-		break;
-		default:
-			bResult = false;
-			break;
+
+		pNetNode->SendQueue->nEpfd = pReactor->nEpfd;
+
+		struct epoll_event ev;
+		ev.data.ptr = pNetNode;
+		ev.events = EPOLLIN | EPOLLOUT;
+		if (epoll_ctl(pReactor->nEpfd, EPOLL_CTL_ADD, pNetNode->fd, &ev) == -1)
+		{
+			DebugError("Add EPoll eventl error");
+			pNetNode->Server->nConnections--;
+			OnEventCallback(pNetNode, ENetEvent::Quit, "");
+			RetireNode(pNetNode, std::bind(ReleasePoolNode, pNetNode));
+			return;
 		}
 
-		return bResult;
-	}
+		pReactor->Peers.Insert(pNetNode->nKey, pNetNode);
+		pReactor->nConnections++;
 
-#pragma endregion
+		if (m_nTimeout <= 0) return;
 
+		// 以索引查找，定时器触发时连接可能已释放
+		auto nKey = pNetNode->nKey;
+		pNetNode->nConnectTimer = pReactor->Timers->Schedule(m_nTimeout, 0, [this, pReactor, nKey]() {
+			auto ppNetNode = pReactor->Peers.Find(nKey);
+			if (!ppNetNode) return;
 
-	////////////////////////////////////////////////////////////////////////////////
-#pragma region 客户端
-	CTinyClient::CTinyClient()
-	{
-	}
+			auto pNetNode = (FPoolNetNode*)*ppNetNode;
+			pNetNode->nConnectTimer = 0;
+			if (pNetNode->bConnected) return;
 
-	CTinyClient::~CTinyClient()
-	{
-		Stop();
+			DebugLog("connect Socket timeout\n");
+			pNetNode->Server->nFailures++;
+			FreeConnection(pReactor, pNetNode);
+		});
 	}
 
-	bool CTinyClient::Start()
+	void CTinyClientPool::OnConnected(FReactor* n_pReactor, FNetNode* n_pNetNode)
 	{
-		if (IsValid()) return false;
+		auto pNetNode = (FPoolNetNode*)n_pNetNode;
 
-		return InitSock();
-	}
+		int nError = 0;
+		socklen_t nLen = sizeof(nError);
+		if (getsockopt(pNetNode->fd, SOL_SOCKET, SO_ERROR, &nError, &nLen) == -1) nError = errno;
+		if (nError != 0)
+		{
+			DebugLog("connect Socket error: %d\n", nError);
+			pNetNode->Server->nFailures++;
+			FreeConnection(n_pReactor, pNetNode);
+			return;
+		}
 
-	void CTinyClient::Stop()
-	{
-		if (!IsValid()) return;
+		pNetNode->bConnected = true;
+		pNetNode->Server->nFailures = 0;
+		if (pNetNode->nConnectTimer > 0)
+		{
+			n_pReactor->Timers->Cancel(pNetNode->nConnectTimer);
+			pNetNode->nConnectTimer = 0;
+		}
 
-		ITinyNet::Stop();
+		// 连接前进入队列的数据在可写时发送，否则取消监听 EPOLLOUT
+		{
+			auto pQueue = pNetNode->SendQueue;
+			std::unique_lock<std::mutex> lock(pQueue->Mutex);
+			WatchWritable(pQueue, pQueue->Pending() > 0);
+		}
 
-		QuitEvent();
-		Join();
-	}
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			pNetNode->Id = m_Nodes.Insert(pNetNode);
+		}
 
-	void CTinyClient::EnableHeart(unsigned int n_nPeriod, unsigned int n_nTimeoutCnt)
-	{
-		m_nHeartNo = 0;
-		m_nHeartPeriod = n_nPeriod;
-		m_nHeartTimeoutCnt = n_nTimeoutCnt;
-	}
+		// 获取在服务端的 sockaddr
+		pNetNode->Hello();
 
-	const unsigned short CTinyClient::RemotePort()
-	{
-		return SockaddrToPort(m_szRemoteAddr);
+		OnEventCallback(pNetNode, ENetEvent::Ready, "");
 	}
 
-	const std::string CTinyClient::RemoteIp()
+	void CTinyClientPool::ReadConnection(FReactor* n_pReactor, FNetNode* n_pNetNode, char* n_szBuff)
 	{
-		return SockaddrToIp(m_szRemoteAddr);
-	}
+		auto pNetNode = (FPoolNetNode*)n_pNetNode;
 
-	int CTinyClient::SendHeart()
-	{
-		return Heart(m_nHeartNo, 0);
+		// 水平触发，每次可读事件只读一次
+		auto nResult = m_pTrace ? RecvStamped(pNetNode->fd, n_szBuff, m_nBuffSize, 0) :
+			recv(pNetNode->fd, n_szBuff, m_nBuffSize, 0);
+		if (nResult > 0)
+		{
+			ReceiveTcpMessage(pNetNode, pNetNode->sCache, n_szBuff, (int)nResult);
+			// 回调中调用 Stop 时连接已释放
+			if (m_bRun && pNetNode->bQuit) FreeConnection(n_pReactor, pNetNode);
+			return;
+		}
+
+		if (nResult == SOCKET_ERROR && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+			return;
+
+		FreeConnection(n_pReactor, pNetNode);
 	}
 
-	bool CTinyClient::InitSock()
+	void CTinyClientPool::FreeConnection(FReactor* n_pReactor, FNetNode* n_pNetNode)
 	{
-		int nSockType = NetType2SockType(eNetType);
-		if (nSockType == 0) return false;
+		auto pNetNode = (FPoolNetNode*)n_pNetNode;
 
-		do
+		if (pNetNode->bConnected)
 		{
-			m_bRun = false;
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_Nodes.Erase(pNetNode->Id);
+		}
 
-			fd = socket(AF_INET, nSockType, 0);
-			if (fd == SOCKET_ERROR)
-			{
-				DebugLog("create Socket error: %d\n", LastError());
-				break;
-			}
+		if (pNetNode->nConnectTimer > 0) n_pReactor->Timers->Cancel(pNetNode->nConnectTimer);
 
-			SetSocketTTL(fd, IP_TTL, (unsigned char)m_nTTL);
-			SetSocketSendTimeout(fd, m_nTimeout);
+		n_pReactor->Peers.Erase(pNetNode->nKey);
+		n_pReactor->nConnections--;
+		pNetNode->Server->nConnections--;
+		pNetNode->Server->nOutstanding -= pNetNode->nOutstanding;
 
-			auto nResult = connect(fd, (stSockaddr*)Addr, sizeof(stSockaddr));
-			if (nResult == SOCKET_ERROR)
-			{
-				DebugLog("connect Socket error: %d\n", LastError());
-				break;
-			}
+		epoll_ctl(n_pReactor->nEpfd, EPOLL_CTL_DEL, pNetNode->fd, nullptr);
 
-			KeepAlive(fd);
+		OnEventCallback(pNetNode, ENetEvent::Quit, "");
 
-			Join();
-			m_thread = std::thread(&CTinyClient::WorkerThread, this);
+		// 启用回调线程时在该连接的回调执行后释放
+		RetireNode(pNetNode, std::bind(ReleasePoolNode, pNetNode));
+	}
 
-			m_bRun = true;
+	void CTinyClientPool::OnCallbackBacklog(FNetNode* n_pNetNode)
+	{
+		if (n_pNetNode == this) return;
+		if (UpdateReadPause(n_pNetNode, kPauseBacklog, true)) WatchReadable(n_pNetNode->SendQueue, false);
+	}
 
-		} while (false);
+	void CTinyClientPool::OnCallbackDrained(const unsigned long long n_nKey)
+	{
+		PostReadPause(n_nKey, kPauseBacklog, false);
+	}
 
-		if (!m_bRun) CloseSocket(fd);
+	bool CTinyClientPool::PostReadPause(const unsigned long long n_nId, const unsigned char n_nReason,
+		const bool n_bPause)
+	{
+		// 连接只在所属 Reactor 线程释放，在其中重新查找
+		return PostToNode(n_nId, [this, n_nId, n_nReason, n_bPause]() {
+			FNetNode* pNetNode = nullptr;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				auto ppNetNode = m_Nodes.Find(n_nId);
+				if (ppNetNode) pNetNode = *ppNetNode;
+			}
 
-		return m_bRun;
+			if (pNetNode && UpdateReadPause(pNetNode, n_nReason, n_bPause))
+				WatchReadable(pNetNode->SendQueue, !n_bPause);
+		});
 	}
 
-	void CTinyClient::WorkerThread()
+	bool CTinyClientPool::PostToNode(const unsigned long long n_nId, std::function<void()> n_fnTask)
 	{
-		int nResult = 0;
-
-		char* szBuff = (char*)malloc(m_nBuffSize);
-		if (!szBuff) return;
-		memset(szBuff, 0, m_nBuffSize);
+		if (!m_bRun) return false;
 
-		SockaddrLen	nLen = sizeof(stSockaddrIn);
+		// 停止时先停止回调线程再释放 Reactor，此处 Reactor 仍然有效
+		FReactor* pReactor = nullptr;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			auto ppNetNode = m_Nodes.Find(n_nId);
+			if (!ppNetNode) return false;
+			pReactor = ((FPoolNetNode*)*ppNetNode)->Reactor;
+		}
 
-		// 通知服务端初始化
-		Hello();
+		PostToReactor(pReactor, std::move(n_fnTask));
+		return true;
+	}
 
-		OnEventCallback(this, ENetEvent::Ready, "");
-		if (m_nHeartPeriod > 0)
-			std::thread(&CTinyClient::HeartThread, this).detach();
+	void CTinyClientPool::SendHearts(FReactor* n_pReactor)
+	{
+		// 遍历时不可删除，超时的连接遍历后关闭
+		std::vector<FNetNode*> vecTimeout;
 
-		while (true)
-		{
-			memset(szBuff, 0, m_nBuffSize);
+		n_pReactor->Peers.ForEach([this, &vecTimeout](CHashMap<FNetNode*>::Key, FNetNode* n_pNetNode) {
+			auto pNetNode = (FPoolNetNode*)n_pNetNode;
+			if (!pNetNode->bConnected) return;
 
-			if (eNetType == ENetType::TCP)
-				nResult = recv(fd, szBuff, m_nBuffSize, 0);
-			else if (eNetType == ENetType::UDP)
+			// 未接收到返回心跳，默认连接异常
+			if (pNetNode->nHeartNo == pNetNode->nHeartSent)
 			{
-				nResult = recvfrom(fd, szBuff, m_nBuffSize, 0,
-					(stSockaddr*)Addr, &nLen);
+				if (pNetNode->nHeartFail >= m_nHeartTimeoutCnt)
+				{
+					vecTimeout.push_back(pNetNode);
+					return;
+				}
+				pNetNode->nHeartFail++;
 			}
+			else pNetNode->nHeartFail = 0;
 
-			if (nResult == 0) break;
-			if (nResult == SOCKET_ERROR)
+			if (pNetNode->Heart(pNetNode->nHeartNo, pNetNode->nHeartFail) < 0)
 			{
-				// 操作被中断，重新尝试或执行其他操作
-#if defined(_WIN32) || defined(_WIN64)
-				if (WSAEINTR == LastError()) continue;
-#else
-				if (EINTR == LastError()) continue;
-#endif
-				if (m_bRun) DebugLog("socket quit");
-				break;
+				vecTimeout.push_back(pNetNode);
+				return;
 			}
 
-			ReceiveTcpMessage(this, sCache, szBuff, nResult);
-			ReceiveUdpMessage(this, szBuff, nResult);
-		}
-
-		free(szBuff);
+			pNetNode->nHeartSent = pNetNode->nHeartNo;
+		});
 
-		OnEventCallback(this, ENetEvent::Quit, "");
+		for (size_t i = 0; i < vecTimeout.size() && m_bRun; i++)
+		{
+			DebugTrace("heart timeout\n");
+			FreeConnection(n_pReactor, vecTimeout[i]);
+		}
 	}
 
-	void CTinyClient::HeartThread()
+	void CTinyClientPool::FreeReactors()
 	{
-		int nRet = 0;
+		if (!m_pReactors) return;
 
-		const int nSlice = 500;
-		unsigned int nCounter = m_nHeartPeriod;
-		unsigned int nHeartNo = 0xFFFFFFFF;
-		unsigned int nFail = 0;
-
-		m_nHeartNo = 0;
+		for (unsigned int i = 0; i < m_nReactorCnt; i++)
+		{
+			if (m_pReactors[i].nWakeFd > 0) WakeReactor(&m_pReactors[i]);
+		}
 
-		while (m_bRun && m_nHeartPeriod > 0)
+		// 当前线程所属的 Reactor
+		FReactor* pSelf = nullptr;
+		for (unsigned int i = 0; i < m_nReactorCnt; i++)
 		{
-			if (nCounter < m_nHeartPeriod)
-			{
-				nCounter += nSlice;
-				std::this_thread::sleep_for(std::chrono::milliseconds(nSlice));
-				continue;
-			}
+			auto& Thread = m_pReactors[i].Thread;
+			if (!Thread.joinable()) continue;
 
-			// 未接收到返回心跳，默认连接异常，退出
-			if (m_nHeartNo == nHeartNo)
+			// 在 Reactor 线程的回调中调用 Stop
+			if (Thread.get_id() == std::this_thread::get_id())
 			{
-				if (nFail >= m_nHeartTimeoutCnt) break;
-				else nFail++;
+				Thread.detach();
+				pSelf = &m_pReactors[i];
 			}
-			else nFail = 0;
+			else Thread.join();
+		}
+
+		for (unsigned int i = 0; i < m_nReactorCnt; i++)
+		{
+			auto pReactor = &m_pReactors[i];
 
-			nRet = Heart(m_nHeartNo, nFail);
-			if (nRet < 0) break;
+			// 未加入 Reactor 的连接在任务中释放
+			if (pReactor->nWakeFd > 0) RunReactorTasks(pReactor);
 
-			nCounter = 0;
-			nHeartNo = m_nHeartNo;
+			// 通知服务端退出；当前线程正在回调的连接仍在使用，由线程退出时释放
+			pReactor->Peers.ForEach([pReactor, pSelf](CHashMap<FNetNode*>::Key, FNetNode* n_pNetNode) {
+				auto pNetNode = (FPoolNetNode*)n_pNetNode;
+				if (pNetNode->bConnected) pNetNode->Quit();
+
+				if (pReactor == pSelf && pReactor->Orphans) pReactor->Orphans->push_back(pNetNode);
+				else ReleasePoolNode(pNetNode);
+			});
+			pReactor->Peers.Clear();
+
+			if (pReactor->nWakeFd > 0) close(pReactor->nWakeFd);
+			if (pReactor->nEpfd > 0) close(pReactor->nEpfd);
 		}
 
-		// 无法发送心跳或接收心跳超时，停止
-		if (m_nHeartNo == nHeartNo || nRet < 0) Stop();
-	}
+		delete[] m_pReactors;
+		m_pReactors = nullptr;
+		m_nReactorCnt = 0;
 
-	void CTinyClient::Join()
-	{
-		if (m_thread.joinable()) m_thread.join();
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_Nodes.Clear();
+		}
+
+		for (auto pServer : m_vecServers) delete pServer;
+		m_vecServers.clear();
 	}
 
-	bool CTinyClient::OnEventMessage(FNetNode* n_pNetNode, const char* n_szData, const int n_nSize)
+	bool CTinyClientPool::OnEventMessage(FNetNode* n_pNetNode, const char* n_szData, const int n_nSize)
 	{
 		bool bResult = true;
 
@@ -1829,17 +5900,15 @@ namespace tinynet
 		if (!NetBuffer.PointTo(n_szData, n_nSize)) return false;
 		auto nEventId = NetBuffer.GetEventId();
 
+		auto pNetNode = (FPoolNetNode*)n_pNetNode;
+
 		switch (nEventId)
 		{
 		case kHelloId:
-		{
-			// 获取远端 sockaddr
-			memcpy(m_szRemoteAddr, NetBuffer.GetData(), SOCKADDR_SIZE);
-
+			// 在服务端的 sockaddr
 			OnEventCallback(n_pNetNode, ENetEvent::Hello, 
-				std::string(m_szRemoteAddr, SOCKADDR_SIZE));
-		}
-		break;
+				std::string(NetBuffer.GetData(), SOCKADDR_SIZE));
+			break;
 		case kHeartId:
 		{
 			auto pHeart = (FHeart*)NetBuffer.GetData();
@@ -1856,42 +5925,35 @@ namespace tinynet
 			);
 
 			// 服务端发的心跳包需回消息
-			if (pHeart->Sender != (unsigned int)fd)
+			if (pHeart->Sender != (unsigned int)n_pNetNode->fd)
 			{
 				pHeart->No = htonl(nNo + 1);
 				n_pNetNode->Send(NetBuffer);
 			}
 			else
 			{
-				m_nHeartNo = nNo;
+				pNetNode->nHeartNo = nNo;
 			}
 		}
 		break;
 		case kQuitId:
-			QuitEvent();
-			// 工作线程退出后，会触发退出事件，这里无需发送退出事件
+			// 读取完成后关闭，触发退出事件
+			pNetNode->bQuit = true;
 			break;
 		default:
+			// 数据消息，完成一个请求；只在所属 Reactor 线程减少，检查后再减不会小于0
+			if (pNetNode->nOutstanding > 0)
+			{
+				pNetNode->nOutstanding--;
+				pNetNode->Server->nOutstanding--;
+			}
 			bResult = false;
 			break;
 		}
 
 		return bResult;
 	}
-
-	void CTinyClient::QuitEvent()
-	{
-		// 通知服务端退出
-		Quit();
-
-		m_bRun = false;
-		m_nHeartNo = 0;
-		m_nHeartPeriod = 0;
-
-		// 关闭Socket
-		CloseSocket(fd);
-	}
-
+#endif
 #pragma endregion
 }
 
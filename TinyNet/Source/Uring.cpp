@@ -0,0 +1,320 @@
+#include "Uring.h"
+#if defined(TINYNET_IO_URING)
+#include "Debug.h"
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+namespace tinynet
+{
+	static int UringSetup(unsigned int n_nEntries, struct io_uring_params* n_pParams)
+	{
+		return (int)syscall(__NR_io_uring_setup, n_nEntries, n_pParams);
+	}
+
+	static int UringEnter(int n_nFd, unsigned int n_nSubmit, unsigned int n_nWait, unsigned int n_nFlags,
+		void* n_pArg = nullptr, size_t n_nArgSize = 0)
+	{
+		return (int)syscall(__NR_io_uring_enter, n_nFd, n_nSubmit, n_nWait, n_nFlags, n_pArg, n_nArgSize);
+	}
+
+	static int UringRegister(int n_nFd, unsigned int n_nOpcode, void* n_pArg, unsigned int n_nArgs)
+	{
+		return (int)syscall(__NR_io_uring_register, n_nFd, n_nOpcode, n_pArg, n_nArgs);
+	}
+
+	// 检查内核是否支持所需的操作
+	static bool ProbeOps(int n_nFd)
+	{
+		const size_t nSize = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+		auto pProbe = (struct io_uring_probe*)calloc(1, nSize);
+		if (!pProbe) return false;
+
+		bool bResult = UringRegister(n_nFd, IORING_REGISTER_PROBE, pProbe, 256) == 0;
+
+		// SEND_ZC 与多次触发的 recv 同在 6.0 加入，用于判断内核版本
+		const unsigned char Ops[] = {
+			IORING_OP_ACCEPT, IORING_OP_RECV, IORING_OP_RECVMSG, IORING_OP_SEND,
+			IORING_OP_POLL_ADD, IORING_OP_ASYNC_CANCEL, IORING_OP_SEND_ZC,
+		};
+		for (size_t i = 0; bResult && i < sizeof(Ops); i++)
+		{
+			bResult = Ops[i] <= pProbe->last_op &&
+				(pProbe->ops[Ops[i]].flags & IO_URING_OP_SUPPORTED);
+		}
+
+		free(pProbe);
+		return bResult;
+	}
+
+	CUring::~CUring()
+	{
+		Exit();
+	}
+
+	bool CUring::Init(const unsigned int n_nEntries)
+	{
+		if (IsValid()) return true;
+
+		// SINGLE_ISSUER 及 DEFER_TASKRUN 需 Linux 6.1，不支持时不使用
+		const unsigned int Flags[] = {
+			IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN,
+			0,
+		};
+
+		struct io_uring_params Params;
+		for (auto nFlags : Flags)
+		{
+			memset(&Params, 0, sizeof(Params));
+			Params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_R_DISABLED | nFlags;
+			Params.cq_entries = n_nEntries * 8;
+
+			m_nFd = UringSetup(n_nEntries, &Params);
+			if (m_nFd >= 0 || errno != EINVAL) break;
+		}
+
+		if (m_nFd < 0)
+		{
+			m_nFd = 0;
+			DebugLog("io_uring_setup error: %d\n", errno);
+			return false;
+		}
+
+		do
+		{
+			if (!(Params.features & IORING_FEAT_SINGLE_MMAP) ||
+				!(Params.features & IORING_FEAT_NODROP) ||
+				!(Params.features & IORING_FEAT_EXT_ARG)) break;
+			if (!ProbeOps(m_nFd)) break;
+
+			// 提交队列与完成队列共用一次映射
+			m_nSqRingSize = Params.sq_off.array + Params.sq_entries * sizeof(unsigned int);
+			m_nCqRingSize = Params.cq_off.cqes + Params.cq_entries * sizeof(struct io_uring_cqe);
+			if (m_nCqRingSize > m_nSqRingSize) m_nSqRingSize = m_nCqRingSize;
+			m_nCqRingSize = m_nSqRingSize;
+
+			m_pSqRing = mmap(nullptr, m_nSqRingSize, PROT_READ | PROT_WRITE,
+				MAP_SHARED | MAP_POPULATE, m_nFd, IORING_OFF_SQ_RING);
+			if (m_pSqRing == MAP_FAILED)
+			{
+				m_pSqRing = nullptr;
+				break;
+			}
+			m_pCqRing = m_pSqRing;
+
+			m_nSqesSize = Params.sq_entries * sizeof(struct io_uring_sqe);
+			m_pSqes = (struct io_uring_sqe*)mmap(nullptr, m_nSqesSize, PROT_READ | PROT_WRITE,
+				MAP_SHARED | MAP_POPULATE, m_nFd, IORING_OFF_SQES);
+			if (m_pSqes == MAP_FAILED)
+			{
+				m_pSqes = nullptr;
+				break;
+			}
+
+			auto pSq = (char*)m_pSqRing;
+			m_pSqHead = (unsigned int*)(pSq + Params.sq_off.head);
+			m_pSqTail = (unsigned int*)(pSq + Params.sq_off.tail);
+			m_nSqMask = *(unsigned int*)(pSq + Params.sq_off.ring_mask);
+			m_nSqEntries = Params.sq_entries;
+			m_nSqeTail = *m_pSqTail;
+
+			// SQE 按顺序使用，索引数组固定为一一对应
+			auto pArray = (unsigned int*)(pSq + Params.sq_off.array);
+			for (unsigned int i = 0; i < m_nSqEntries; i++) pArray[i] = i;
+
+			auto pCq = (char*)m_pCqRing;
+			m_pCqHead = (unsigned int*)(pCq + Params.cq_off.head);
+			m_pCqTail = (unsigned int*)(pCq + Params.cq_off.tail);
+			m_nCqMask = *(unsigned int*)(pCq + Params.cq_off.ring_mask);
+			m_pCqes = (struct io_uring_cqe*)(pCq + Params.cq_off.cqes);
+
+			return true;
+
+		} while (false);
+
+		DebugLog("io_uring not supported\n");
+		Exit();
+		return false;
+	}
+
+	void CUring::Exit()
+	{
+		// 请求引用的缓存在结束前不能释放
+		if (IsValid() && m_nInflight > 0)
+		{
+			auto pSqe = GetSqe();
+			if (pSqe)
+			{
+				pSqe->opcode = IORING_OP_ASYNC_CANCEL;
+				pSqe->fd = -1;
+				pSqe->cancel_flags = IORING_ASYNC_CANCEL_ANY | IORING_ASYNC_CANCEL_ALL;
+			}
+
+			while (m_nInflight > 0)
+			{
+				if (Submit(1) < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) break;
+				ForEachCqe([](const struct io_uring_cqe*) {});
+			}
+		}
+
+		if (m_pBufRing) munmap(m_pBufRing, m_nBufRingSize);
+		m_pBufRing = nullptr;
+		free(m_szBuffers);
+		m_szBuffers = nullptr;
+
+		if (m_pSqes) munmap(m_pSqes, m_nSqesSize);
+		m_pSqes = nullptr;
+		if (m_pSqRing) munmap(m_pSqRing, m_nSqRingSize);
+		m_pSqRing = nullptr;
+		m_pCqRing = nullptr;
+
+		if (m_nFd > 0) close(m_nFd);
+		m_nFd = 0;
+		m_nInflight = 0;
+	}
+
+	bool CUring::Enable()
+	{
+		return UringRegister(m_nFd, IORING_REGISTER_ENABLE_RINGS, nullptr, 0) == 0;
+	}
+
+	struct io_uring_sqe* CUring::GetSqe()
+	{
+		if (!IsValid()) return nullptr;
+
+		auto nHead = __atomic_load_n(m_pSqHead, __ATOMIC_ACQUIRE);
+		if (m_nSqeTail - nHead >= m_nSqEntries)
+		{
+			// 提交队列已满
+			if (Submit() < 0) return nullptr;
+
+			nHead = __atomic_load_n(m_pSqHead, __ATOMIC_ACQUIRE);
+			if (m_nSqeTail - nHead >= m_nSqEntries) return nullptr;
+		}
+
+		auto pSqe = &m_pSqes[m_nSqeTail & m_nSqMask];
+		memset(pSqe, 0, sizeof(struct io_uring_sqe));
+		m_nSqeTail++;
+		m_nInflight++;
+
+		return pSqe;
+	}
+
+	const unsigned int CUring::SqSpace() const
+	{
+		if (!IsValid()) return 0;
+		return m_nSqEntries - (m_nSqeTail - __atomic_load_n(m_pSqHead, __ATOMIC_ACQUIRE));
+	}
+
+	int CUring::Submit(const unsigned int n_nWait, const int n_nTimeout)
+	{
+		if (!IsValid()) return -1;
+
+		CommitBuffers();
+
+		__atomic_store_n(m_pSqTail, m_nSqeTail, __ATOMIC_RELEASE);
+		auto nSubmit = m_nSqeTail - __atomic_load_n(m_pSqHead, __ATOMIC_ACQUIRE);
+
+		// DEFER_TASKRUN 模式下需 GETEVENTS 才会处理完成事件
+		int nResult = 0;
+		if (n_nWait > 0 && n_nTimeout >= 0)
+		{
+			struct __kernel_timespec Timeout;
+			Timeout.tv_sec = n_nTimeout / 1000;
+			Timeout.tv_nsec = (long long)(n_nTimeout % 1000) * 1000000;
+
+			struct io_uring_getevents_arg Arg;
+			memset(&Arg, 0, sizeof(Arg));
+			Arg.ts = (unsigned long long)(uintptr_t)&Timeout;
+
+			nResult = UringEnter(m_nFd, nSubmit, n_nWait,
+				IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &Arg, sizeof(Arg));
+		}
+		else nResult = UringEnter(m_nFd, nSubmit, n_nWait, IORING_ENTER_GETEVENTS);
+
+		if (nResult < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY && errno != ETIME)
+			DebugLog("io_uring_enter error: %d\n", errno);
+
+		return nResult;
+	}
+
+	bool CUring::SetupBufRing(const unsigned short n_nGroup, unsigned int n_nCount, const unsigned int n_nSize)
+	{
+		if (!IsValid() || m_pBufRing || n_nCount == 0 || n_nSize == 0) return false;
+
+		// 数量需为 2 的幂，最大 32768
+		unsigned int nCount = 1;
+		while (nCount < n_nCount && nCount < 32768) nCount <<= 1;
+
+		m_nBufRingSize = nCount * sizeof(struct io_uring_buf);
+		auto pRing = mmap(nullptr, m_nBufRingSize, PROT_READ | PROT_WRITE,
+			MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+		if (pRing == MAP_FAILED) return false;
+		m_pBufRing = (struct io_uring_buf_ring*)pRing;
+
+		m_szBuffers = (char*)malloc((size_t)nCount * n_nSize);
+		if (!m_szBuffers)
+		{
+			munmap(m_pBufRing, m_nBufRingSize);
+			m_pBufRing = nullptr;
+			return false;
+		}
+
+		struct io_uring_buf_reg Reg;
+		memset(&Reg, 0, sizeof(Reg));
+		Reg.ring_addr = (unsigned long long)(uintptr_t)m_pBufRing;
+		Reg.ring_entries = nCount;
+		Reg.bgid = n_nGroup;
+
+		if (UringRegister(m_nFd, IORING_REGISTER_PBUF_RING, &Reg, 1) != 0)
+		{
+			DebugLog("io_uring register buffer ring error: %d\n", errno);
+			munmap(m_pBufRing, m_nBufRingSize);
+			m_pBufRing = nullptr;
+			free(m_szBuffers);
+			m_szBuffers = nullptr;
+			return false;
+		}
+
+		m_nBufCount = nCount;
+		m_nBufSize = n_nSize;
+		m_nBufGroup = n_nGroup;
+		m_nBufTail = 0;
+
+		for (unsigned int i = 0; i < nCount; i++) RecycleBuffer((unsigned short)i);
+		CommitBuffers();
+
+		return true;
+	}
+
+	char* CUring::GetBuffer(const unsigned short n_nBid) const
+	{
+		return m_szBuffers + (size_t)n_nBid * m_nBufSize;
+	}
+
+	void CUring::RecycleBuffer(const unsigned short n_nBid)
+	{
+		// C++ 中 bufs 前的空结构体占用空间，按数组直接计算地址
+		auto pBuf = (struct io_uring_buf*)m_pBufRing + (m_nBufTail & (m_nBufCount - 1));
+		pBuf->addr = (unsigned long long)(uintptr_t)GetBuffer(n_nBid);
+		pBuf->len = m_nBufSize;
+		pBuf->bid = n_nBid;
+
+		m_nBufTail++;
+		m_bBufDirty = true;
+	}
+
+	void CUring::CommitBuffers()
+	{
+		if (!m_bBufDirty) return;
+
+		__atomic_store_n(&m_pBufRing->tail, m_nBufTail, __ATOMIC_RELEASE);
+		m_bBufDirty = false;
+	}
+}
+
+#endif // TINYNET_IO_URING